@@ -76,6 +76,7 @@ typedef struct
 	int cleanscreenshot;
 	int demowarp;
 	int fps;
+	int rendertime; // [crispy] in microseconds
 
 	boolean automapoverlay;
 	boolean flashinghom;
@@ -168,6 +169,18 @@ enum
     NUM_FREELOOKS
 };
 
+enum
+{
+    HIRES_OFF,
+    HIRES_2X,
+    HIRES_3X,
+    HIRES_4X,
+    HIRES_5X,
+    HIRES_6X,
+    HIRES_NATIVE,
+    NUM_HIRES
+};
+
 enum
 {
     JUMP_OFF,
@@ -114,6 +114,15 @@ static loop_interface_t *loop_interface = NULL;
 
 static boolean local_playeringame[NET_MAXPLAYERS];
 
+// [Crispy Multiplayer Doom] Client-side prediction (-predict).  While
+// predicted is true, the game shows the state after running the local
+// player's ticcmds speculatively up to predicted_tic; the authoritative
+// state at gametic is restored before any more tics are run for real.
+
+static boolean predict = false;
+static boolean predicted = false;
+static int predicted_tic;
+
 // Requested player class "sent" to the server on connect.
 // If we are only doing a single player game then this needs to be remembered
 // and saved in the game settings.
@@ -169,9 +178,10 @@ static boolean BuildNewTic(void)
        if (!net_client_connected && maketic - gameticdiv > 2)
            return false;
 
-       // Never go more than ~200ms ahead
+       // Never go more than ~200ms ahead, or less with -netlatency auto
+       // when the measured latency allows it.
 
-       if (maketic - gameticdiv > 8)
+       if (maketic - gameticdiv > NET_CL_GetLookahead())
            return false;
     }
     else
@@ -384,6 +394,27 @@ void D_StartNetGame(net_gamesettings_t *settings,
     else
         settings->ticdup = 1;
 
+    //!
+    // @category net
+    // @arg auto
+    //
+    // Measure the latency and jitter to the server and other players
+    // during the game, and adapt the input delay to the smallest value
+    // that avoids stalling.
+    //
+
+    i = M_CheckParmWithArgs("-netlatency", 1);
+
+    if (i > 0)
+    {
+        if (strcasecmp(myargv[i+1], "auto") != 0)
+        {
+            I_Error("Invalid parameter to -netlatency: '%s'", myargv[i+1]);
+        }
+
+        net_auto_latency = true;
+    }
+
     if (net_client_connected)
     {
         // Send our game settings and block until game start is received
@@ -416,6 +447,18 @@ void D_StartNetGame(net_gamesettings_t *settings,
     ticdup = settings->ticdup;
     new_sync = settings->new_sync;
 
+    //!
+    // @category net
+    //
+    // Predict the local player's movement in netgames by running our
+    // own tics ahead of the server, and rewinding when the other
+    // players' tics arrive.
+    //
+
+    predict = M_ParmExists("-predict") && net_client_connected && !drone
+           && new_sync && loop_interface->SaveState != NULL;
+    predicted = false;
+
     // TODO: Message disabled until we fix new_sync.
     //if (!new_sync)
     //{
@@ -665,6 +708,65 @@ static void SinglePlayerClear(ticcmd_set_t *set)
 }
 
 
+// Run the local player's tics that the server has not yet sent back to
+// us, repeating the last known ticcmds for the other players.  Returns
+// false if no tics were predicted.
+
+static boolean PredictTics(void)
+{
+    ticcmd_t cmds[NET_MAXPLAYERS];
+    boolean ingame[NET_MAXPLAYERS];
+    ticcmd_set_t *last;
+    int i;
+
+    if (!predicted)
+    {
+        if (!loop_interface->SaveState())
+        {
+            return false;
+        }
+
+        predicted = true;
+        predicted_tic = gametic / ticdup;
+    }
+
+    if (predicted_tic >= maketic)
+    {
+        return false;
+    }
+
+    last = recvtic > 0 ? &ticdata[(recvtic - 1) % BACKUPTICS] : NULL;
+
+    for (; predicted_tic < maketic; ++predicted_tic)
+    {
+        for (i = 0; i < NET_MAXPLAYERS; ++i)
+        {
+            if (i == localplayer)
+            {
+                cmds[i] = ticdata[predicted_tic % BACKUPTICS].cmds[i];
+                ingame[i] = true;
+            }
+            else if (last != NULL)
+            {
+                cmds[i] = last->cmds[i];
+                ingame[i] = last->ingame[i];
+            }
+            else
+            {
+                memset(&cmds[i], 0, sizeof(ticcmd_t));
+                ingame[i] = local_playeringame[i];
+            }
+        }
+
+        for (i = 0; i < ticdup; ++i)
+        {
+            loop_interface->RunPredictedTic(cmds, ingame);
+        }
+    }
+
+    return true;
+}
+
 //
 // TryRunTics
 //
@@ -711,6 +813,18 @@ void TryRunTics (void)
     {
 	counts = availabletics;
 
+        // [Crispy Multiplayer Doom] When predicting, don't wait for the
+        // server; show the local player's tics straight away.
+        if (predict && counts < 1)
+        {
+            if (!PredictTics() && !crispy->uncapped)
+            {
+                I_Sleep(1);
+            }
+
+            return;
+        }
+
         // [AM] If we've uncapped the framerate and there are no tics
         //      to run, return early instead of waiting around.
         if (return_early)
@@ -768,6 +882,13 @@ void TryRunTics (void)
         }
     }
 
+    // Rewind any predicted tics before running the real ones.
+    if (predicted)
+    {
+        loop_interface->RestoreState();
+        predicted = false;
+    }
+
     // run the count * ticdup dics
     while (counts--)
     {
@@ -802,6 +923,11 @@ void TryRunTics (void)
 
 	NetUpdate ();	// check for new console commands
     }
+
+    if (predict)
+    {
+        PredictTics();
+    }
 }
 
 void D_RegisterLoopCallbacks(loop_interface_t *i)
@@ -46,6 +46,15 @@ typedef struct
     // Run the menu (runs independently of the game).
 
     void (*RunMenu)();
+
+    // [Crispy Multiplayer Doom] Client-side prediction; these may be NULL
+    // if the game does not support it.  Save the playsim state (returning
+    // false if the game cannot be predicted right now), restore the saved
+    // state, and advance the game one tic speculatively.
+
+    boolean (*SaveState)(void);
+    void (*RestoreState)(void);
+    void (*RunPredictedTic)(ticcmd_t *cmds, boolean *ingame);
 } loop_interface_t;
 
 // Register callback functions for the main loop code to use.
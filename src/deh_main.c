@@ -25,6 +25,7 @@
 #include "i_system.h"
 #include "d_iwad.h"
 #include "m_argv.h"
+#include "m_trace.h"
 #include "w_wad.h"
 
 #include "deh_defs.h"
@@ -432,10 +433,14 @@ int DEH_LoadFile(const char *filename)
         return 0;
     }
 
+    M_TraceBegin("DEH_LoadFile", filename);
+
     DEH_ParseContext(context);
 
     DEH_CloseFile(context);
 
+    M_TraceEnd();
+
     if (DEH_HadError(context))
     {
         I_Error("Error parsing dehacked file");
@@ -494,10 +499,14 @@ int DEH_LoadLump(int lumpnum, boolean allow_long, boolean allow_error)
         return 0;
     }
 
+    M_TraceBegin("DEH_LoadLump", lumpinfo[lumpnum]->wad_file->path);
+
     DEH_ParseContext(context);
 
     DEH_CloseFile(context);
 
+    M_TraceEnd();
+
     // If there was an error while parsing, abort with an error, but allow
     // errors to just be ignored if allow_error=true.
     if (!allow_error && DEH_HadError(context))
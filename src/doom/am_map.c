@@ -214,7 +214,7 @@ static int 	leveljuststarted = 1; 	// kluge until AM_LevelInit() is called
 
 boolean    	automapactive = false;
 //static int 	finit_width = SCREENWIDTH;
-//static int 	finit_height = SCREENHEIGHT - (ST_HEIGHT << crispy->hires);
+//static int 	finit_height = SCREENHEIGHT - (ST_HEIGHT * hires_scale);
 
 // location of window on screen
 static int 	f_x;
@@ -564,7 +564,7 @@ void AM_LevelInit(void)
 
     f_x = f_y = 0;
     f_w = SCREENWIDTH;
-    f_h = SCREENHEIGHT - (ST_HEIGHT << crispy->hires);
+    f_h = SCREENHEIGHT - (ST_HEIGHT * hires_scale);
 
     AM_clearMarks();
 
@@ -586,12 +586,15 @@ void AM_ReInit(boolean rescale)
     if (!rescale)
 	return;
 
+    // [crispy] keep the zoom level relative to the new resolution
+    if (f_w)
+	scale_mtof = FixedMul(scale_mtof, FixedDiv(SCREENWIDTH, f_w));
+
     f_w = SCREENWIDTH;
-    f_h = SCREENHEIGHT - (ST_HEIGHT << crispy->hires);
+    f_h = SCREENHEIGHT - (ST_HEIGHT * hires_scale);
 
     AM_findMinMaxBoundaries();
 
-    scale_mtof = crispy->hires ? scale_mtof*2 : scale_mtof/2;
     if (scale_mtof > max_scale_mtof)
 	scale_mtof = min_scale_mtof;
     scale_ftom = FixedDiv(FRACUNIT, scale_mtof);
@@ -1672,9 +1675,9 @@ void AM_drawMarks(void)
 	    {
 		AM_rotatePoint(&pt);
 	    }
-	    fx = (CXMTOF(pt.x) >> crispy->hires) - 1;
-	    fy = (CYMTOF(pt.y) >> crispy->hires) - 2;
-	    if (fx >= f_x && fx <= (f_w >> crispy->hires) - w && fy >= f_y && fy <= (f_h >> crispy->hires) - h)
+	    fx = (CXMTOF(pt.x) / hires_scale) - 1;
+	    fy = (CYMTOF(pt.y) / hires_scale) - 2;
+	    if (fx >= f_x && fx <= (f_w / hires_scale) - w && fy >= f_y && fy <= (f_h / hires_scale) - h)
 		V_DrawPatch(fx, fy, marknums[i]);
 	}
     }
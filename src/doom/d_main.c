@@ -51,6 +51,7 @@
 #include "m_controls.h"
 #include "m_misc.h"
 #include "m_menu.h"
+#include "m_trace.h"
 #include "p_saveg.h"
 
 #include "i_endoom.h"
@@ -359,8 +360,8 @@ boolean D_Display (void)
 	if (automapactive && !crispy->automapoverlay)
 	    y = 4;
 	else
-	    y = (viewwindowy >> crispy->hires)+4;
-	V_DrawPatchShadow2((viewwindowx >> crispy->hires) + ((scaledviewwidth >> crispy->hires) - 68) / 2, y,
+	    y = (viewwindowy / hires_scale)+4;
+	V_DrawPatchShadow2((viewwindowx / hires_scale) + ((scaledviewwidth / hires_scale) - 68) / 2, y,
                           W_CacheLumpName (DEH_String("M_PAUSE"), PU_CACHE));
     }
 
@@ -587,14 +588,34 @@ void D_DoomLoop (void)
     I_SetWindowTitle(gamedescription);
     I_GraphicsCheckCommandLine();
     I_SetGrabMouseCallback(D_GrabMouseCallback);
+    M_TraceBegin("I_InitGraphics", NULL);
     I_InitGraphics();
+    M_TraceEnd();
     EnableLoadingDisk();
 
+    M_TraceBegin("TryRunTics", NULL);
     TryRunTics();
+    M_TraceEnd();
 
     V_RestoreBuffer();
     R_ExecuteSetViewSize();
 
+    //!
+    // @category video
+    //
+    // [crispy] Time the column and span drawers at the current
+    // resolution, print the results and quit.
+    //
+
+    if (M_ParmExists("-benchdrawers"))
+    {
+        R_BenchDrawers();
+        I_Quit();
+    }
+
+    // [crispy] startup is over
+    M_FinishTrace();
+
     D_StartGameLoop();
 
     if (testcontrols)
@@ -1444,8 +1465,13 @@ void D_DoomMain (void)
 
     I_PrintBanner(PACKAGE_STRING);
 
+    // [crispy] startup trace
+    M_InitTrace ();
+
     DEH_printf("Z_Init: Init zone memory allocation daemon. \n");
+    M_TraceBegin("Z_Init", NULL);
     Z_Init ();
+    M_TraceEnd();
 
     //!
     // @category net
@@ -1670,13 +1696,17 @@ void D_DoomMain (void)
     
     // init subsystems
     DEH_printf("V_Init: allocate screens.\n");
+    M_TraceBegin("V_Init", NULL);
     V_Init ();
+    M_TraceEnd();
 
     // Load configuration files before initialising other subsystems.
     DEH_printf("M_LoadDefaults: Load system defaults.\n");
+    M_TraceBegin("M_LoadDefaults", NULL);
     M_SetConfigFilenames("default.cfg", PROGRAM_PREFIX "doom.cfg");
     D_BindVariables();
     M_LoadDefaults();
+    M_TraceEnd();
 
     // Save configuration at exit.
     I_AtExit(M_SaveDefaults, false);
@@ -1695,6 +1725,7 @@ void D_DoomMain (void)
     modifiedgame = false;
 
     DEH_printf("W_Init: Init WADfiles.\n");
+    M_TraceBegin("W_Init", NULL);
     D_AddFile(iwadfile);
     numiwadlumps = numlumps;
 
@@ -1784,10 +1815,12 @@ void D_DoomMain (void)
     if (!M_ParmExists("-noautoload") && gamemode != shareware)
     {
         char *autoload_dir;
+        M_TraceBegin("autoload", NULL);
         autoload_dir = M_GetAutoloadDir(D_SaveGameIWADName(gamemission));
         DEH_AutoLoadPatches(autoload_dir);
         W_AutoLoadWADs(autoload_dir);
         free(autoload_dir);
+        M_TraceEnd();
     }
 
     // Load Dehacked patches specified on the command line with -deh.
@@ -1850,7 +1883,9 @@ void D_DoomMain (void)
     }
 
     // Load PWAD files.
+    M_TraceBegin("W_ParseCommandLine", NULL);
     modifiedgame |= W_ParseCommandLine(); // [crispy] OR'ed
+    M_TraceEnd();
 
     //!
     // @arg <file>
@@ -1955,6 +1990,9 @@ void D_DoomMain (void)
     // Generate the WAD hash table.  Speed things up a bit.
     W_GenerateHashTable();
 
+    // [crispy] the WADs are all in, apart from NERVE.WAD and friends
+    M_TraceEnd();
+
     // [crispy] allow overriding of special-casing
     if (!M_ParmExists("-nodeh"))
     {
@@ -2047,11 +2085,13 @@ void D_DoomMain (void)
     }
 
     DEH_printf("I_Init: Setting up machine state.\n");
+    M_TraceBegin("I_Init", NULL);
     I_CheckIsScreensaver();
     I_InitTimer();
     I_InitJoystick();
     I_InitSound(true);
     I_InitMusic();
+    M_TraceEnd();
 
     // [crispy] check for SSG resources
     crispy->havessg =
@@ -2083,7 +2123,9 @@ void D_DoomMain (void)
     }
 
     printf ("NET_Init: Init network subsystem.\n");
+    M_TraceBegin("NET_Init", NULL);
     NET_Init ();
+    M_TraceEnd();
 
     // Initial netgame startup. Connect to server etc.
     D_ConnectNetGame();
@@ -2257,27 +2299,41 @@ void D_DoomMain (void)
     }
 
     DEH_printf("M_Init: Init miscellaneous info.\n");
+    M_TraceBegin("M_Init", NULL);
     M_Init ();
+    M_TraceEnd();
 
     DEH_printf("R_Init: Init DOOM refresh daemon - ");
+    M_TraceBegin("R_Init", NULL);
     R_Init ();
+    M_TraceEnd();
 
     DEH_printf("\nP_Init: Init Playloop state.\n");
+    M_TraceBegin("P_Init", NULL);
     P_Init ();
+    M_TraceEnd();
 
     DEH_printf("S_Init: Setting up sound.\n");
+    M_TraceBegin("S_Init", NULL);
     S_Init (sfxVolume * 8, musicVolume * 8);
+    M_TraceEnd();
 
     DEH_printf("D_CheckNetGame: Checking network game status.\n");
+    M_TraceBegin("D_CheckNetGame", NULL);
     D_CheckNetGame ();
+    M_TraceEnd();
 
     PrintGameVersion();
 
     DEH_printf("HU_Init: Setting up heads up display.\n");
+    M_TraceBegin("HU_Init", NULL);
     HU_Init ();
+    M_TraceEnd();
 
     DEH_printf("ST_Init: Init status bar.\n");
+    M_TraceBegin("ST_Init", NULL);
     ST_Init ();
+    M_TraceEnd();
 
     // If Doom II without a MAP01 lump, this is a store demo.
     // Moved this here so that MAP01 isn't constantly looked up
@@ -94,11 +94,22 @@ static void RunTic(ticcmd_t *cmds, boolean *ingame)
     G_Ticker ();
 }
 
+// [Crispy Multiplayer Doom] Run a tic speculatively for client-side
+// prediction.  Players leaving are left for the real tic to handle.
+
+static void RunPredictedTic(ticcmd_t *cmds, boolean *ingame)
+{
+    G_PredictTic(cmds);
+}
+
 static loop_interface_t doom_loop_interface = {
     D_ProcessEvents,
     G_BuildTiccmd,
     RunTic,
-    M_Ticker
+    M_Ticker,
+    G_SavePredictionState,
+    G_RestorePredictionState,
+    RunPredictedTic
 };
 
 
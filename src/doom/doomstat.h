@@ -221,6 +221,10 @@ extern  boolean	usergame;
 extern  boolean	demoplayback;
 extern  boolean	demorecording;
 
+// [Crispy Multiplayer Doom] Running a tic speculatively, for client-side
+// prediction.
+extern  boolean	predicting;
+
 // Round angleturn in ticcmds to the nearest 256.  This is used when
 // recording Vanilla demos in netgames.
 
@@ -306,6 +310,7 @@ extern int		skyflatnum;
 
 
 extern	int		rndindex;
+extern	int		prndindex; // [Crispy Multiplayer Doom] saved for prediction
 
 extern  ticcmd_t       *netcmds;
 
@@ -42,6 +42,7 @@
 
 #include "p_setup.h"
 #include "p_saveg.h"
+#include "p_snapshot.h"
 #include "p_extsaveg.h"
 #include "p_tick.h"
 
@@ -231,8 +232,6 @@ static char     savename[256]; // [crispy] moved here, made static
 static int      savegameslot; 
 static char     savedescription[32]; 
  
-#define	BODYQUESIZE	32
-
 mobj_t*		bodyque[BODYQUESIZE]; 
 int		bodyqueslot; 
  
@@ -1599,6 +1598,9 @@ void G_ExitLevel (void)
     // [Crispy Multiplayer Doom] Don't exit if deathmatch and -noexit.
     if (deathmatch && no_exit)
         return;
+    // [Crispy Multiplayer Doom] Only the server's tics may end the level.
+    if (predicting)
+        return;
     secretexit = false; 
     G_ClearSavename();
     gameaction = ga_completed; 
@@ -1607,6 +1609,9 @@ void G_ExitLevel (void)
 // Here's for the german edition.
 void G_SecretExitLevel (void) 
 { 
+    // [Crispy Multiplayer Doom] Only the server's tics may end the level.
+    if (predicting)
+	return;
     // IF NO WOLF3D LEVELS, NO SECRET EXIT!
     if ( (gamemode == commercial)
       && (W_CheckNumForName("map31")<0))
@@ -1841,6 +1846,9 @@ void G_DoCompleted (void)
     automapactive = false; 
 
     StatCopy(&wminfo);
+
+    // [crispy] read the next level while the intermission is shown
+    P_PrefetchLevel (gameepisode, wminfo.next + 1);
  
     WI_Start (&wminfo); 
 } 
@@ -2134,6 +2142,82 @@ void G_DoSaveGame (void)
     // draw the pattern into the back screen
     R_FillBackScreen ();
 }
+
+//
+// [Crispy Multiplayer Doom] Client-side prediction.  The authoritative
+// level state is snapshotted in memory before the local player's ticcmds
+// are run speculatively, and restored again when the server's tics arrive.
+//
+
+boolean predicting = false;
+
+static snapshot_t predict_snapshot;
+
+// Game state outside the level that P_Ticker() may change.
+
+static gameaction_t predict_gameaction;
+static boolean predict_secretexit;
+static int predict_oldleveltime;
+
+boolean G_SavePredictionState (void)
+{
+    if (gameaction != ga_nothing)
+    {
+        return false;
+    }
+
+    predict_gameaction = gameaction;
+    predict_secretexit = secretexit;
+    predict_oldleveltime = oldleveltime;
+
+    return P_SaveSnapshot(&predict_snapshot);
+}
+
+void G_RestorePredictionState (void)
+{
+    if (!P_RestoreSnapshot(&predict_snapshot))
+    {
+        I_Error("G_RestorePredictionState: Failed to restore level state");
+    }
+
+    gameaction = predict_gameaction;
+    secretexit = predict_secretexit;
+    oldleveltime = predict_oldleveltime;
+}
+
+// Run a tic of the playsim only, without the game state changes,
+// demo recording and consistency checks done by G_Ticker.
+
+void G_PredictTic (ticcmd_t *cmds)
+{
+    int i;
+
+    if (gamestate != GS_LEVEL || gameaction != ga_nothing)
+    {
+        return;
+    }
+
+    for (i = 0; i < MAXPLAYERS; i++)
+    {
+	if (playeringame[i])
+	{
+	    players[i].cmd = cmds[i];
+
+	    // no pausing or saving in predicted tics
+	    if (players[i].cmd.buttons & BT_SPECIAL)
+	    {
+		players[i].cmd.buttons = 0;
+	    }
+	}
+    }
+
+    predicting = true;
+
+    oldleveltime = leveltime;
+    P_Ticker ();
+
+    predicting = false;
+}
  
 
 //
@@ -67,6 +67,12 @@ void G_WorldDone (void);
 void G_BuildTiccmd (ticcmd_t *cmd, int maketic); 
 
 void G_Ticker (void);
+
+// [Crispy Multiplayer Doom] Client-side prediction.
+
+boolean G_SavePredictionState (void);
+void G_RestorePredictionState (void);
+void G_PredictTic (ticcmd_t *cmds);
 boolean G_Responder (event_t*	ev);
 
 void G_ScreenShot (void);
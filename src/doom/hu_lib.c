@@ -169,7 +169,7 @@ void HUlib_eraseTextLine(hu_textline_t* l)
     if (!automapactive &&
 	viewwindowx && (l->needsupdate || crispy->cleanscreenshot || crispy->screenshotmsg == 4))
     {
-	lh = (SHORT(l->f[0]->height) + 1) << crispy->hires;
+	lh = (SHORT(l->f[0]->height) + 1) * hires_scale;
 	// [crispy] support line breaks
 	yoffset = 1;
 	for (y = 0; y < l->len; y++)
@@ -180,7 +180,7 @@ void HUlib_eraseTextLine(hu_textline_t* l)
 	    }
 	}
 	lh *= yoffset;
-	for (y=(l->y << crispy->hires),yoffset=y*SCREENWIDTH ; y<(l->y << crispy->hires)+lh ; y++,yoffset+=SCREENWIDTH)
+	for (y=(l->y * hires_scale),yoffset=y*SCREENWIDTH ; y<(l->y * hires_scale)+lh ; y++,yoffset+=SCREENWIDTH)
 	{
 	    if (y < viewwindowy || y >= viewwindowy + viewheight)
 		R_VideoErase(yoffset, SCREENWIDTH); // erase entire line
@@ -106,6 +106,7 @@ static hu_textline_t	w_coordx;
 static hu_textline_t	w_coordy;
 static hu_textline_t	w_coorda;
 static hu_textline_t	w_fps;
+static hu_textline_t	w_rendertime;
 boolean			chat_on;
 static hu_itext_t	w_chat;
 static boolean		always_off = false;
@@ -635,6 +636,11 @@ void HU_Start(void)
 		       hu_font,
 		       HU_FONTSTART);
 
+    HUlib_initTextLine(&w_rendertime,
+		       HU_COORDX, HU_MSGY + 4 * 8,
+		       hu_font,
+		       HU_FONTSTART);
+
     
     switch ( logical_gamemission )
     {
@@ -896,6 +902,15 @@ void HU_Drawer(void)
 	while (*s)
 	    HUlib_addCharToTextLine(&w_fps, *(s++));
 	HUlib_drawTextLine(&w_fps, false);
+
+	// [crispy] time spent rendering the player view
+	M_snprintf(str, sizeof(str), "%s%d.%02d %sMS", crstr[CR_GRAY],
+	        crispy->rendertime / 1000, (crispy->rendertime / 10) % 100, crstr[CR_GREEN]);
+	HUlib_clearTextLine(&w_rendertime);
+	s = str;
+	while (*s)
+	    HUlib_addCharToTextLine(&w_rendertime, *(s++));
+	HUlib_drawTextLine(&w_rendertime, false);
     }
 
     if (crispy->crosshair == CROSSHAIR_STATIC)
@@ -929,6 +944,7 @@ void HU_Erase(void)
     HUlib_eraseTextLine(&w_coordy);
     HUlib_eraseTextLine(&w_coorda);
     HUlib_eraseTextLine(&w_fps);
+    HUlib_eraseTextLine(&w_rendertime);
 
 }
 
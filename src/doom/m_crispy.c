@@ -101,6 +101,17 @@ multiitem_t multiitem_freelook[NUM_FREELOOKS] =
     {FREELOOK_LOCK, "lock"},
 };
 
+multiitem_t multiitem_hires[NUM_HIRES] =
+{
+    {HIRES_OFF, "off"},
+    {HIRES_2X, "2x"},
+    {HIRES_3X, "3x"},
+    {HIRES_4X, "4x"},
+    {HIRES_5X, "5x"},
+    {HIRES_6X, "6x"},
+    {HIRES_NATIVE, "native"},
+};
+
 multiitem_t multiitem_jump[NUM_JUMPS] =
 {
     {JUMP_OFF, "off"},
@@ -329,7 +340,7 @@ void M_CrispyToggleFullsounds(int choice)
 
 static void M_CrispyToggleHiresHook (void)
 {
-    crispy->hires = !crispy->hires;
+    crispy->hires = (crispy->hires + 1) % NUM_HIRES;
 
     // [crispy] re-initialize framebuffers, textures and renderer
     I_InitGraphics();
@@ -36,6 +36,7 @@ extern multiitem_t multiitem_freeaim[NUM_FREEAIMS];
 extern multiitem_t multiitem_demotimer[NUM_DEMOTIMERS];
 extern multiitem_t multiitem_demotimerdir[];
 extern multiitem_t multiitem_freelook[NUM_FREELOOKS];
+extern multiitem_t multiitem_hires[NUM_HIRES];
 extern multiitem_t multiitem_jump[NUM_JUMPS];
 extern multiitem_t multiitem_sndchannels[4];
 extern multiitem_t multiitem_translucency[NUM_TRANSLUCENCY];
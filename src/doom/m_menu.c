@@ -1431,7 +1431,7 @@ static void M_DrawCrispness1(void)
     M_DrawCrispnessHeader("Crispness 1/4");
 
     M_DrawCrispnessSeparator(crispness_sep_rendering, "Rendering");
-    M_DrawCrispnessItem(crispness_hires, "High Resolution Rendering", crispy->hires, true);
+    M_DrawCrispnessMultiItem(crispness_hires, "High Resolution Rendering", multiitem_hires, crispy->hires, true);
     M_DrawCrispnessItem(crispness_uncapped, "Uncapped Framerate", crispy->uncapped, true);
     M_DrawCrispnessItem(crispness_vsync, "Enable VSync", crispy->vsync, !force_software_renderer);
     M_DrawCrispnessItem(crispness_smoothscaling, "Smooth Pixel Scaling", crispy->smoothscaling, true);
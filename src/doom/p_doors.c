@@ -287,7 +287,7 @@ EV_DoDoor
 	
 	// new door thinker
 	rtn = 1;
-	door = Z_Malloc (sizeof(*door), PU_LEVSPEC, 0);
+	door = P_AllocateThinker (sizeof(*door));
 	P_AddThinker (&door->thinker);
 	sec->specialdata = door;
 
@@ -510,7 +510,7 @@ EV_VerticalDoor
 	
     
     // new door thinker
-    door = Z_Malloc (sizeof(*door), PU_LEVSPEC, 0);
+    door = P_AllocateThinker (sizeof(*door));
     P_AddThinker (&door->thinker);
     sec->specialdata = door;
     door->thinker.function.acp1 = (actionf_p1) T_VerticalDoor;
@@ -560,7 +560,7 @@ void P_SpawnDoorCloseIn30 (sector_t* sec)
 {
     vldoor_t*	door;
 	
-    door = Z_Malloc ( sizeof(*door), PU_LEVSPEC, 0);
+    door = P_AllocateThinker (sizeof(*door));
 
     P_AddThinker (&door->thinker);
 
@@ -585,7 +585,7 @@ P_SpawnDoorRaiseIn5Mins
 {
     vldoor_t*	door;
 	
-    door = Z_Malloc ( sizeof(*door), PU_LEVSPEC, 0);
+    door = P_AllocateThinker (sizeof(*door));
     
     P_AddThinker (&door->thinker);
 
@@ -796,7 +796,7 @@ EV_SlidingDoor
     // Init sliding door vars
     if (!door)
     {
-	door = Z_Malloc (sizeof(*door), PU_LEVSPEC, 0);
+	door = P_AllocateThinker (sizeof(*door));
 	P_AddThinker (&door->thinker);
 	sec->specialdata = door;
 		
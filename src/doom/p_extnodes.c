@@ -244,6 +244,68 @@ void P_LoadNodes_DeePBSP (int lump)
   W_ReleaseLumpNum(lump);
 }
 
+#ifdef HAVE_LIBZ
+// [crispy] inflate a compressed ZDBSP nodes lump, skipping its header.
+// The result is allocated with malloc() and NULL is returned on error,
+// so this may also be called from the level prefetch thread.
+byte *P_InflateNodes_ZDBSP (const byte *data, int len, int *outlen)
+{
+    z_stream zstream;
+    byte *output;
+    int size, err;
+
+    // first estimate for compression rate:
+    // output buffer size == 2.5 * input size
+    size = 2.5 * len;
+    output = malloc(size);
+
+    if (output == NULL)
+	return NULL;
+
+    // initialize stream state for decompression
+    memset(&zstream, 0, sizeof(zstream));
+    zstream.next_in = (byte *) data + 4;
+    zstream.avail_in = len - 4;
+    zstream.next_out = output;
+    zstream.avail_out = size;
+
+    if (inflateInit(&zstream) != Z_OK)
+    {
+	free(output);
+	return NULL;
+    }
+
+    // resize if output buffer runs full
+    while ((err = inflate(&zstream, Z_SYNC_FLUSH)) == Z_OK)
+    {
+	const int size_old = size;
+	byte *newoutput;
+
+	size = 2 * size_old;
+	newoutput = realloc(output, size);
+
+	if (newoutput == NULL)
+	    break;
+
+	output = newoutput;
+	zstream.next_out = output + size_old;
+	zstream.avail_out = size - size_old;
+    }
+
+    inflateEnd(&zstream);
+
+    if (err != Z_STREAM_END)
+    {
+	free(output);
+	return NULL;
+    }
+
+    *outlen = zstream.total_out;
+
+    return output;
+}
+#endif
+
 // [crispy] support maps with compressed or uncompressed ZDBSP nodes
 // adapted from prboom-plus/src/p_setup.c:1040-1331
 // heavily modified, condensed and simplyfied
@@ -274,49 +336,26 @@ void P_LoadNodes_ZDBSP (int lump, boolean compressed)
     {
 #ifdef HAVE_LIBZ
 	const int len =  W_LumpLength(lump);
-	int outlen, err;
-	z_stream *zstream;
-
-	// first estimate for compression rate:
-	// output buffer size == 2.5 * input size
-	outlen = 2.5 * len;
-	output = Z_Malloc(outlen, PU_STATIC, 0);
-
-	// initialize stream state for decompression
-	zstream = malloc(sizeof(*zstream));
-	memset(zstream, 0, sizeof(*zstream));
-	zstream->next_in = data + 4;
-	zstream->avail_in = len - 4;
-	zstream->next_out = output;
-	zstream->avail_out = outlen;
-
-	if (inflateInit(zstream) != Z_OK)
-	    I_Error("P_LoadNodes: Error during ZDBSP nodes decompression initialization!");
-
-	// resize if output buffer runs full
-	while ((err = inflate(zstream, Z_SYNC_FLUSH)) == Z_OK)
+	int outlen;
+
+	// [crispy] the nodes may have been inflated during the intermission
+	output = P_GetPrefetchedNodes(lump, &outlen);
+
+	if (output == NULL)
 	{
-	    int outlen_old = outlen;
-	    outlen = 2 * outlen_old;
-	    output = I_Realloc(output, outlen);
-	    zstream->next_out = output + outlen_old;
-	    zstream->avail_out = outlen - outlen_old;
+	    output = P_InflateNodes_ZDBSP(data, len, &outlen);
 	}
 
-	if (err != Z_STREAM_END)
+	if (output == NULL)
 	    I_Error("P_LoadNodes: Error during ZDBSP nodes decompression!");
 
 	fprintf(stderr, "P_LoadNodes: ZDBSP nodes compression ratio %.3f\n",
-	        (float)zstream->total_out/zstream->total_in);
+	        (float)outlen/(len - 4));
 
 	data = output;
 
-	if (inflateEnd(zstream) != Z_OK)
-	    I_Error("P_LoadNodes: Error during ZDBSP nodes decompression shut-down!");
-
 	// release the original data lump
 	W_ReleaseLumpNum(lump);
-	free(zstream);
 #else
 	I_Error("P_LoadNodes: Compressed ZDBSP nodes are not supported!");
 #endif
@@ -517,7 +556,7 @@ void P_LoadNodes_ZDBSP (int lump, boolean compressed)
 
 #ifdef HAVE_LIBZ
     if (compressed)
-	Z_Free(output);
+	free(output);
     else
 #endif
     W_ReleaseLumpNum(lump);
@@ -37,6 +37,8 @@ extern void P_LoadSegs_DeePBSP (int lump);
 extern void P_LoadSubsectors_DeePBSP (int lump);
 extern void P_LoadNodes_DeePBSP (int lump);
 extern void P_LoadNodes_ZDBSP (int lump, boolean compressed);
+extern byte *P_InflateNodes_ZDBSP (const byte *data, int len, int *outlen);
+extern byte *P_GetPrefetchedNodes (int lump, int *len);
 extern void P_LoadThings_Hexen (int lump);
 extern void P_LoadLineDefs_Hexen (int lump);
 
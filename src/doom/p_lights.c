@@ -66,7 +66,7 @@ void P_SpawnFireFlicker (sector_t*	sector)
     // Nothing special about it during gameplay.
     sector->special = 0; 
 	
-    flick = Z_Malloc ( sizeof(*flick), PU_LEVSPEC, 0);
+    flick = P_AllocateThinker (sizeof(*flick));
 
     P_AddThinker (&flick->thinker);
 
@@ -121,7 +121,7 @@ void P_SpawnLightFlash (sector_t*	sector)
     // nothing special about it during gameplay
     sector->special = 0;	
 	
-    flash = Z_Malloc ( sizeof(*flash), PU_LEVSPEC, 0);
+    flash = P_AllocateThinker (sizeof(*flash));
 
     P_AddThinker (&flash->thinker);
 
@@ -178,7 +178,7 @@ P_SpawnStrobeFlash
 {
     strobe_t*	flash;
 	
-    flash = Z_Malloc ( sizeof(*flash), PU_LEVSPEC, 0);
+    flash = P_AllocateThinker (sizeof(*flash));
 
     P_AddThinker (&flash->thinker);
 
@@ -335,7 +335,7 @@ void P_SpawnGlowingLight(sector_t*	sector)
 {
     glow_t*	g;
 	
-    g = Z_Malloc( sizeof(*g), PU_LEVSPEC, 0);
+    g = P_AllocateThinker (sizeof(*g));
 
     P_AddThinker(&g->thinker);
 
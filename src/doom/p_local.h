@@ -71,9 +71,16 @@
 extern	thinker_t	thinkercap;	
 
 
+void P_InitTicker (void);
 void P_InitThinkers (void);
 void P_AddThinker (thinker_t* thinker);
 void P_RemoveThinker (thinker_t* thinker);
+void* P_AllocateThinker (size_t size);
+void P_FreeThinker (thinker_t* thinker);
+void P_ClearThinkerPools (void);
+size_t P_ThinkerPoolsSize (void);
+void P_SaveThinkerPools (void* dest);
+boolean P_RestoreThinkerPools (const void* src);
 
 
 //
@@ -106,6 +113,11 @@ extern int		itemrespawntime[ITEMQUESIZE];
 extern int		iquehead;
 extern int		iquetail;
 
+// Queue of player corpses in deathmatch.
+#define BODYQUESIZE		32
+
+extern mobj_t*		bodyque[BODYQUESIZE];
+
 
 void P_RespawnSpecials (void);
 
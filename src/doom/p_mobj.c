@@ -627,7 +627,7 @@ P_SpawnMobjSafe
     state_t*	st;
     mobjinfo_t*	info;
 	
-    mobj = Z_Malloc (sizeof(*mobj), PU_LEVEL, NULL);
+    mobj = P_AllocateThinker (sizeof(*mobj));
     memset (mobj, 0, sizeof (*mobj));
     info = &mobjinfo[type];
 	
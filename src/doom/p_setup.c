@@ -32,6 +32,7 @@
 #include "g_game.h"
 
 #include "i_system.h"
+#include "i_thread.h"
 #include "w_wad.h"
 
 #include "doomdef.h"
@@ -1138,6 +1139,140 @@ int P_GetNumForMap (int episode, int map, boolean critical)
     return lumpnum;
 }
 
+// [crispy] While the intermission is shown, the lumps of the next map
+// are paged in with W_AdviseLumpNum() and a worker thread inflates its
+// compressed ZDBSP nodes, so that P_SetupLevel() finds them ready.  The
+// zone is not thread safe, so the worker only reads from a memory-mapped
+// WAD file and keeps its result in malloc()ed memory.
+
+static i_thread_t *prefetch_thread;
+static boolean prefetch_disable;
+static int prefetch_lumpnum = -1;
+
+static byte *prefetch_nodes;
+static int prefetch_nodes_len;
+
+// where the prefetched nodes came from, in case the WAD is reloaded
+static wad_file_t *prefetch_nodes_wad;
+static unsigned int prefetch_nodes_position;
+
+#ifdef HAVE_LIBZ
+static int P_PrefetchWorker (void *unused)
+{
+    const lumpinfo_t *lump = lumpinfo[prefetch_lumpnum + ML_NODES];
+
+    prefetch_nodes = P_InflateNodes_ZDBSP(lump->wad_file->mapped + lump->position,
+                                          lump->size, &prefetch_nodes_len);
+    prefetch_nodes_wad = lump->wad_file;
+    prefetch_nodes_position = lump->position;
+
+    return 0;
+}
+#endif
+
+static void P_FinishPrefetch (void)
+{
+    if (prefetch_thread != NULL)
+    {
+	I_WaitThread(prefetch_thread);
+	prefetch_thread = NULL;
+    }
+}
+
+static void P_DiscardPrefetch (void)
+{
+    P_FinishPrefetch();
+
+    free(prefetch_nodes);
+    prefetch_nodes = NULL;
+    prefetch_lumpnum = -1;
+}
+
+//
+// P_PrefetchLevel
+// Start reading the given map in the background.
+//
+void P_PrefetchLevel (int episode, int map)
+{
+    static boolean initialized = false;
+#ifdef HAVE_LIBZ
+    const lumpinfo_t *nodes;
+#endif
+    int lumpnum, i;
+
+    if (!initialized)
+    {
+	//!
+	// @category obscure
+	//
+	// [crispy] Do not read the next level in the background during
+	// the intermission.
+	//
+
+	prefetch_disable = M_ParmExists("-nolevelprefetch");
+	initialized = true;
+    }
+
+    P_DiscardPrefetch();
+
+    if (prefetch_disable)
+    {
+	return;
+    }
+
+    lumpnum = P_GetNumForMap(episode, map, false);
+
+    if (lumpnum < 0 || lumpnum + ML_BLOCKMAP >= numlumps)
+    {
+	return;
+    }
+
+    for (i = ML_THINGS; i <= ML_BLOCKMAP; i++)
+    {
+	W_AdviseLumpNum(lumpnum + i, WAD_ADVICE_WILLNEED);
+    }
+
+#ifdef HAVE_LIBZ
+    // the worker may only read a lump that needs no zone memory, and
+    // has nothing to do unless the nodes are compressed
+    nodes = lumpinfo[lumpnum + ML_NODES];
+
+    if (nodes->wad_file->mapped == NULL || nodes->size <= 4
+     || memcmp(nodes->wad_file->mapped + nodes->position, "ZNOD", 4))
+    {
+	return;
+    }
+
+    prefetch_lumpnum = lumpnum;
+    prefetch_thread = I_CreateThread(P_PrefetchWorker, "prefetch", NULL);
+#endif
+}
+
+//
+// P_GetPrefetchedNodes
+// Hand over the inflated ZDBSP nodes of the given lump, if the prefetch
+// thread has already produced them.  The caller must free() them.
+//
+byte *P_GetPrefetchedNodes (int lump, int *len)
+{
+    byte *result;
+
+    P_FinishPrefetch();
+
+    if (prefetch_nodes == NULL || lump != prefetch_lumpnum + ML_NODES
+     || lumpinfo[lump]->wad_file != prefetch_nodes_wad
+     || lumpinfo[lump]->position != prefetch_nodes_position)
+    {
+	return NULL;
+    }
+
+    result = prefetch_nodes;
+    *len = prefetch_nodes_len;
+    prefetch_nodes = NULL;
+
+    return result;
+}
+
 //
 // P_SetupLevel
 //
@@ -1191,7 +1326,11 @@ P_SetupLevel
     // Make sure all sounds are stopped before Z_FreeTags.
     S_Start ();			
 
+    // [crispy] wait for the level prefetch before the WADs may be reloaded
+    P_FinishPrefetch ();
+
     Z_FreeTags (PU_LEVEL, PU_PURGELEVEL-1);
+    P_ClearThinkerPools ();
 
     // UNUSED W_Profile ();
     P_InitThinkers ();
@@ -1225,6 +1364,12 @@ P_SetupLevel
     // [crispy] pointer to the current map lump info struct
     maplumpinfo = lumpinfo[lumpnum];
 
+    // [crispy] the map lumps are each read once, front to back
+    for (i = ML_THINGS; i <= ML_BLOCKMAP; i++)
+    {
+	W_AdviseLumpNum(lumpnum + i, WAD_ADVICE_SEQUENTIAL);
+    }
+
     leveltime = 0;
     oldleveltime = 0;
 	
@@ -1287,6 +1432,9 @@ P_SetupLevel
     P_GroupLines ();
     P_LoadReject (lumpnum+ML_REJECT);
 
+    // [crispy] the prefetched nodes were either used or are for another map
+    P_DiscardPrefetch ();
+
     // [crispy] remove slime trails
     P_RemoveSlimeTrails();
     // [crispy] fix long wall wobble
@@ -1352,6 +1500,7 @@ void P_Init (void)
     P_InitSwitchList ();
     P_InitPicAnims ();
     R_InitSprites (sprnames);
+    P_InitTicker ();
 }
 
 
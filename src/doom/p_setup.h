@@ -31,6 +31,9 @@ P_SetupLevel
   int		playermask,
   skill_t	skill);
 
+// [crispy] Start reading the given map in the background.
+void P_PrefetchLevel (int episode, int map);
+
 // Called by startup code.
 void P_Init (void);
 
@@ -0,0 +1,253 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	In-memory snapshots of the level state.
+//
+//	Unlike savegames, which are written field by field in a portable
+//	format and rebuilt by respawning thinkers, a snapshot is a raw
+//	copy of the level structures in a single reusable arena.  The
+//	slabs of the thinker pools are copied as they are, together with
+//	their free lists, and restored in place.  Every pointer to a
+//	thinker, including ones to removed or freed thinkers, thus points
+//	to what it did when the snapshot was taken, and the playsim runs
+//	identically after a restore.  This is used for client-side
+//	prediction.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomstat.h"
+#include "i_system.h"
+#include "p_local.h"
+#include "p_snapshot.h"
+#include "r_state.h"
+#include "s_musinfo.h"
+#include "z_zone.h"
+
+// Records in the arena are aligned so that they can be accessed in place.
+
+#define SNAPSHOT_ALIGN 16
+
+extern mobj_t **braintargets;
+extern int numbraintargets, braintargeton;
+
+// Global playsim state, copied as it is.  The pointers to thinkers in
+// it stay valid, as the thinkers are restored at the same addresses.
+
+static const struct
+{
+    void *data;
+    size_t size;
+} snapshot_globals[] =
+{
+    {&thinkercap,       sizeof(thinkercap)},
+    {&leveltime,        sizeof(leveltime)},
+    {&prndindex,        sizeof(prndindex)},
+    {&extrakills,       sizeof(extrakills)},
+    {&levelTimer,       sizeof(levelTimer)},
+    {&levelTimeCount,   sizeof(levelTimeCount)},
+    {itemrespawnque,    sizeof(itemrespawnque)},
+    {itemrespawntime,   sizeof(itemrespawntime)},
+    {&iquehead,         sizeof(iquehead)},
+    {&iquetail,         sizeof(iquetail)},
+    {&bodyqueslot,      sizeof(bodyqueslot)},
+    {bodyque,           sizeof(bodyque)},
+    {&braintargeton,    sizeof(braintargeton)},
+    {activeceilings,    sizeof(activeceilings)},
+    {activeplats,       sizeof(activeplats)},
+    {players,           sizeof(players)},
+    {&musinfo,          sizeof(musinfo)},
+};
+
+typedef struct
+{
+    int episode;
+    int map;
+    int numsectors;
+    int numlines;
+    int numsides;
+    int numblocks;
+    int numbraintargets;
+    int numbuttons;
+    size_t poolsize;
+} snapshot_header_t;
+
+static void *SnapshotWrite(snapshot_t *snapshot, const void *data, size_t len)
+{
+    size_t aligned;
+    void *result;
+
+    aligned = (len + SNAPSHOT_ALIGN - 1) & ~(size_t) (SNAPSHOT_ALIGN - 1);
+
+    if (snapshot->len + aligned > snapshot->size)
+    {
+        snapshot->size = snapshot->size * 2 + aligned;
+        snapshot->data = I_Realloc(snapshot->data, snapshot->size);
+    }
+
+    result = snapshot->data + snapshot->len;
+
+    if (data != NULL)
+    {
+        memcpy(result, data, len);
+    }
+
+    snapshot->len += aligned;
+
+    return result;
+}
+
+static void *SnapshotRead(snapshot_t *snapshot, size_t *pos, size_t len)
+{
+    void *result;
+
+    result = snapshot->data + *pos;
+    *pos += (len + SNAPSHOT_ALIGN - 1) & ~(size_t) (SNAPSHOT_ALIGN - 1);
+
+    return result;
+}
+
+boolean P_SaveSnapshot (snapshot_t *snapshot)
+{
+    snapshot_header_t header;
+    int i;
+
+    if (gamestate != GS_LEVEL || sectors == NULL)
+    {
+        return false;
+    }
+
+    snapshot->len = 0;
+
+    header.episode = gameepisode;
+    header.map = gamemap;
+    header.numsectors = numsectors;
+    header.numlines = numlines;
+    header.numsides = numsides;
+    header.numblocks = bmapwidth * bmapheight;
+    header.numbraintargets = numbraintargets;
+    header.numbuttons = maxbuttons;
+    header.poolsize = P_ThinkerPoolsSize();
+
+    SnapshotWrite(snapshot, &header, sizeof(header));
+
+    P_SaveThinkerPools(SnapshotWrite(snapshot, NULL, header.poolsize));
+
+    for (i = 0; i < arrlen(snapshot_globals); ++i)
+    {
+        SnapshotWrite(snapshot, snapshot_globals[i].data,
+                      snapshot_globals[i].size);
+    }
+
+    SnapshotWrite(snapshot, sectors, numsectors * sizeof(sector_t));
+    SnapshotWrite(snapshot, lines, numlines * sizeof(line_t));
+    SnapshotWrite(snapshot, sides, numsides * sizeof(side_t));
+    SnapshotWrite(snapshot, blocklinks, header.numblocks * sizeof(mobj_t *));
+    SnapshotWrite(snapshot, braintargets, numbraintargets * sizeof(mobj_t *));
+    SnapshotWrite(snapshot, buttonlist, maxbuttons * sizeof(button_t));
+
+    return true;
+}
+
+boolean P_RestoreSnapshot (snapshot_t *snapshot)
+{
+    snapshot_header_t *header;
+    thinker_t *th;
+    thinker_t *next;
+    line_t *line;
+    size_t pos;
+    int i;
+
+    if (snapshot->len == 0)
+    {
+        return false;
+    }
+
+    pos = 0;
+    header = SnapshotRead(snapshot, &pos, sizeof(*header));
+
+    if (gamestate != GS_LEVEL
+     || header->episode != gameepisode || header->map != gamemap
+     || header->numsectors != numsectors || header->numlines != numlines
+     || header->numsides != numsides
+     || header->numblocks != bmapwidth * bmapheight
+     || header->numbuttons > maxbuttons)
+    {
+        return false;
+    }
+
+    if (!P_RestoreThinkerPools(SnapshotRead(snapshot, &pos, header->poolsize)))
+    {
+        return false;
+    }
+
+    for (i = 0; i < arrlen(snapshot_globals); ++i)
+    {
+        memcpy(snapshot_globals[i].data,
+               SnapshotRead(snapshot, &pos, snapshot_globals[i].size),
+               snapshot_globals[i].size);
+    }
+
+    // Add the thinkers again in the same order, so that the thinker
+    // array of -thinkerarray is rebuilt.
+
+    th = thinkercap.next;
+    P_InitThinkers();
+
+    for (; th != &thinkercap; th = next)
+    {
+        next = th->next;
+        P_AddThinker(th);
+    }
+
+    memcpy(sectors, SnapshotRead(snapshot, &pos, numsectors * sizeof(sector_t)),
+           numsectors * sizeof(sector_t));
+
+    // Keep lines that have been seen since the snapshot on the automap.
+
+    line = SnapshotRead(snapshot, &pos, numlines * sizeof(line_t));
+
+    for (i = 0; i < numlines; ++i)
+    {
+        int mapped = lines[i].flags & ML_MAPPED;
+
+        lines[i] = line[i];
+        lines[i].flags |= mapped;
+    }
+
+    memcpy(sides, SnapshotRead(snapshot, &pos, numsides * sizeof(side_t)),
+           numsides * sizeof(side_t));
+
+    memcpy(blocklinks,
+           SnapshotRead(snapshot, &pos, header->numblocks * sizeof(mobj_t *)),
+           header->numblocks * sizeof(mobj_t *));
+
+    // [crispy] the braintargets[] array only grows within a level
+
+    memcpy(braintargets,
+           SnapshotRead(snapshot, &pos,
+                        header->numbraintargets * sizeof(mobj_t *)),
+           header->numbraintargets * sizeof(mobj_t *));
+    numbraintargets = header->numbraintargets;
+
+    memcpy(buttonlist,
+           SnapshotRead(snapshot, &pos, header->numbuttons * sizeof(button_t)),
+           header->numbuttons * sizeof(button_t));
+    memset(buttonlist + header->numbuttons, 0,
+           (maxbuttons - header->numbuttons) * sizeof(button_t));
+
+    return true;
+}
@@ -0,0 +1,45 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	In-memory snapshots of the level state.
+//
+
+#ifndef __P_SNAPSHOT__
+#define __P_SNAPSHOT__
+
+#include "doomtype.h"
+
+// A snapshot of the level state.  The arena is allocated on first use
+// and reused by later snapshots, only growing when the level does.
+// Zero-initialize before use.
+
+typedef struct
+{
+    byte *data;
+    size_t size;
+    size_t len;
+} snapshot_t;
+
+// Save the current level state into the snapshot.  Returns false if
+// there is no level to save.
+
+boolean P_SaveSnapshot (snapshot_t *snapshot);
+
+// Restore the level state from a snapshot.  Returns false if the
+// snapshot is empty or was taken on a different level.
+
+boolean P_RestoreSnapshot (snapshot_t *snapshot);
+
+#endif
@@ -18,6 +18,12 @@
 //
 
 
+#include <stdio.h>
+#include <string.h>
+
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
 #include "z_zone.h"
 #include "p_local.h"
 #include "s_musinfo.h" // [crispy] T_MAPMusic()
@@ -29,7 +35,7 @@ int	leveltime;
 
 //
 // THINKERS
-// All thinkers should be allocated by Z_Malloc
+// All thinkers should be allocated by P_AllocateThinker
 // so they can be operated on uniformly.
 // The actual structures will vary in size,
 // but the first element must be thinker_t.
@@ -40,6 +46,71 @@ int	leveltime;
 // Both the head and tail of the thinker list.
 thinker_t	thinkercap;
 
+// [crispy] With -thinkerarray, the thinkers are also kept in an array
+// in list order, so that P_RunThinkers can walk it without chasing the
+// next pointers and can prefetch the thinkers ahead of time.  Thinkers
+// are only ever added at the end of the list and only unlinked by
+// P_RunThinkers, so the array is kept in sync in those two places.
+
+#define THINKERPREFETCH		4
+
+static boolean		thinkerarray;
+static thinker_t**	thinkerorder;
+static int		numthinkerorder;
+static int		maxthinkerorder;
+
+// [crispy] P_RunThinkers timing for -tictime
+
+static boolean		tictime;
+static uint64_t		tictime_total;
+static uint64_t		tictime_max;
+static uint64_t		tictime_thinkers;
+static int		tictime_tics;
+
+static void P_PrintTicTime (void)
+{
+    if (tictime_tics == 0)
+	return;
+
+    printf ("P_RunThinkers (%s): %d tics, %d thinkers/tic, "
+	    "%.2f us/tic average, %.2f us/tic max\n",
+	    thinkerarray ? "thinker array" : "thinker list",
+	    tictime_tics,
+	    (int) (tictime_thinkers / tictime_tics),
+	    (double) tictime_total / tictime_tics,
+	    (double) tictime_max);
+}
+
+//
+// P_InitTicker
+//
+void P_InitTicker (void)
+{
+    //!
+    // @category obscure
+    //
+    // [crispy] Run the thinkers from an array kept in thinker list
+    // order, rather than following the list.  The order in which the
+    // thinkers run does not change, so demos stay in sync.
+    //
+
+    thinkerarray = M_ParmExists("-thinkerarray");
+
+    //!
+    // @category obscure
+    //
+    // [crispy] Print how long it takes to run the thinkers each tic
+    // on exit.  Use with -timedemo to compare -thinkerarray.
+    //
+
+    tictime = M_ParmExists("-tictime");
+
+    if (tictime)
+    {
+	I_AtExit (P_PrintTicTime, true);
+    }
+}
+
 
 //
 // P_InitThinkers
@@ -47,6 +118,7 @@ thinker_t	thinkercap;
 void P_InitThinkers (void)
 {
     thinkercap.prev = thinkercap.next  = &thinkercap;
+    numthinkerorder = 0;
 }
 
 
@@ -62,6 +134,18 @@ void P_AddThinker (thinker_t* thinker)
     thinker->next = &thinkercap;
     thinker->prev = thinkercap.prev;
     thinkercap.prev = thinker;
+
+    if (thinkerarray)
+    {
+	if (numthinkerorder == maxthinkerorder)
+	{
+	    maxthinkerorder = maxthinkerorder ? 2 * maxthinkerorder : 1024;
+	    thinkerorder = I_Realloc (thinkerorder,
+	                              maxthinkerorder * sizeof(*thinkerorder));
+	}
+
+	thinkerorder[numthinkerorder++] = thinker;
+    }
 }
 
 
@@ -79,22 +163,302 @@ void P_RemoveThinker (thinker_t* thinker)
 
 
 
+//
+// [crispy] THINKER POOLS
+// Thinkers are carved out of slabs, one pool for each thinker size,
+// and freed thinkers go onto the pool's free list to be reused.  Each
+// thinker is preceded by a pointer to its pool, so that it can be
+// freed without knowing its type.  The slabs are allocated PU_LEVEL,
+// so they are all dropped at the end of the level, when
+// P_ClearThinkerPools must be called.
+//
+// The slabs and free lists can be saved and restored in place, for
+// p_snapshot.c.  Slabs that were added after the state was saved are
+// kept as spares by a restore, and are carved again when their pool
+// runs out, so that the thinkers are allocated in the same order.
+//
+
+#define MAXTHINKERPOOLS		16
+#define THINKERSLABSIZE		(32 * 1024)
+
+typedef struct
+{
+    size_t	size;
+    thinker_t*	freelist;
+} thinkerpool_t;
+
+typedef union
+{
+    thinkerpool_t*	pool;
+    void*		align;
+} thinkerheader_t;
+
+typedef struct
+{
+    thinkerpool_t*	pool;
+    byte*		data;
+    size_t		size;
+} thinkerslab_t;
+
+typedef struct
+{
+    unsigned int	generation;
+    int			numpools;
+    int			numslabs;
+    thinker_t*		freelists[MAXTHINKERPOOLS];
+} thinkerpoolstate_t;
+
+static thinkerpool_t	thinkerpools[MAXTHINKERPOOLS];
+static int		numthinkerpools;
+
+// the slabs in use, followed by the spare slabs
+static thinkerslab_t*	thinkerslabs;
+static int		numthinkerslabs;
+static int		numspareslabs;
+static int		maxthinkerslabs;
+
+// changed whenever the slabs are freed
+static unsigned int	thinkerpoolgeneration;
+
+static thinkerpool_t *P_ThinkerPool (size_t size)
+{
+    thinkerpool_t*	pool;
+    int			i;
+
+    for (i = 0; i < numthinkerpools; i++)
+    {
+	if (thinkerpools[i].size == size)
+	    return &thinkerpools[i];
+    }
+
+    if (numthinkerpools == MAXTHINKERPOOLS)
+	I_Error ("P_ThinkerPool: too many thinker sizes");
+
+    pool = &thinkerpools[numthinkerpools++];
+    pool->size = size;
+    pool->freelist = NULL;
+
+    return pool;
+}
+
+//
+// P_AddThinkerSlab
+// Carves a slab, a spare one if there is one, into free thinkers.
+//
+static void P_AddThinkerSlab (thinkerpool_t* pool)
+{
+    thinkerslab_t*	slab;
+    thinkerslab_t	spare;
+    thinkerheader_t*	header;
+    thinker_t*		thinker;
+    size_t		slotsize;
+    int			count;
+    int			i;
+
+    slotsize = sizeof(thinkerheader_t) + pool->size;
+
+    for (i = numthinkerslabs; i < numthinkerslabs + numspareslabs; i++)
+    {
+	if (thinkerslabs[i].pool == pool)
+	    break;
+    }
+
+    if (i < numthinkerslabs + numspareslabs)
+    {
+	spare = thinkerslabs[i];
+	thinkerslabs[i] = thinkerslabs[numthinkerslabs];
+	thinkerslabs[numthinkerslabs] = spare;
+	numspareslabs--;
+    }
+    else
+    {
+	if (numthinkerslabs + numspareslabs == maxthinkerslabs)
+	{
+	    maxthinkerslabs = maxthinkerslabs ? 2 * maxthinkerslabs : 64;
+	    thinkerslabs = I_Realloc (thinkerslabs,
+	                              maxthinkerslabs * sizeof(*thinkerslabs));
+	}
+
+	// move the first spare out of the way
+	thinkerslabs[numthinkerslabs + numspareslabs] =
+	    thinkerslabs[numthinkerslabs];
+
+	count = THINKERSLABSIZE / slotsize;
+	if (count < 1)
+	    count = 1;
+
+	slab = &thinkerslabs[numthinkerslabs];
+	slab->pool = pool;
+	slab->size = count * slotsize;
+	slab->data = Z_Malloc (slab->size, PU_LEVEL, NULL);
+    }
+
+    slab = &thinkerslabs[numthinkerslabs++];
+    count = slab->size / slotsize;
+
+    for (i = count - 1; i >= 0; i--)
+    {
+	header = (thinkerheader_t *) (slab->data + i * slotsize);
+	header->pool = pool;
+
+	thinker = (thinker_t *) (header + 1);
+	thinker->next = pool->freelist;
+	pool->freelist = thinker;
+    }
+}
+
 //
 // P_AllocateThinker
-// Allocates memory and adds a new thinker at the end of the list.
+// Allocates memory for a new thinker of the given size.
 //
-void P_AllocateThinker (thinker_t*	thinker)
+void* P_AllocateThinker (size_t size)
 {
+    thinkerpool_t*	pool;
+    thinker_t*		thinker;
+
+    size = (size + sizeof(thinkerheader_t) - 1) & ~(sizeof(thinkerheader_t) - 1);
+    pool = P_ThinkerPool (size);
+
+    if (pool->freelist == NULL)
+	P_AddThinkerSlab (pool);
+
+    thinker = pool->freelist;
+    pool->freelist = thinker->next;
+
+    return thinker;
 }
 
+//
+// P_FreeThinker
+// Returns a thinker, which must already be unlinked, to its pool.
+//
+void P_FreeThinker (thinker_t* thinker)
+{
+    thinkerpool_t*	pool;
 
+    pool = ((thinkerheader_t *) thinker - 1)->pool;
+
+    thinker->next = pool->freelist;
+    pool->freelist = thinker;
+}
 
 //
-// P_RunThinkers
+// P_ClearThinkerPools
+// Forgets the free thinkers, after their slabs have been freed.
 //
-void P_RunThinkers (void)
+void P_ClearThinkerPools (void)
+{
+    int i;
+
+    for (i = 0; i < numthinkerpools; i++)
+    {
+	thinkerpools[i].freelist = NULL;
+    }
+
+    numthinkerslabs = 0;
+    numspareslabs = 0;
+    thinkerpoolgeneration++;
+}
+
+//
+// P_ThinkerPoolsSize
+// Returns the size of the saved state of the thinker pools.
+//
+size_t P_ThinkerPoolsSize (void)
+{
+    size_t	size;
+    int		i;
+
+    size = sizeof(thinkerpoolstate_t);
+
+    for (i = 0; i < numthinkerslabs; i++)
+    {
+	size += thinkerslabs[i].size;
+    }
+
+    return size;
+}
+
+//
+// P_SaveThinkerPools
+// Copies the slabs in use and the free lists to dest, which must be
+// P_ThinkerPoolsSize bytes long.
+//
+void P_SaveThinkerPools (void* dest)
+{
+    thinkerpoolstate_t*	state;
+    byte*		data;
+    int			i;
+
+    state = dest;
+    state->generation = thinkerpoolgeneration;
+    state->numpools = numthinkerpools;
+    state->numslabs = numthinkerslabs;
+
+    for (i = 0; i < numthinkerpools; i++)
+    {
+	state->freelists[i] = thinkerpools[i].freelist;
+    }
+
+    data = (byte *) (state + 1);
+
+    for (i = 0; i < numthinkerslabs; i++)
+    {
+	memcpy (data, thinkerslabs[i].data, thinkerslabs[i].size);
+	data += thinkerslabs[i].size;
+    }
+}
+
+//
+// P_RestoreThinkerPools
+// Copies saved slabs and free lists back in place, so that every
+// pointer to a thinker, removed or freed ones included, points to
+// what it did when they were saved.  Returns false, changing nothing,
+// if the slabs have been freed since.
+//
+boolean P_RestoreThinkerPools (const void* src)
+{
+    const thinkerpoolstate_t*	state;
+    const byte*			data;
+    int				i;
+
+    state = src;
+
+    if (state->generation != thinkerpoolgeneration
+     || state->numslabs > numthinkerslabs)
+    {
+	return false;
+    }
+
+    for (i = 0; i < numthinkerpools; i++)
+    {
+	thinkerpools[i].freelist =
+	    i < state->numpools ? state->freelists[i] : NULL;
+    }
+
+    numspareslabs += numthinkerslabs - state->numslabs;
+    numthinkerslabs = state->numslabs;
+
+    data = (const byte *) (state + 1);
+
+    for (i = 0; i < numthinkerslabs; i++)
+    {
+	memcpy (thinkerslabs[i].data, data, thinkerslabs[i].size);
+	data += thinkerslabs[i].size;
+    }
+
+    return true;
+}
+
+
+
+//
+// P_RunThinkerList
+//
+static int P_RunThinkerList (void)
 {
     thinker_t *currentthinker, *nextthinker;
+    int count = 0;
 
     currentthinker = thinkercap.next;
     while (currentthinker != &thinkercap)
@@ -105,7 +469,7 @@ void P_RunThinkers (void)
             nextthinker = currentthinker->next;
 	    currentthinker->next->prev = currentthinker->prev;
 	    currentthinker->prev->next = currentthinker->next;
-	    Z_Free(currentthinker);
+	    P_FreeThinker(currentthinker);
 	}
 	else
 	{
@@ -114,6 +478,76 @@ void P_RunThinkers (void)
             nextthinker = currentthinker->next;
 	}
 	currentthinker = nextthinker;
+	count++;
+    }
+
+    return count;
+}
+
+//
+// P_RunThinkerArray
+// [crispy] Same as P_RunThinkerList, but walks the thinker array.
+// Thinkers spawned while running are appended to the array and
+// run in this tic, just as they are appended to the list.
+//
+static int P_RunThinkerArray (void)
+{
+    thinker_t *currentthinker;
+    int i, j;
+
+    for (i = 0, j = 0; i < numthinkerorder; i++)
+    {
+	if (i + THINKERPREFETCH < numthinkerorder)
+	{
+	    PREFETCH(thinkerorder[i + THINKERPREFETCH]);
+	}
+
+	currentthinker = thinkerorder[i];
+
+	if ( currentthinker->function.acv == (actionf_v)(-1) )
+	{
+	    // time to remove it
+	    currentthinker->next->prev = currentthinker->prev;
+	    currentthinker->prev->next = currentthinker->next;
+	    P_FreeThinker(currentthinker);
+	}
+	else
+	{
+	    if (currentthinker->function.acp1)
+		currentthinker->function.acp1 (currentthinker);
+	    thinkerorder[j++] = currentthinker;
+	}
+    }
+
+    numthinkerorder = j;
+
+    return i;
+}
+
+//
+// P_RunThinkers
+//
+void P_RunThinkers (void)
+{
+    uint64_t starttime = 0, time;
+    int count;
+
+    if (tictime)
+	starttime = I_GetTimeUS();
+
+    if (thinkerarray)
+	count = P_RunThinkerArray ();
+    else
+	count = P_RunThinkerList ();
+
+    if (tictime)
+    {
+	time = I_GetTimeUS() - starttime;
+	tictime_total += time;
+	tictime_thinkers += count;
+	tictime_tics++;
+	if (time > tictime_max)
+	    tictime_max = time;
     }
 
     // [crispy] support MUSINFO lump (dynamic music changing)
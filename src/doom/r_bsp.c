@@ -85,11 +85,11 @@ typedef	struct
 // render overage and then bomb out by detecting the overflow after the 
 // fact. -haleyjd
 //#define MAXSEGS 32
-#define MAXSEGS (MAXWIDTH / 2 + 1)
+#define MAXSEGS (SCREENWIDTH / 2 + 1)
 
 // newend is one past the last valid seg
 cliprange_t*	newend;
-cliprange_t	solidsegs[MAXSEGS];
+cliprange_t*	solidsegs; // [crispy] allocated for the current resolution
 
 
 
@@ -239,6 +239,15 @@ R_ClipPassWallSegment
 
 
 
+//
+// R_InitClipSegs
+// [crispy] Called whenever the resolution changes.
+//
+void R_InitClipSegs (void)
+{
+    solidsegs = I_Realloc(solidsegs, MAXSEGS * sizeof(*solidsegs));
+}
+
 //
 // R_ClearClipSegs
 //
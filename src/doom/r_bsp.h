@@ -52,6 +52,7 @@ typedef void (*drawfunc_t) (int start, int stop);
 
 
 // BSP?
+void R_InitClipSegs (void); // [crispy]
 void R_ClearClipSegs (void);
 void R_ClearDrawSegs (void);
 
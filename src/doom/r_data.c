@@ -18,10 +18,16 @@
 //
 
 #include <stdio.h>
+#include <sys/stat.h>
 
 #include "deh_main.h"
 #include "i_swap.h"
 #include "i_system.h"
+#include "i_thread.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include "sha1.h"
+#include "w_checksum.h"
 #include "z_zone.h"
 
 
@@ -112,14 +118,6 @@ struct texture_s
     short	width;
     short	height;
 
-    // Index in textures list
-
-    int         index;
-
-    // Next in hash table chain
-
-    texture_t  *next;
-    
     // All the patches[patchcount]
     //  are drawn back to front into the cached texture.
     short	patchcount;
@@ -132,6 +130,9 @@ int		firstflat;
 int		lastflat;
 int		numflats;
 
+// [crispy] flat names to flat numbers
+static nameindex_t	flatindex;
+
 int		firstpatch;
 int		lastpatch;
 int		numpatches;
@@ -142,7 +143,7 @@ int		numspritelumps;
 
 int		numtextures;
 texture_t**	textures;
-texture_t**     textures_hashtable;
+static nameindex_t textures_hashtable;
 
 
 int*			texturewidthmask;
@@ -247,16 +248,19 @@ R_DrawColumnInCache
 
 
 //
-// R_GenerateComposite
+// R_DrawComposite
 // Using the texture definition,
 //  the composite texture is created from the patches,
 //  and each column is cached.
 //
 // Rewritten by Lee Killough for performance and to fix Medusa bug
+//
+// [crispy] split from R_GenerateComposite() so that it can run on the
+// precache worker threads: it does not touch the zone, so the caller
+// passes in the texture's patches, cached and locked.
 
-void R_GenerateComposite (int texnum)
+static void R_DrawComposite (int texnum, byte *block, patch_t **realpatches)
 {
-    byte*		block;
     texture_t*		texture;
     texpatch_t*		patch;	
     patch_t*		realpatch;
@@ -272,10 +276,6 @@ void R_GenerateComposite (int texnum)
 	
     texture = textures[texnum];
 
-    block = Z_Malloc (texturecompositesize[texnum],
-		      PU_STATIC, 
-		      &texturecomposite[texnum]);	
-
     collump = texturecolumnlump[texnum];
     colofs = texturecolumnofs[texnum];
     
@@ -292,7 +292,7 @@ void R_GenerateComposite (int texnum)
 	 i<texture->patchcount;
 	 i++, patch++)
     {
-	realpatch = W_CacheLumpNum (patch->patch, PU_CACHE);
+	realpatch = realpatches[i];
 	x1 = patch->originx;
 	x2 = x1 + SHORT(realpatch->width);
 
@@ -373,6 +373,46 @@ void R_GenerateComposite (int texnum)
 
     free(source); // free temporary column
     free(marks); // free transparency marks
+}
+
+// [crispy] cache the patches of a texture, locked until
+// R_ReleaseTexturePatches() is called
+static void R_CacheTexturePatches (int texnum, patch_t **realpatches)
+{
+    texture_t *texture = textures[texnum];
+    int i;
+
+    for (i = 0; i < texture->patchcount; i++)
+    {
+	realpatches[i] = W_CacheLumpNum (texture->patches[i].patch, PU_STATIC);
+    }
+}
+
+static void R_ReleaseTexturePatches (int texnum)
+{
+    texture_t *texture = textures[texnum];
+    int i;
+
+    for (i = 0; i < texture->patchcount; i++)
+    {
+	W_ReleaseLumpNum (texture->patches[i].patch);
+    }
+}
+
+void R_GenerateComposite (int texnum)
+{
+    byte*		block;
+    patch_t**		realpatches;
+
+    block = Z_Malloc (texturecompositesize[texnum],
+		      PU_STATIC, 
+		      &texturecomposite[texnum]);	
+
+    realpatches = I_Realloc (NULL, textures[texnum]->patchcount * sizeof(*realpatches));
+    R_CacheTexturePatches (texnum, realpatches);
+    R_DrawComposite (texnum, block, realpatches);
+    R_ReleaseTexturePatches (texnum);
+    free (realpatches);
 
     // Now that the texture has been built in column cache,
     //  it is purgable from zone memory.
@@ -590,46 +630,52 @@ R_GetColumn
 
 static void GenerateTextureHashTable(void)
 {
-    texture_t **rover;
     int i;
-    int key;
-
-    textures_hashtable 
-            = Z_Malloc(sizeof(texture_t *) * numtextures, PU_STATIC, 0);
 
-    memset(textures_hashtable, 0, sizeof(texture_t *) * numtextures);
+    W_FreeNameIndex(&textures_hashtable);
+    W_InitNameIndex(&textures_hashtable, numtextures);
 
     // Add all textures to hash table
 
     for (i=0; i<numtextures; ++i)
     {
-        // Store index
-
-        textures[i]->index = i;
-
         // Vanilla Doom does a linear search of the texures array
         // and stops at the first entry it finds.  If there are two
         // entries with the same name, the first one in the array
-        // wins. The new entry must therefore be added at the end
-        // of the hash chain, so that earlier entries win.
+        // wins, so later entries must not replace it.
 
-        key = W_LumpNameHash(textures[i]->name) % numtextures;
+        W_AddToNameIndex(&textures_hashtable, textures[i]->name, i, false);
+    }
+}
 
-        rover = &textures_hashtable[key];
 
-        while (*rover != NULL)
-        {
-            rover = &(*rover)->next;
-        }
+// [crispy] allocate the per-texture tables for numtextures textures
+static void R_AllocTextureTables (void)
+{
+    textures = Z_Malloc (numtextures * sizeof(*textures), PU_STATIC, 0);
+    texturecolumnlump = Z_Malloc (numtextures * sizeof(*texturecolumnlump), PU_STATIC, 0);
+    texturecolumnofs = Z_Malloc (numtextures * sizeof(*texturecolumnofs), PU_STATIC, 0);
+    texturecolumnofs2 = Z_Malloc (numtextures * sizeof(*texturecolumnofs2), PU_STATIC, 0);
+    texturecomposite = Z_Malloc (numtextures * sizeof(*texturecomposite), PU_STATIC, 0);
+    texturecompositesize = Z_Malloc (numtextures * sizeof(*texturecompositesize), PU_STATIC, 0);
+    texturewidthmask = Z_Malloc (numtextures * sizeof(*texturewidthmask), PU_STATIC, 0);
+    textureheight = Z_Malloc (numtextures * sizeof(*textureheight), PU_STATIC, 0);
+    texturebrightmap = Z_Malloc (numtextures * sizeof(*texturebrightmap), PU_STATIC, 0);
+}
+
+// [crispy] set up width mask and height of a texture
+static void R_InitTextureSize (int i)
+{
+    int j;
 
-        // Hook into hash table
+    j = 1;
+    while (j*2 <= textures[i]->width)
+	j<<=1;
 
-        textures[i]->next = NULL;
-        *rover = textures[i];
-    }
+    texturewidthmask[i] = j-1;
+    textureheight[i] = textures[i]->height<<FRACBITS;
 }
 
-
 //
 // R_InitTextures
 // Initializes the texture list
@@ -807,15 +853,7 @@ void R_InitTextures (void)
     // [crispy] pointer to (i.e. actually before) the first texture file
     texturelump = texturelumps - 1; // [crispy] gets immediately increased below
 
-    textures = Z_Malloc (numtextures * sizeof(*textures), PU_STATIC, 0);
-    texturecolumnlump = Z_Malloc (numtextures * sizeof(*texturecolumnlump), PU_STATIC, 0);
-    texturecolumnofs = Z_Malloc (numtextures * sizeof(*texturecolumnofs), PU_STATIC, 0);
-    texturecolumnofs2 = Z_Malloc (numtextures * sizeof(*texturecolumnofs2), PU_STATIC, 0);
-    texturecomposite = Z_Malloc (numtextures * sizeof(*texturecomposite), PU_STATIC, 0);
-    texturecompositesize = Z_Malloc (numtextures * sizeof(*texturecompositesize), PU_STATIC, 0);
-    texturewidthmask = Z_Malloc (numtextures * sizeof(*texturewidthmask), PU_STATIC, 0);
-    textureheight = Z_Malloc (numtextures * sizeof(*textureheight), PU_STATIC, 0);
-    texturebrightmap = Z_Malloc (numtextures * sizeof(*texturebrightmap), PU_STATIC, 0);
+    R_AllocTextureTables ();
 
     totalwidth = 0;
     
@@ -903,12 +941,7 @@ void R_InitTextures (void)
 	texturecolumnofs[i] = Z_Malloc (texture->width*sizeof(**texturecolumnofs), PU_STATIC,0);
 	texturecolumnofs2[i] = Z_Malloc (texture->width*sizeof(**texturecolumnofs2), PU_STATIC,0);
 
-	j = 1;
-	while (j*2 <= texture->width)
-	    j<<=1;
-
-	texturewidthmask[i] = j-1;
-	textureheight[i] = texture->height<<FRACBITS;
+	R_InitTextureSize (i);
 		
 	totalwidth += texture->width;
     }
@@ -954,6 +987,13 @@ void R_InitFlats (void)
     
     for (i=0 ; i<numflats ; i++)
 	flattranslation[i] = i;
+
+    // [crispy] index the flat names, the last flat of a name wins
+    W_FreeNameIndex(&flatindex);
+    W_InitNameIndex(&flatindex, numflats);
+
+    for (i=0 ; i<numflats ; i++)
+	W_AddToNameIndex(&flatindex, lumpinfo[firstflat + i]->name, i, true);
 }
 
 
@@ -997,6 +1037,8 @@ enum {
 
 int tran_filter_pct = 66;
 
+extern char *configdir;
+
 void R_InitTranMap()
 {
     int lump = W_CheckNumForName("TRANMAP");
@@ -1015,7 +1057,6 @@ void R_InitTranMap()
 	unsigned char *playpal = W_CacheLumpName("PLAYPAL", PU_STATIC);
 	FILE *cachefp;
 	char *fname = NULL;
-	extern char *configdir;
 
 	struct {
 	    unsigned char pct;
@@ -1104,7 +1145,7 @@ void R_InitTranMap()
 
 	free(fname);
 
-	Z_ChangeTag(playpal, PU_CACHE);
+	W_ReleaseLumpName("PLAYPAL");
     }
 }
 
@@ -1147,7 +1188,7 @@ void R_InitColormaps (void)
 	    crstr[i] = M_StringDuplicate(c);
 	}
 
-	Z_ChangeTag(playpal, PU_CACHE);
+	W_ReleaseLumpName("PLAYPAL");
     }
 
     // [crispy] initialize tinttable for V_DrawPatchShadow2
@@ -1159,6 +1200,293 @@ void R_InitColormaps (void)
 
 
 
+// [crispy] on-disk cache of the results of R_InitTextures() and
+// R_InitSpriteLumps(), keyed by the checksum of the loaded WADs.
+// The file is a header followed by one record per texture and the
+// sprite tables, laid out so that the column tables can be used in
+// place without copying.
+
+#define DATACACHE_MAGIC "RDATACHE"
+#define DATACACHE_VERSION 1
+
+typedef struct
+{
+    char magic[8];
+    unsigned int version;
+    unsigned int length;
+    sha1_digest_t key;
+    int numtextures;
+    int numspritelumps;
+} datacache_header_t;
+
+typedef struct
+{
+    char name[8];
+    short width;
+    short height;
+    short patchcount;
+    short pad;
+    int compositesize;
+} datacache_texture_t;
+
+// [crispy] size of a texture record, followed by its patches and its
+// column tables, each padded to keep the next one aligned
+static size_t R_DataCacheTextureSize (int patchcount, int width)
+{
+    return sizeof(datacache_texture_t)
+         + patchcount * sizeof(texpatch_t)
+         + ((width + 1) & ~1) * sizeof(short)
+         + 2 * width * sizeof(unsigned);
+}
+
+static char *R_DataCacheFile (void)
+{
+    return M_StringJoin(configdir, "rdatacache.dat", NULL);
+}
+
+// [crispy] the cached tables depend on the WAD directory, on the
+// contents of the lumps, which W_Checksum() does not cover, so the
+// modification times of the WAD files are included, and on the
+// names of the lumps that are looked up, which Dehacked may change
+static void R_DataCacheKey (sha1_digest_t key)
+{
+    sha1_context_t sha1_context;
+    sha1_digest_t checksum;
+    wad_file_t *wad_file = NULL;
+    struct stat st;
+    unsigned int i;
+
+    W_Checksum(checksum);
+
+    SHA1_Init(&sha1_context);
+    SHA1_Update(&sha1_context, checksum, sizeof(checksum));
+
+    for (i = 0; i < numlumps; i++)
+    {
+	if (lumpinfo[i]->wad_file == wad_file)
+	{
+	    continue;
+	}
+
+	wad_file = lumpinfo[i]->wad_file;
+
+	if (wad_file != NULL && wad_file->path != NULL &&
+	    stat(wad_file->path, &st) == 0)
+	{
+	    SHA1_UpdateString(&sha1_context, wad_file->path);
+	    SHA1_Update(&sha1_context, (byte *) &st.st_mtime, sizeof(st.st_mtime));
+	}
+    }
+
+    SHA1_UpdateString(&sha1_context, (char *) DEH_String("PNAMES"));
+    SHA1_UpdateString(&sha1_context, (char *) DEH_String("TEXTURE1"));
+    SHA1_UpdateString(&sha1_context, (char *) DEH_String("TEXTURE2"));
+    SHA1_UpdateString(&sha1_context, (char *) DEH_String("S_START"));
+    SHA1_UpdateString(&sha1_context, (char *) DEH_String("S_END"));
+    SHA1_Final(key, &sha1_context);
+}
+
+// [crispy] restore the texture and sprite tables from the cache file,
+// returns false if there is no valid cache for the loaded WADs
+static boolean R_ReadDataCache (void)
+{
+    datacache_header_t header;
+    datacache_texture_t *rec;
+    sha1_digest_t key;
+    FILE *cachefp;
+    char *fname;
+    byte *data, *p, *end;
+    size_t datalen, len;
+    int i;
+
+    fname = R_DataCacheFile();
+    cachefp = fopen(fname, "rb");
+    free(fname);
+
+    if (cachefp == NULL)
+    {
+	return false;
+    }
+
+    R_DataCacheKey(key);
+
+    if (fread(&header, 1, sizeof(header), cachefp) != sizeof(header) ||
+        memcmp(header.magic, DATACACHE_MAGIC, sizeof(header.magic)) ||
+        header.version != DATACACHE_VERSION ||
+        header.length < sizeof(header) ||
+        memcmp(header.key, key, sizeof(key)) ||
+        header.numtextures <= 0 ||
+        header.numspritelumps < 0)
+    {
+	fclose(cachefp);
+	return false;
+    }
+
+    // [crispy] the tables point into this block, so it is never freed
+    datalen = header.length - sizeof(header);
+    data = Z_Malloc(datalen, PU_STATIC, 0);
+
+    if (fread(data, 1, datalen, cachefp) != datalen)
+    {
+	fclose(cachefp);
+	Z_Free(data);
+	return false;
+    }
+
+    fclose(cachefp);
+
+    p = data;
+    end = data + datalen;
+
+    numtextures = header.numtextures;
+    R_AllocTextureTables();
+
+    for (i = 0; i < numtextures; i++)
+    {
+	rec = (datacache_texture_t *) p;
+
+	if ((size_t) (end - p) < sizeof(*rec) ||
+	    rec->width <= 0 || rec->patchcount < 0 ||
+	    (size_t) (end - p) < R_DataCacheTextureSize(rec->patchcount,
+	                                                rec->width))
+	{
+	    break;
+	}
+
+	p += sizeof(*rec);
+
+	textures[i] = Z_Malloc(sizeof(texture_t)
+	                       + sizeof(texpatch_t)*(rec->patchcount-1),
+	                       PU_STATIC, 0);
+	memcpy(textures[i]->name, rec->name, sizeof(rec->name));
+	textures[i]->width = rec->width;
+	textures[i]->height = rec->height;
+	textures[i]->patchcount = rec->patchcount;
+
+	len = rec->patchcount * sizeof(texpatch_t);
+	memcpy(textures[i]->patches, p, len);
+	p += len;
+
+	texturecolumnlump[i] = (short *) p;
+	p += ((rec->width + 1) & ~1) * sizeof(short);
+	texturecolumnofs[i] = (unsigned *) p;
+	p += rec->width * sizeof(unsigned);
+	texturecolumnofs2[i] = (unsigned *) p;
+	p += rec->width * sizeof(unsigned);
+
+	texturecompositesize[i] = rec->compositesize;
+	texturecomposite[i] = 0;
+	texturebrightmap[i] = R_BrightmapForTexName(textures[i]->name);
+	R_InitTextureSize(i);
+    }
+
+    len = 3 * header.numspritelumps * sizeof(fixed_t);
+
+    if (i < numtextures || (size_t) (end - p) != len)
+    {
+	// [crispy] corrupt cache file, start over
+	for (--i; i >= 0; i--)
+	{
+	    Z_Free(textures[i]);
+	}
+	Z_Free(textures);
+	Z_Free(texturecolumnlump);
+	Z_Free(texturecolumnofs);
+	Z_Free(texturecolumnofs2);
+	Z_Free(texturecomposite);
+	Z_Free(texturecompositesize);
+	Z_Free(texturewidthmask);
+	Z_Free(textureheight);
+	Z_Free(texturebrightmap);
+	Z_Free(data);
+	return false;
+    }
+
+    texturetranslation = Z_Malloc ((numtextures+1)*sizeof(*texturetranslation), PU_STATIC, 0);
+
+    for (i=0 ; i<numtextures ; i++)
+	texturetranslation[i] = i;
+
+    GenerateTextureHashTable();
+
+    firstspritelump = W_GetNumForName (DEH_String("S_START")) + 1;
+    lastspritelump = W_GetNumForName (DEH_String("S_END")) - 1;
+    numspritelumps = header.numspritelumps;
+
+    spritewidth = (fixed_t *) p;
+    spriteoffset = spritewidth + numspritelumps;
+    spritetopoffset = spriteoffset + numspritelumps;
+
+    return true;
+}
+
+// [crispy] save the texture and sprite tables to the cache file
+static void R_WriteDataCache (void)
+{
+    datacache_header_t *header;
+    datacache_texture_t *rec;
+    char *fname;
+    byte *data, *p;
+    size_t len;
+    int i;
+
+    len = sizeof(*header) + 3 * numspritelumps * sizeof(fixed_t);
+
+    for (i = 0; i < numtextures; i++)
+    {
+	len += R_DataCacheTextureSize(textures[i]->patchcount,
+	                              textures[i]->width);
+    }
+
+    data = Z_Malloc(len, PU_STATIC, 0);
+    memset(data, 0, len);
+
+    header = (datacache_header_t *) data;
+    memcpy(header->magic, DATACACHE_MAGIC, sizeof(header->magic));
+    header->version = DATACACHE_VERSION;
+    header->length = len;
+    R_DataCacheKey(header->key);
+    header->numtextures = numtextures;
+    header->numspritelumps = numspritelumps;
+
+    p = data + sizeof(*header);
+
+    for (i = 0; i < numtextures; i++)
+    {
+	const texture_t *texture = textures[i];
+	const int width = texture->width;
+
+	rec = (datacache_texture_t *) p;
+	memcpy(rec->name, texture->name, sizeof(rec->name));
+	rec->width = width;
+	rec->height = texture->height;
+	rec->patchcount = texture->patchcount;
+	rec->compositesize = texturecompositesize[i];
+	p += sizeof(*rec);
+
+	memcpy(p, texture->patches, texture->patchcount * sizeof(texpatch_t));
+	p += texture->patchcount * sizeof(texpatch_t);
+	memcpy(p, texturecolumnlump[i], width * sizeof(short));
+	p += ((width + 1) & ~1) * sizeof(short);
+	memcpy(p, texturecolumnofs[i], width * sizeof(unsigned));
+	p += width * sizeof(unsigned);
+	memcpy(p, texturecolumnofs2[i], width * sizeof(unsigned));
+	p += width * sizeof(unsigned);
+    }
+
+    memcpy(p, spritewidth, numspritelumps * sizeof(fixed_t));
+    p += numspritelumps * sizeof(fixed_t);
+    memcpy(p, spriteoffset, numspritelumps * sizeof(fixed_t));
+    p += numspritelumps * sizeof(fixed_t);
+    memcpy(p, spritetopoffset, numspritelumps * sizeof(fixed_t));
+
+    fname = R_DataCacheFile();
+    M_WriteFile(fname, data, len);
+    free(fname);
+
+    Z_Free(data);
+}
+
 //
 // R_InitData
 // Locates all the lumps
@@ -1167,13 +1495,22 @@ void R_InitColormaps (void)
 //
 void R_InitData (void)
 {
+    boolean cached;
+
     R_InitBrightmaps (0);
-    R_InitTextures ();
+    // [crispy] restore textures and sprites from the cache if possible
+    cached = R_ReadDataCache ();
+    if (!cached)
+	R_InitTextures ();
     printf (".");
     R_InitFlats ();
     R_InitBrightmaps (1);
     printf (".");
-    R_InitSpriteLumps ();
+    if (!cached)
+    {
+	R_InitSpriteLumps ();
+	R_WriteDataCache ();
+    }
     printf (".");
     R_InitColormaps ();
     R_InitTranMap(); // [crispy] prints a mark itself
@@ -1190,7 +1527,7 @@ int R_FlatNumForName(const char *name)
     int		i;
     char	namet[9];
 
-    i = W_CheckNumForNameFromTo (name, lastflat, firstflat);
+    i = W_LookupNameIndex (&flatindex, name);
 
     if (i == -1)
     {
@@ -1202,7 +1539,7 @@ int R_FlatNumForName(const char *name)
 	// render missing flats as SKY
 	return skyflatnum;
     }
-    return i - firstflat;
+    return i;
 }
 
 
@@ -1215,26 +1552,11 @@ int R_FlatNumForName(const char *name)
 //
 int R_CheckTextureNumForName(const char *name)
 {
-    texture_t *texture;
-    int key;
-
     // "NoTexture" marker.
     if (name[0] == '-')		
 	return 0;
 		
-    key = W_LumpNameHash(name) % numtextures;
-
-    texture=textures_hashtable[key]; 
-    
-    while (texture != NULL)
-    {
-	if (!strncasecmp (texture->name, name, 8) )
-	    return texture->index;
-
-        texture = texture->next;
-    }
-    
-    return -1;
+    return W_LookupNameIndex (&textures_hashtable, name);
 }
 
 
@@ -1267,6 +1589,124 @@ int R_TextureNumForName(const char *name)
 
 
 
+// [crispy] composite textures are built in parallel by a pool of
+// worker threads while the level finishes loading.  The main thread
+// caches the patches and allocates the composites, locked with
+// PU_STATIC, so that the workers never need to touch the zone.
+
+#define MAX_PRECACHE_THREADS 8
+
+typedef struct
+{
+    int texnum;
+    patch_t **patches;
+} precache_job_t;
+
+static precache_job_t *precache_jobs;
+static patch_t **precache_patches;
+static int num_precache_jobs;
+static i_atomic_t precache_next;
+
+static i_thread_t *precache_threads[MAX_PRECACHE_THREADS];
+static int num_precache_threads;
+
+static boolean precache_pending;
+static boolean precache_stats;
+static int precache_start_time;
+
+static int R_PrecacheWorker (void *unused)
+{
+    int i;
+
+    while ((i = I_AtomicAdd(&precache_next, 1)) < num_precache_jobs)
+    {
+	const int texnum = precache_jobs[i].texnum;
+
+	R_DrawComposite(texnum, texturecomposite[texnum],
+	                precache_jobs[i].patches);
+    }
+
+    return 0;
+}
+
+static void R_StartPrecacheWorkers (void)
+{
+    int i, n;
+
+    I_AtomicSet(&precache_next, 0);
+    precache_pending = true;
+    num_precache_threads = 0;
+
+    // [crispy] leave one core for the main thread, which takes over any
+    // work that is left when it reaches R_FinishPrecache()
+    n = I_GetCPUCount() - 1;
+
+    if (n > MAX_PRECACHE_THREADS)
+	n = MAX_PRECACHE_THREADS;
+    if (n > num_precache_jobs)
+	n = num_precache_jobs;
+
+    for (i = 0; i < n; i++)
+    {
+	precache_threads[i] = I_CreateThread(R_PrecacheWorker, "precache", NULL);
+
+	if (precache_threads[i] == NULL)
+	    break;
+
+	num_precache_threads++;
+    }
+}
+
+//
+// R_FinishPrecache
+// Wait for the composites started by R_PrecacheLevel to be built.
+//
+void R_FinishPrecache (void)
+{
+    int i;
+    int wait_time;
+
+    if (!precache_pending)
+	return;
+
+    wait_time = I_GetTimeMS();
+
+    R_PrecacheWorker(NULL);
+
+    for (i = 0; i < num_precache_threads; i++)
+    {
+	I_WaitThread(precache_threads[i]);
+    }
+
+    wait_time = I_GetTimeMS() - wait_time;
+
+    // Now that the textures have been built in column cache,
+    //  they are purgable from zone memory.
+    for (i = 0; i < num_precache_jobs; i++)
+    {
+	const int texnum = precache_jobs[i].texnum;
+
+	R_ReleaseTexturePatches(texnum);
+	Z_ChangeTag(texturecomposite[texnum], PU_CACHE);
+    }
+
+    if (precache_stats)
+    {
+	printf("R_FinishPrecache: %d composites on %d threads, "
+	       "done after %d ms, waited %d ms\n",
+	       num_precache_jobs, num_precache_threads,
+	       I_GetTimeMS() - precache_start_time, wait_time);
+    }
+
+    free(precache_jobs);
+    free(precache_patches);
+    precache_jobs = NULL;
+    precache_patches = NULL;
+    num_precache_jobs = 0;
+    num_precache_threads = 0;
+    precache_pending = false;
+}
+
 //
 // R_PrecacheLevel
 // Preloads all relevant graphics for the level.
@@ -1280,18 +1720,33 @@ void R_PrecacheLevel (void)
     char*		flatpresent;
     char*		texturepresent;
     char*		spritepresent;
+    byte*		patchlocked;
 
     int			i;
     int			j;
     int			k;
     int			lump;
+    int			numpatches;
+    int			phasetime, flattime, texturetime;
     
     texture_t*		texture;
     thinker_t*		th;
     spriteframe_t*	sf;
 
+    // [crispy] the composites of the last level must be complete
+    R_FinishPrecache ();
+
     if (demoplayback)
 	return;
+
+    //!
+    // @category obscure
+    //
+    // [crispy] Print how long each phase of R_PrecacheLevel() takes.
+    //
+
+    precache_stats = M_ParmExists("-precachestats");
+    precache_start_time = phasetime = I_GetTimeMS();
     
     // Precache flats.
     flatpresent = Z_Malloc(numflats, PU_STATIC, NULL);
@@ -1311,11 +1766,15 @@ void R_PrecacheLevel (void)
 	{
 	    lump = firstflat + i;
 	    flatmemory += lumpinfo[lump]->size;
+	    W_AdviseLumpNum(lump, WAD_ADVICE_WILLNEED);
 	    W_CacheLumpNum(lump, PU_CACHE);
 	}
     }
 
     Z_Free(flatpresent);
+
+    flattime = I_GetTimeMS() - phasetime;
+    phasetime = I_GetTimeMS();
     
     // Precache textures.
     texturepresent = Z_Malloc(numtextures, PU_STATIC, NULL);
@@ -1335,6 +1794,30 @@ void R_PrecacheLevel (void)
     //  a wall texture, with an episode dependend
     //  name.
     texturepresent[skytexture] = 1;
+
+    // [crispy] composites that are still cached from an earlier level
+    // do not need to be built again
+    num_precache_jobs = 0;
+    numpatches = 0;
+    for (i=0 ; i<numtextures ; i++)
+    {
+	if (texturepresent[i] && !texturecomposite[i])
+	{
+	    num_precache_jobs++;
+	    numpatches += textures[i]->patchcount;
+	}
+    }
+
+    precache_jobs = I_Realloc(NULL, num_precache_jobs * sizeof(*precache_jobs));
+    precache_patches = I_Realloc(NULL, numpatches * sizeof(*precache_patches));
+    num_precache_jobs = 0;
+    numpatches = 0;
+
+    // [crispy] patches that are locked with PU_STATIC for a worker must
+    // not be cached again with PU_CACHE, which would make them purgable
+    // while the worker is still reading them
+    patchlocked = Z_Malloc(numlumps, PU_STATIC, NULL);
+    memset (patchlocked, 0, numlumps);
 	
     texturememory = 0;
     for (i=0 ; i<numtextures ; i++)
@@ -1342,20 +1825,44 @@ void R_PrecacheLevel (void)
 	if (!texturepresent[i])
 	    continue;
 
-	// [crispy] precache composite textures
-	R_GenerateComposite(i);
-
 	texture = textures[i];
 	
 	for (j=0 ; j<texture->patchcount ; j++)
 	{
 	    lump = texture->patches[j].patch;
 	    texturememory += lumpinfo[lump]->size;
-	    W_CacheLumpNum(lump , PU_CACHE);
+	    W_AdviseLumpNum(lump, WAD_ADVICE_WILLNEED);
 	}
+
+	// [crispy] precache composite textures
+	if (texturecomposite[i])
+	{
+	    for (j=0 ; j<texture->patchcount ; j++)
+	    {
+		lump = texture->patches[j].patch;
+		if (!patchlocked[lump])
+		    W_CacheLumpNum(lump, PU_CACHE);
+	    }
+	    continue;
+	}
+
+	Z_Malloc (texturecompositesize[i], PU_STATIC, &texturecomposite[i]);
+
+	precache_jobs[num_precache_jobs].texnum = i;
+	precache_jobs[num_precache_jobs].patches = precache_patches + numpatches;
+	R_CacheTexturePatches(i, precache_jobs[num_precache_jobs].patches);
+	for (j=0 ; j<texture->patchcount ; j++)
+	    patchlocked[texture->patches[j].patch] = 1;
+	num_precache_jobs++;
+	numpatches += texture->patchcount;
     }
 
     Z_Free(texturepresent);
+
+    R_StartPrecacheWorkers();
+
+    texturetime = I_GetTimeMS() - phasetime;
+    phasetime = I_GetTimeMS();
     
     // Precache sprites.
     spritepresent = Z_Malloc(numsprites, PU_STATIC, NULL);
@@ -1380,12 +1887,21 @@ void R_PrecacheLevel (void)
 	    {
 		lump = firstspritelump + sf->lump[k];
 		spritememory += lumpinfo[lump]->size;
-		W_CacheLumpNum(lump , PU_CACHE);
+		W_AdviseLumpNum(lump, WAD_ADVICE_WILLNEED);
+		if (!patchlocked[lump])
+		    W_CacheLumpNum(lump , PU_CACHE);
 	    }
 	}
     }
 
     Z_Free(spritepresent);
+    Z_Free(patchlocked);
+
+    if (precache_stats)
+    {
+	printf("R_PrecacheLevel: flats %d ms, textures %d ms, sprites %d ms\n",
+	       flattime, texturetime, I_GetTimeMS() - phasetime);
+    }
 }
 
 
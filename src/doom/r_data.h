@@ -39,6 +39,7 @@ R_GetColumn
 // I/O, setting up the stuff.
 void R_InitData (void);
 void R_PrecacheLevel (void);
+void R_FinishPrecache (void);
 
 
 // Retrieval.
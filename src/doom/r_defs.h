@@ -470,18 +470,14 @@ typedef struct
   int			lightlevel;
   int			minx;
   int			maxx;
+  int			next; // [crispy] next visplane in the same hash bucket
   
   // leave pads for [minx-1]/[maxx+1]
   
-  unsigned int		pad1; // [crispy] hires / 32-bit integer math
-  // Here lies the rub for all
-  //  dynamic resize/change of resolution.
-  unsigned int		top[MAXWIDTH]; // [crispy] hires / 32-bit integer math
-  unsigned int		pad2; // [crispy] hires / 32-bit integer math
-  unsigned int		pad3; // [crispy] hires / 32-bit integer math
-  // See above.
-  unsigned int		bottom[MAXWIDTH]; // [crispy] hires / 32-bit integer math
-  unsigned int		pad4; // [crispy] hires / 32-bit integer math
+  // [crispy] allocated for the current resolution,
+  //  see R_RaiseVisplanes()
+  unsigned int		*top; // [crispy] hires / 32-bit integer math
+  unsigned int		*bottom; // [crispy] hires / 32-bit integer math
 
 } visplane_t;
 
@@ -21,10 +21,30 @@
 
 
 
+#include <stdlib.h>
+
+// [crispy] vector instructions for the SIMD drawers
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HAVE_SIMD_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_SIMD_AVX2
+#include <immintrin.h>
+#endif
+// [crispy] the NEON drawers have not been verified against the plain
+// drawers yet, so they are only built when asked for
+#elif defined(CRISPY_SIMD_NEON) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define HAVE_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
 #include "doomdef.h"
 #include "deh_main.h"
 
 #include "i_system.h"
+#include "i_thread.h"
+#include "i_timer.h" // [crispy] I_GetTimeUS()
+#include "m_argv.h"
 #include "z_zone.h"
 #include "w_wad.h"
 
@@ -42,7 +62,7 @@
 //#define MAXHEIGHT			832
 
 // status bar height at bottom of screen
-#define SBARHEIGHT		(32 << crispy->hires)
+#define SBARHEIGHT		(32 * hires_scale)
 
 //
 // All drawing to the view buffer is accomplished in this file.
@@ -60,8 +80,8 @@ int		scaledviewwidth;
 int		viewheight;
 int		viewwindowx;
 int		viewwindowy; 
-pixel_t*		ylookup[MAXHEIGHT];
-int		columnofs[MAXWIDTH]; 
+pixel_t**		ylookup; // [crispy] allocated for the current resolution
+int*		columnofs; 
 
 // Color tables for different players,
 //  translate a limited part to another
@@ -73,22 +93,23 @@ byte		translations[3][256];
 // surrounding background.
 
 static pixel_t *background_buffer = NULL;
+static int background_scale; // [crispy]
 
 
 //
 // R_DrawColumn
 // Source is the top of the column to scale.
 //
-lighttable_t*		dc_colormap[2]; // [crispy] brightmaps
-int			dc_x; 
-int			dc_yl; 
-int			dc_yh; 
-fixed_t			dc_iscale; 
-fixed_t			dc_texturemid;
-int			dc_texheight; // [crispy] Tutti-Frutti fix
+THREADLOCAL lighttable_t*	dc_colormap[2]; // [crispy] brightmaps
+THREADLOCAL int		dc_x; 
+THREADLOCAL int		dc_yl; 
+THREADLOCAL int		dc_yh; 
+THREADLOCAL fixed_t		dc_iscale; 
+THREADLOCAL fixed_t		dc_texturemid;
+THREADLOCAL int		dc_texheight; // [crispy] Tutti-Frutti fix
 
 // first pixel in a column (possibly virtual) 
-byte*			dc_source;		
+THREADLOCAL byte*		dc_source;		
 
 // just for profiling 
 int			dccount;
@@ -335,7 +356,7 @@ int	fuzzoffset[FUZZTABLE] =
     FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF 
 }; 
 
-int	fuzzpos = 0; 
+static THREADLOCAL int	fuzzpos = 0; 
 
 // [crispy] draw fuzz effect independent of rendering frame rate
 static int fuzzpos_tic;
@@ -517,7 +538,7 @@ void R_DrawFuzzColumnLow (void)
 //  of the BaronOfHell, the HellKnight, uses
 //  identical sprites, kinda brightened up.
 //
-byte*	dc_translation;
+THREADLOCAL byte*	dc_translation;
 byte*	translationtables;
 
 void R_DrawTranslatedColumn (void) 
@@ -745,20 +766,20 @@ void R_InitTranslationTables (void)
 // In consequence, flats are not stored by column (like walls),
 //  and the inner loop has to step in texture space u and v.
 //
-int			ds_y; 
-int			ds_x1; 
-int			ds_x2;
+THREADLOCAL int		ds_y; 
+THREADLOCAL int		ds_x1; 
+THREADLOCAL int		ds_x2;
 
-lighttable_t*		ds_colormap[2];
-byte*			ds_brightmap;
+THREADLOCAL lighttable_t*	ds_colormap[2];
+THREADLOCAL byte*		ds_brightmap;
 
-fixed_t			ds_xfrac; 
-fixed_t			ds_yfrac; 
-fixed_t			ds_xstep; 
-fixed_t			ds_ystep;
+THREADLOCAL fixed_t		ds_xfrac; 
+THREADLOCAL fixed_t		ds_yfrac; 
+THREADLOCAL fixed_t		ds_xstep; 
+THREADLOCAL fixed_t		ds_ystep;
 
 // start of a 64*64 tile image 
-byte*			ds_source;	
+THREADLOCAL byte*		ds_source;	
 
 // just for profiling
 int			dscount;
@@ -960,6 +981,595 @@ void R_DrawSpanLow (void)
     } while (count--);
 }
 
+// [crispy] SIMD span drawer.  The flat coordinates of a batch of pixels
+// are stepped and masked in vector registers, then the texel, brightmap
+// and colormap lookups are done one pixel after another, just like in
+// R_DrawSpan().  The integer math is the same, so the output is
+// bit-exact.  The lookups themselves are not vectorized, as a gather
+// would read past the end of flats and colormaps.  The columns are
+// left to the plain drawers, as stepping a single coordinate in vector
+// registers does not pay off.
+
+// Number of pixels per batch, a multiple of the widest vector.
+#define SIMD_BATCH 64
+
+boolean simddrawers = false;
+
+// spot[i] = (((yfrac + i * ystep) >> 10) & 0x0fc0)
+//         | (((xfrac + i * xstep) >> 16) & 0x3f)
+static void (*spanspots) (int *spot, unsigned xfrac, unsigned yfrac,
+                          unsigned xstep, unsigned ystep, int count);
+
+#ifdef HAVE_SIMD_SSE2
+static void R_SpanSpots_SSE2 (int *spot, unsigned xfrac, unsigned yfrac,
+                              unsigned xstep, unsigned ystep, int count)
+{
+    const __m128i xm = _mm_set1_epi32(0x3f);
+    const __m128i ym = _mm_set1_epi32(0x0fc0);
+    const __m128i xs = _mm_set1_epi32(xstep * 4);
+    const __m128i ys = _mm_set1_epi32(ystep * 4);
+    __m128i x = _mm_setr_epi32(xfrac, xfrac + xstep,
+                               xfrac + xstep * 2, xfrac + xstep * 3);
+    __m128i y = _mm_setr_epi32(yfrac, yfrac + ystep,
+                               yfrac + ystep * 2, yfrac + ystep * 3);
+    int i;
+
+    for (i = 0; i < count; i += 4)
+    {
+	_mm_storeu_si128((__m128i *) &spot[i],
+	                 _mm_or_si128(_mm_and_si128(_mm_srai_epi32(y, 10), ym),
+	                              _mm_and_si128(_mm_srai_epi32(x, 16), xm)));
+	x = _mm_add_epi32(x, xs);
+	y = _mm_add_epi32(y, ys);
+    }
+}
+#endif
+
+#ifdef HAVE_SIMD_AVX2
+__attribute__((target("avx2")))
+static void R_SpanSpots_AVX2 (int *spot, unsigned xfrac, unsigned yfrac,
+                              unsigned xstep, unsigned ystep, int count)
+{
+    const __m256i n = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i xm = _mm256_set1_epi32(0x3f);
+    const __m256i ym = _mm256_set1_epi32(0x0fc0);
+    const __m256i xs = _mm256_set1_epi32(xstep * 8);
+    const __m256i ys = _mm256_set1_epi32(ystep * 8);
+    __m256i x = _mm256_add_epi32(_mm256_set1_epi32(xfrac),
+                                 _mm256_mullo_epi32(_mm256_set1_epi32(xstep), n));
+    __m256i y = _mm256_add_epi32(_mm256_set1_epi32(yfrac),
+                                 _mm256_mullo_epi32(_mm256_set1_epi32(ystep), n));
+    int i;
+
+    for (i = 0; i < count; i += 8)
+    {
+	_mm256_storeu_si256((__m256i *) &spot[i],
+	                    _mm256_or_si256(_mm256_and_si256(_mm256_srai_epi32(y, 10), ym),
+	                                    _mm256_and_si256(_mm256_srai_epi32(x, 16), xm)));
+	x = _mm256_add_epi32(x, xs);
+	y = _mm256_add_epi32(y, ys);
+    }
+}
+#endif
+
+#ifdef HAVE_SIMD_NEON
+static void R_SpanSpots_NEON (int *spot, unsigned xfrac, unsigned yfrac,
+                              unsigned xstep, unsigned ystep, int count)
+{
+    const uint32_t n[4] = {0, 1, 2, 3};
+    const int32x4_t xm = vdupq_n_s32(0x3f);
+    const int32x4_t ym = vdupq_n_s32(0x0fc0);
+    const int32x4_t xs = vreinterpretq_s32_u32(vdupq_n_u32(xstep * 4));
+    const int32x4_t ys = vreinterpretq_s32_u32(vdupq_n_u32(ystep * 4));
+    int32x4_t x = vreinterpretq_s32_u32(vmlaq_n_u32(vdupq_n_u32(xfrac),
+                                                    vld1q_u32(n), xstep));
+    int32x4_t y = vreinterpretq_s32_u32(vmlaq_n_u32(vdupq_n_u32(yfrac),
+                                                    vld1q_u32(n), ystep));
+    int i;
+
+    for (i = 0; i < count; i += 4)
+    {
+	vst1q_s32(&spot[i], vorrq_s32(vandq_s32(vshrq_n_s32(y, 10), ym),
+	                              vandq_s32(vshrq_n_s32(x, 16), xm)));
+	x = vaddq_s32(x, xs);
+	y = vaddq_s32(y, ys);
+    }
+}
+#endif
+
+//
+// R_InitSIMDDrawers
+// Pick the widest vector instructions the CPU supports.
+//
+void R_InitSIMDDrawers (void)
+{
+    //!
+    // @category video
+    //
+    // [crispy] Do not use the SIMD span drawer.
+    //
+
+    if (M_ParmExists("-nosimd"))
+    {
+	return;
+    }
+
+#ifdef HAVE_SIMD_AVX2
+    if (__builtin_cpu_supports("avx2"))
+    {
+	spanspots = R_SpanSpots_AVX2;
+	simddrawers = true;
+	return;
+    }
+#endif
+
+#if defined(HAVE_SIMD_SSE2)
+    spanspots = R_SpanSpots_SSE2;
+    simddrawers = true;
+#elif defined(HAVE_SIMD_NEON)
+    spanspots = R_SpanSpots_NEON;
+    simddrawers = true;
+#endif
+}
+
+void R_DrawSpanSIMD (void)
+{
+    int			count;
+    int			i, n;
+    pixel_t*		dest;
+    unsigned		xfrac, yfrac;
+    int			spot[SIMD_BATCH];
+
+#ifdef RANGECHECK
+    if (ds_x2 < ds_x1
+	|| ds_x1<0
+	|| ds_x2>=SCREENWIDTH
+	|| (unsigned)ds_y>SCREENHEIGHT)
+    {
+	I_Error( "R_DrawSpanSIMD: %i to %i at %i",
+		 ds_x1,ds_x2,ds_y);
+    }
+#endif
+
+    dest = ylookup[ds_y] + columnofs[ds_x1];
+
+    count = ds_x2 - ds_x1 + 1;
+    xfrac = ds_xfrac;
+    yfrac = ds_yfrac;
+
+    while (count > 0)
+    {
+	n = MIN(count, SIMD_BATCH);
+	spanspots(spot, xfrac, yfrac, ds_xstep, ds_ystep, n);
+
+	for (i = 0; i < n; i++)
+	{
+	    const byte source = ds_source[spot[i]];
+	    dest[i] = ds_colormap[ds_brightmap[source]][source];
+	}
+
+	dest += n;
+	xfrac += n * (unsigned) ds_xstep;
+	yfrac += n * (unsigned) ds_ystep;
+	count -= n;
+    }
+
+    ds_xfrac = xfrac;
+    ds_yfrac = yfrac;
+}
+
+//
+// R_BenchDrawers
+// [crispy] Time the column and span drawers by filling the view with
+//  each of them, and print the time taken per pixel.
+//
+#define BENCH_FRAMES 100
+
+void R_BenchDrawers (void)
+{
+    static const struct
+    {
+	const char *name;
+	void (*func) (void);
+	boolean span;
+    } drawers[] = {
+	{"R_DrawColumn",           R_DrawColumn,           false},
+	{"R_DrawTranslatedColumn", R_DrawTranslatedColumn, false},
+	{"R_DrawTLColumn",         R_DrawTLColumn,         false},
+	{"R_DrawSpan",             R_DrawSpan,             true},
+	{"R_DrawSpanSIMD",         R_DrawSpanSIMD,         true},
+    };
+    static byte source[64*64];
+    static byte nobrightmap[256];
+    uint64_t starttime, elapsed;
+    int i, j, frame;
+
+    for (i = 0; i < (int) arrlen(source); i++)
+    {
+	source[i] = i * 7 + (i >> 6);
+    }
+
+    dc_source = ds_source = source;
+    dc_colormap[0] = dc_colormap[1] = colormaps;
+    ds_colormap[0] = ds_colormap[1] = colormaps;
+    dc_brightmap = ds_brightmap = nobrightmap;
+    dc_translation = colormaps;
+    dc_texheight = 64;
+
+    printf("R_BenchDrawers: %dx%d view, %d frames\n",
+           viewwidth, viewheight, BENCH_FRAMES);
+
+    for (i = 0; i < (int) arrlen(drawers); i++)
+    {
+	if (drawers[i].func == R_DrawSpanSIMD && !simddrawers)
+	{
+	    continue;
+	}
+
+	starttime = I_GetTimeUS();
+
+	for (frame = 0; frame < BENCH_FRAMES; frame++)
+	{
+	    if (drawers[i].span)
+	    {
+		for (j = 0; j < viewheight; j++)
+		{
+		    ds_y = j;
+		    ds_x1 = 0;
+		    ds_x2 = viewwidth - 1;
+		    ds_xfrac = frame << FRACBITS;
+		    ds_yfrac = j << FRACBITS;
+		    ds_xstep = FRACUNIT / 3;
+		    ds_ystep = FRACUNIT / 7;
+		    drawers[i].func();
+		}
+	    }
+	    else
+	    {
+		for (j = 0; j < viewwidth; j++)
+		{
+		    dc_x = j;
+		    dc_yl = 0;
+		    dc_yh = viewheight - 1;
+		    dc_iscale = FRACUNIT / 2;
+		    dc_texturemid = (frame + j) << FRACBITS;
+		    drawers[i].func();
+		}
+	    }
+	}
+
+	elapsed = I_GetTimeUS() - starttime;
+
+	printf("  %-24s %6.2f ns/pixel\n", drawers[i].name,
+	       elapsed * 1000.0 / ((double) BENCH_FRAMES * viewwidth * viewheight));
+    }
+}
+
+// [crispy] Threaded rendering.  The BSP traversal and the setup of each
+// column and span stay on the main thread, but instead of drawing,
+// the drawers record what they would draw in a queue.  Then all render
+// threads go through the queue in order, each drawing only the part
+// that falls into its own strip of view columns.  As every pixel is
+// drawn by exactly one thread and in the original order, the output is
+// the same as when drawing straight away.
+
+#define MAX_DRAW_THREADS 16
+
+typedef struct
+{
+    void (*func) (void);
+    boolean span;
+
+    lighttable_t *colormap[2];
+    byte *brightmap;
+    byte *source;
+
+    union
+    {
+	struct
+	{
+	    int x, yl, yh;
+	    fixed_t iscale, texturemid;
+	    int texheight;
+	    byte *translation;
+	    int fuzzpos;
+	} c;
+
+	struct
+	{
+	    int y, x1, x2;
+	    fixed_t xfrac, yfrac, xstep, ystep;
+	} s;
+    } u;
+} drawcmd_t;
+
+static drawcmd_t *drawcmds;
+static int num_drawcmds, max_drawcmds;
+
+static int num_draw_threads;
+static i_semaphore_t *draw_start[MAX_DRAW_THREADS];
+static i_semaphore_t *draw_done;
+
+// the real drawers behind the queueing ones
+static void (*drawcolfunc) (void);
+static void (*drawfuzzcolfunc) (void);
+static void (*drawtranscolfunc) (void);
+static void (*drawtlcolfunc) (void);
+static void (*drawspanfunc) (void);
+
+static drawcmd_t *R_NewDrawCmd (void (*func) (void), boolean span)
+{
+    drawcmd_t *cmd;
+
+    if (num_drawcmds == max_drawcmds)
+    {
+	max_drawcmds = max_drawcmds ? 2 * max_drawcmds : 4096;
+	drawcmds = I_Realloc(drawcmds, max_drawcmds * sizeof(*drawcmds));
+    }
+
+    cmd = &drawcmds[num_drawcmds++];
+    cmd->func = func;
+    cmd->span = span;
+
+    return cmd;
+}
+
+static void R_QueueColumnFunc (void (*func) (void))
+{
+    drawcmd_t *cmd = R_NewDrawCmd(func, false);
+
+    cmd->colormap[0] = dc_colormap[0];
+    cmd->colormap[1] = dc_colormap[1];
+    cmd->brightmap = dc_brightmap;
+    cmd->source = dc_source;
+    cmd->u.c.x = dc_x;
+    cmd->u.c.yl = dc_yl;
+    cmd->u.c.yh = dc_yh;
+    cmd->u.c.iscale = dc_iscale;
+    cmd->u.c.texturemid = dc_texturemid;
+    cmd->u.c.texheight = dc_texheight;
+    cmd->u.c.translation = dc_translation;
+    cmd->u.c.fuzzpos = fuzzpos;
+}
+
+static void R_QueueColumn (void)
+{
+    R_QueueColumnFunc(drawcolfunc);
+}
+
+static void R_QueueTranslatedColumn (void)
+{
+    R_QueueColumnFunc(drawtranscolfunc);
+}
+
+static void R_QueueTLColumn (void)
+{
+    R_QueueColumnFunc(drawtlcolfunc);
+}
+
+static void R_QueueFuzzColumn (void)
+{
+    R_QueueColumnFunc(drawfuzzcolfunc);
+
+    // Advance the fuzz table position and adjust the borders just as
+    // R_DrawFuzzColumn() would, so that the following columns and the
+    // next frame see the same state.
+    if (!dc_yl)
+	dc_yl = 1;
+
+    if (dc_yh == viewheight-1)
+	dc_yh = viewheight - 2;
+
+    if (dc_yh >= dc_yl)
+	fuzzpos = (fuzzpos + dc_yh - dc_yl + 1) % FUZZTABLE;
+}
+
+static void R_QueueSpan (void)
+{
+    drawcmd_t *cmd = R_NewDrawCmd(drawspanfunc, true);
+
+    cmd->colormap[0] = ds_colormap[0];
+    cmd->colormap[1] = ds_colormap[1];
+    cmd->brightmap = ds_brightmap;
+    cmd->source = ds_source;
+    cmd->u.s.y = ds_y;
+    cmd->u.s.x1 = ds_x1;
+    cmd->u.s.x2 = ds_x2;
+    cmd->u.s.xfrac = ds_xfrac;
+    cmd->u.s.yfrac = ds_yfrac;
+    cmd->u.s.xstep = ds_xstep;
+    cmd->u.s.ystep = ds_ystep;
+}
+
+// Draw the part of the queue that falls into view columns x1 to x2.
+
+static void R_RunDrawCmds (int x1, int x2)
+{
+    const drawcmd_t *cmd, *end = drawcmds + num_drawcmds;
+
+    for (cmd = drawcmds; cmd < end; cmd++)
+    {
+	if (cmd->span)
+	{
+	    int skip;
+
+	    if (cmd->u.s.x2 < x1 || cmd->u.s.x1 > x2)
+		continue;
+
+	    // Step the texture coordinates to the start of the strip.
+	    // This is exact, as they advance by adding the steps.
+	    skip = cmd->u.s.x1 < x1 ? x1 - cmd->u.s.x1 : 0;
+
+	    ds_colormap[0] = cmd->colormap[0];
+	    ds_colormap[1] = cmd->colormap[1];
+	    ds_brightmap = cmd->brightmap;
+	    ds_source = cmd->source;
+	    ds_y = cmd->u.s.y;
+	    ds_x1 = cmd->u.s.x1 + skip;
+	    ds_x2 = cmd->u.s.x2 < x2 ? cmd->u.s.x2 : x2;
+	    ds_xfrac = (unsigned int) cmd->u.s.xfrac
+	             + (unsigned int) skip * (unsigned int) cmd->u.s.xstep;
+	    ds_yfrac = (unsigned int) cmd->u.s.yfrac
+	             + (unsigned int) skip * (unsigned int) cmd->u.s.ystep;
+	    ds_xstep = cmd->u.s.xstep;
+	    ds_ystep = cmd->u.s.ystep;
+	}
+	else
+	{
+	    if (cmd->u.c.x < x1 || cmd->u.c.x > x2)
+		continue;
+
+	    dc_colormap[0] = cmd->colormap[0];
+	    dc_colormap[1] = cmd->colormap[1];
+	    dc_brightmap = cmd->brightmap;
+	    dc_source = cmd->source;
+	    dc_x = cmd->u.c.x;
+	    dc_yl = cmd->u.c.yl;
+	    dc_yh = cmd->u.c.yh;
+	    dc_iscale = cmd->u.c.iscale;
+	    dc_texturemid = cmd->u.c.texturemid;
+	    dc_texheight = cmd->u.c.texheight;
+	    dc_translation = cmd->u.c.translation;
+	    fuzzpos = cmd->u.c.fuzzpos;
+	}
+
+	cmd->func();
+    }
+}
+
+// The view is split into one strip per thread.
+
+static void R_DrawStrip (int strip)
+{
+    const int x1 = strip * viewwidth / num_draw_threads;
+    const int x2 = (strip + 1) * viewwidth / num_draw_threads - 1;
+
+    R_RunDrawCmds(x1, x2);
+}
+
+static int R_DrawThread (void *data)
+{
+    const int strip = (intptr_t) data;
+
+    while (true)
+    {
+	I_SemaphoreWait(draw_start[strip]);
+	R_DrawStrip(strip);
+	I_SemaphorePost(draw_done);
+    }
+
+    return 0;
+}
+
+//
+// R_InitDrawThreads
+//
+void R_InitDrawThreads (void)
+{
+    int i, p;
+
+    //!
+    // @arg <n>
+    // @category video
+    //
+    // [crispy] Draw the view with n threads, each drawing a vertical
+    // strip of it.  The output is the same as with a single thread.
+    //
+
+    p = M_CheckParmWithArgs("-renderthreads", 1);
+
+    if (p == 0)
+    {
+	return;
+    }
+
+    num_draw_threads = atoi(myargv[p + 1]);
+    num_draw_threads = BETWEEN(1, MAX_DRAW_THREADS, num_draw_threads);
+
+    if (num_draw_threads == 1)
+    {
+	num_draw_threads = 0;
+	return;
+    }
+
+    draw_done = I_CreateSemaphore(0);
+
+    if (draw_done == NULL)
+    {
+	num_draw_threads = 0;
+	return;
+    }
+
+    // The main thread draws strip 0 itself.
+    for (i = 1; i < num_draw_threads; i++)
+    {
+	draw_start[i] = I_CreateSemaphore(0);
+
+	if (draw_start[i] == NULL
+	 || I_CreateThread(R_DrawThread, "render", (void *) (intptr_t) i) == NULL)
+	{
+	    I_Error("R_InitDrawThreads: Failed to start render thread %d", i);
+	}
+    }
+
+    // Pending draws may refer to purgable textures, so draw them before
+    // the zone throws anything out.
+    Z_SetPurgeHook(R_FlushDrawQueue);
+}
+
+//
+// R_QueueDrawers
+// Called after the drawers are set up for the view size, to put the
+// queueing ones in their place.
+//
+void R_QueueDrawers (void)
+{
+    if (num_draw_threads == 0)
+    {
+	return;
+    }
+
+    drawcolfunc = basecolfunc;
+    drawfuzzcolfunc = fuzzcolfunc;
+    drawtranscolfunc = transcolfunc;
+    drawtlcolfunc = tlcolfunc;
+    drawspanfunc = spanfunc;
+
+    colfunc = basecolfunc = R_QueueColumn;
+    fuzzcolfunc = R_QueueFuzzColumn;
+    transcolfunc = R_QueueTranslatedColumn;
+    tlcolfunc = R_QueueTLColumn;
+    spanfunc = R_QueueSpan;
+}
+
+//
+// R_FlushDrawQueue
+// Draw everything that has been queued so far.
+//
+void R_FlushDrawQueue (void)
+{
+    int i;
+
+    if (num_drawcmds == 0)
+    {
+	return;
+    }
+
+    for (i = 1; i < num_draw_threads; i++)
+    {
+	I_SemaphorePost(draw_start[i]);
+    }
+
+    R_DrawStrip(0);
+
+    for (i = 1; i < num_draw_threads; i++)
+    {
+	I_SemaphoreWait(draw_done);
+    }
+
+    num_drawcmds = 0;
+}
+
 //
 // R_InitBuffer 
 // Creats lookup tables that avoid
@@ -974,6 +1584,10 @@ R_InitBuffer
 { 
     int		i; 
 
+    // [crispy] the resolution may have changed
+    ylookup = I_Realloc(ylookup, SCREENHEIGHT * sizeof(*ylookup));
+    columnofs = I_Realloc(columnofs, SCREENWIDTH * sizeof(*columnofs));
+
     // Handle resize,
     //  e.g. smaller view windows
     //  with border and/or status bar.
@@ -1033,12 +1647,21 @@ void R_FillBackScreen (void)
 	return;
     }
 
+    // [crispy] re-allocate the background buffer if the resolution changed
+
+    if (background_buffer != NULL && background_scale != hires_scale)
+    {
+        Z_Free(background_buffer);
+        background_buffer = NULL;
+    }
+
     // Allocate the background buffer if necessary
 	
     if (background_buffer == NULL)
     {
         background_buffer = Z_Malloc(SCREENWIDTH * (SCREENHEIGHT - SBARHEIGHT) * sizeof(*background_buffer),
                                      PU_STATIC, NULL);
+        background_scale = hires_scale;
     }
 
     if (gamemode == commercial)
@@ -1070,36 +1693,36 @@ void R_FillBackScreen (void)
 
     patch = W_CacheLumpName(DEH_String("brdr_t"),PU_CACHE);
 
-    for (x=0 ; x<(scaledviewwidth >> crispy->hires) ; x+=8)
-	V_DrawPatch((viewwindowx >> crispy->hires)+x, (viewwindowy >> crispy->hires)-8, patch);
+    for (x=0 ; x<(scaledviewwidth / hires_scale) ; x+=8)
+	V_DrawPatch((viewwindowx / hires_scale)+x, (viewwindowy / hires_scale)-8, patch);
     patch = W_CacheLumpName(DEH_String("brdr_b"),PU_CACHE);
 
-    for (x=0 ; x<(scaledviewwidth >> crispy->hires) ; x+=8)
-	V_DrawPatch((viewwindowx >> crispy->hires)+x, (viewwindowy >> crispy->hires)+(viewheight >> crispy->hires), patch);
+    for (x=0 ; x<(scaledviewwidth / hires_scale) ; x+=8)
+	V_DrawPatch((viewwindowx / hires_scale)+x, (viewwindowy / hires_scale)+(viewheight / hires_scale), patch);
     patch = W_CacheLumpName(DEH_String("brdr_l"),PU_CACHE);
 
-    for (y=0 ; y<(viewheight >> crispy->hires) ; y+=8)
-	V_DrawPatch((viewwindowx >> crispy->hires)-8, (viewwindowy >> crispy->hires)+y, patch);
+    for (y=0 ; y<(viewheight / hires_scale) ; y+=8)
+	V_DrawPatch((viewwindowx / hires_scale)-8, (viewwindowy / hires_scale)+y, patch);
     patch = W_CacheLumpName(DEH_String("brdr_r"),PU_CACHE);
 
-    for (y=0 ; y<(viewheight >> crispy->hires) ; y+=8)
-	V_DrawPatch((viewwindowx >> crispy->hires)+(scaledviewwidth >> crispy->hires), (viewwindowy >> crispy->hires)+y, patch);
+    for (y=0 ; y<(viewheight / hires_scale) ; y+=8)
+	V_DrawPatch((viewwindowx / hires_scale)+(scaledviewwidth / hires_scale), (viewwindowy / hires_scale)+y, patch);
 
     // Draw beveled edge. 
-    V_DrawPatch((viewwindowx >> crispy->hires)-8,
-                (viewwindowy >> crispy->hires)-8,
+    V_DrawPatch((viewwindowx / hires_scale)-8,
+                (viewwindowy / hires_scale)-8,
                 W_CacheLumpName(DEH_String("brdr_tl"),PU_CACHE));
     
-    V_DrawPatch((viewwindowx >> crispy->hires)+(scaledviewwidth >> crispy->hires),
-                (viewwindowy >> crispy->hires)-8,
+    V_DrawPatch((viewwindowx / hires_scale)+(scaledviewwidth / hires_scale),
+                (viewwindowy / hires_scale)-8,
                 W_CacheLumpName(DEH_String("brdr_tr"),PU_CACHE));
     
-    V_DrawPatch((viewwindowx >> crispy->hires)-8,
-                (viewwindowy >> crispy->hires)+(viewheight >> crispy->hires),
+    V_DrawPatch((viewwindowx / hires_scale)-8,
+                (viewwindowy / hires_scale)+(viewheight / hires_scale),
                 W_CacheLumpName(DEH_String("brdr_bl"),PU_CACHE));
     
-    V_DrawPatch((viewwindowx >> crispy->hires)+(scaledviewwidth >> crispy->hires),
-                (viewwindowy >> crispy->hires)+(viewheight >> crispy->hires),
+    V_DrawPatch((viewwindowx / hires_scale)+(scaledviewwidth / hires_scale),
+                (viewwindowy / hires_scale)+(viewheight / hires_scale),
                 W_CacheLumpName(DEH_String("brdr_br"),PU_CACHE));
 
     V_RestoreBuffer();
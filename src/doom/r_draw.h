@@ -22,18 +22,19 @@
 
 
 
+// [crispy] the drawing state is per thread, for the render threads
 
-extern lighttable_t*	dc_colormap[2];
-extern int		dc_x;
-extern int		dc_yl;
-extern int		dc_yh;
-extern fixed_t		dc_iscale;
-extern fixed_t		dc_texturemid;
-extern int		dc_texheight;
-extern byte*		dc_brightmap;
+extern THREADLOCAL lighttable_t*	dc_colormap[2];
+extern THREADLOCAL int		dc_x;
+extern THREADLOCAL int		dc_yl;
+extern THREADLOCAL int		dc_yh;
+extern THREADLOCAL fixed_t		dc_iscale;
+extern THREADLOCAL fixed_t		dc_texturemid;
+extern THREADLOCAL int		dc_texheight;
+extern THREADLOCAL byte*		dc_brightmap;
 
 // first pixel in a column
-extern byte*		dc_source;		
+extern THREADLOCAL byte*		dc_source;		
 
 
 // The span blitting interface.
@@ -64,23 +65,23 @@ R_VideoErase
 ( unsigned	ofs,
   int		count );
 
-extern int		ds_y;
-extern int		ds_x1;
-extern int		ds_x2;
+extern THREADLOCAL int		ds_y;
+extern THREADLOCAL int		ds_x1;
+extern THREADLOCAL int		ds_x2;
 
-extern lighttable_t*	ds_colormap[2];
-extern byte*		ds_brightmap;
+extern THREADLOCAL lighttable_t*	ds_colormap[2];
+extern THREADLOCAL byte*		ds_brightmap;
 
-extern fixed_t		ds_xfrac;
-extern fixed_t		ds_yfrac;
-extern fixed_t		ds_xstep;
-extern fixed_t		ds_ystep;
+extern THREADLOCAL fixed_t		ds_xfrac;
+extern THREADLOCAL fixed_t		ds_yfrac;
+extern THREADLOCAL fixed_t		ds_xstep;
+extern THREADLOCAL fixed_t		ds_ystep;
 
 // start of a 64*64 tile image
-extern byte*		ds_source;		
+extern THREADLOCAL byte*		ds_source;		
 
 extern byte*		translationtables;
-extern byte*		dc_translation;
+extern THREADLOCAL byte*		dc_translation;
 
 
 // Span blitting for rows, floor/ceiling.
@@ -96,6 +97,21 @@ R_InitBuffer
 ( int		width,
   int		height );
 
+// [crispy] SIMD version of R_DrawSpan(), used if the CPU supports it.
+extern boolean	simddrawers;
+void	R_InitSIMDDrawers (void);
+void	R_DrawSpanSIMD (void);
+
+// [crispy] time the drawers, for -benchdrawers
+void	R_BenchDrawers (void);
+
+// [crispy] threaded rendering: with -renderthreads, the drawers are
+// replaced with ones that queue up the columns and spans, which are
+// then drawn by all threads at once, each into its own strip of the view.
+void	R_InitDrawThreads (void);
+void	R_QueueDrawers (void);
+void	R_FlushDrawQueue (void);
+
 
 // Initialize color translation tables,
 //  for player rendering etc.
@@ -34,6 +34,7 @@
 #include "m_menu.h"
 
 #include "i_system.h" // [crispy] I_Realloc()
+#include "i_timer.h" // [crispy] I_GetTimeUS()
 #include "p_local.h" // [crispy] MLOOKUNIT
 #include "r_local.h"
 #include "r_sky.h"
@@ -98,7 +99,7 @@ int			viewangletox[FINEANGLES/2];
 // The xtoviewangleangle[] table maps a screen pixel
 // to the lowest viewangle that maps back to x ranges
 // from clipangle to -clipangle.
-angle_t			xtoviewangle[MAXWIDTH+1];
+angle_t*		xtoviewangle; // [crispy] allocated for the current resolution
 
 // [crispy] parameterized for smooth diminishing lighting
 lighttable_t***		scalelight = NULL;
@@ -784,6 +785,29 @@ R_SetViewSize
 }
 
 
+//
+// R_InitScreenBuffers
+// [crispy] (Re-)allocate the renderer buffers
+//  whenever the resolution changes.
+//
+static void R_InitScreenBuffers (void)
+{
+    static int width, height;
+
+    if (width == SCREENWIDTH && height == SCREENHEIGHT)
+	return;
+
+    width = SCREENWIDTH;
+    height = SCREENHEIGHT;
+
+    xtoviewangle = I_Realloc(xtoviewangle, (SCREENWIDTH + 1) * sizeof(*xtoviewangle));
+
+    R_InitClipSegs ();
+    R_InitPlaneBuffers ();
+    R_InitSpriteBuffers ();
+}
+
+
 //
 // R_ExecuteSetViewSize
 //
@@ -798,6 +822,8 @@ void R_ExecuteSetViewSize (void)
 
     setsizeneeded = false;
 
+    R_InitScreenBuffers ();
+
     if (setblocks >= 11) // [crispy] Crispy HUD
     {
 	scaledviewwidth = SCREENWIDTH;
@@ -805,8 +831,8 @@ void R_ExecuteSetViewSize (void)
     }
     else
     {
-	scaledviewwidth = (setblocks*32)<<crispy->hires;
-	viewheight = ((setblocks*168/10)&~7)<<crispy->hires;
+	scaledviewwidth = (setblocks*32) * hires_scale;
+	viewheight = ((setblocks*168/10)&~7) * hires_scale;
     }
     
     detailshift = setdetail;
@@ -824,7 +850,8 @@ void R_ExecuteSetViewSize (void)
 	fuzzcolfunc = R_DrawFuzzColumn;
 	transcolfunc = R_DrawTranslatedColumn;
 	tlcolfunc = R_DrawTLColumn;
-	spanfunc = R_DrawSpan;
+	// [crispy] SIMD span drawer
+	spanfunc = simddrawers ? R_DrawSpanSIMD : R_DrawSpan;
     }
     else
     {
@@ -835,6 +862,9 @@ void R_ExecuteSetViewSize (void)
 	spanfunc = R_DrawSpanLow;
     }
 
+    // [crispy] threaded rendering
+    R_QueueDrawers ();
+
     R_InitBuffer (scaledviewwidth, viewheight);
 	
     R_InitTextureMapping ();
@@ -855,7 +885,7 @@ void R_ExecuteSetViewSize (void)
 	const fixed_t num = (viewwidth<<detailshift)/2*FRACUNIT;
 	for (j = 0; j < LOOKDIRS; j++)
 	{
-	dy = ((i-(viewheight/2 + ((j-LOOKDIRMIN) << crispy->hires) * (screenblocks < 11 ? screenblocks : 11) / 10))<<FRACBITS)+FRACUNIT/2;
+	dy = ((i-(viewheight/2 + ((j-LOOKDIRMIN) * hires_scale) * (screenblocks < 11 ? screenblocks : 11) / 10))<<FRACBITS)+FRACUNIT/2;
 	dy = abs(dy);
 	yslopes[j][i] = FixedDiv (num, dy);
 	}
@@ -916,6 +946,8 @@ void R_Init (void)
     R_InitSkyMap ();
     R_InitTranslationTables ();
     printf (".");
+    R_InitSIMDDrawers ();
+    R_InitDrawThreads ();
 	
     framecount = 0;
 }
@@ -1002,7 +1034,7 @@ void R_SetupFrame (player_t* player)
 	pitch = -LOOKDIRMIN;
 
     // apply new yslope[] whenever "lookdir", "detailshift" or "screenblocks" change
-    tempCentery = viewheight/2 + (pitch << crispy->hires) * (screenblocks < 11 ? screenblocks : 11) / 10;
+    tempCentery = viewheight/2 + (pitch * hires_scale) * (screenblocks < 11 ? screenblocks : 11) / 10;
     if (centery != tempCentery)
     {
         centery = tempCentery;
@@ -1035,6 +1067,29 @@ void R_SetupFrame (player_t* player)
 
 
 
+//
+// R_UpdateRenderTime
+// [crispy] average the time spent in R_RenderPlayerView()
+//  over about a second, shown next to the FPS counter
+//
+static void R_UpdateRenderTime (uint64_t start)
+{
+    static uint64_t lasttime, sum;
+    static int count;
+    const uint64_t now = I_GetTimeUS();
+
+    sum += now - start;
+    count++;
+
+    if (now - lasttime >= 1000000)
+    {
+	crispy->rendertime = sum / count;
+	sum = 0;
+	count = 0;
+	lasttime = now;
+    }
+}
+
 //
 // R_RenderView
 //
@@ -1042,6 +1097,12 @@ void R_RenderPlayerView (player_t* player)
 {	
     extern void V_DrawFilledBox (int x, int y, int w, int h, int c);
     extern void R_InterpolateTextureOffsets (void);
+    const uint64_t starttime = I_GetTimeUS();
+
+    // [crispy] composites for the level must be complete before drawing.
+    // The first frame of a level is also the end screen of the wipe, so
+    // the workers only overlap the rest of P_SetupLevel(), not the wipe.
+    R_FinishPrecache ();
 
     R_SetupFrame (player);
 
@@ -1053,6 +1114,8 @@ void R_RenderPlayerView (player_t* player)
     if (automapactive && !crispy->automapoverlay)
     {
         R_RenderBSPNode (numnodes-1);
+        R_FlushDrawQueue ();
+        R_UpdateRenderTime (starttime);
         return;
     }
     
@@ -1081,6 +1144,11 @@ void R_RenderPlayerView (player_t* player)
     R_SetFuzzPosDraw();
     R_DrawMasked ();
 
+    // [crispy] threaded rendering
+    R_FlushDrawQueue ();
+
+    R_UpdateRenderTime (starttime);
+
     // Check for new console commands.
     NetUpdate ();				
 }
@@ -50,9 +50,17 @@ visplane_t*		floorplane;
 visplane_t*		ceilingplane;
 static int		numvisplanes;
 
+// [crispy] visplanes are looked up by a hash of their height, picnum
+//  and lightlevel, the buckets are chains of indices into visplanes[]
+#define VISPLANEHASHSIZE	512
+#define VISPLANEHASH(height,picnum,lightlevel) \
+	(((unsigned) (picnum) * 3 + (unsigned) (lightlevel) + \
+	  (unsigned) ((height) >> FRACBITS) * 7) & (VISPLANEHASHSIZE - 1))
+static int		visplanehash[VISPLANEHASHSIZE];
+
 // ?
-#define MAXOPENINGS	MAXWIDTH*64*4
-int			openings[MAXOPENINGS]; // [crispy] 32-bit integer math
+#define MAXOPENINGS	(SCREENWIDTH*64*4)
+int*			openings; // [crispy] 32-bit integer math
 int*			lastopening; // [crispy] 32-bit integer math
 
 
@@ -61,15 +69,15 @@ int*			lastopening; // [crispy] 32-bit integer math
 //  floorclip starts out SCREENHEIGHT
 //  ceilingclip starts out -1
 //
-int			floorclip[MAXWIDTH]; // [crispy] 32-bit integer math
-int			ceilingclip[MAXWIDTH]; // [crispy] 32-bit integer math
+int*			floorclip; // [crispy] 32-bit integer math
+int*			ceilingclip; // [crispy] 32-bit integer math
 
 //
 // spanstart holds the start of a plane span
 // initialized to 0 at start
 //
-int			spanstart[MAXHEIGHT];
-int			spanstop[MAXHEIGHT];
+int*			spanstart;
+int*			spanstop;
 
 //
 // texture mapping
@@ -78,15 +86,31 @@ lighttable_t**		planezlight;
 fixed_t			planeheight;
 
 fixed_t*			yslope;
-fixed_t			yslopes[LOOKDIRS][MAXHEIGHT];
-fixed_t			distscale[MAXWIDTH];
+fixed_t*		yslopes[LOOKDIRS];
+fixed_t*		distscale;
 fixed_t			basexscale;
 fixed_t			baseyscale;
 
-fixed_t			cachedheight[MAXHEIGHT];
-fixed_t			cacheddistance[MAXHEIGHT];
-fixed_t			cachedxstep[MAXHEIGHT];
-fixed_t			cachedystep[MAXHEIGHT];
+fixed_t*		cachedheight;
+fixed_t*		cacheddistance;
+fixed_t*		cachedxstep;
+fixed_t*		cachedystep;
+// [crispy] also cache the texture coordinates at centerx and the light index
+static fixed_t*		cachedxfrac;
+static fixed_t*		cachedyfrac;
+static int*		cachedlight;
+
+// [crispy] spans are not drawn right away, but kept back per row, so that
+//  spans of visplanes with the same height, flat and light level which
+//  continue each other on the same row are drawn with a single call
+static int*		batchstart;
+static int*		batchstop;
+static int*		batchrows;
+static int		numbatchrows;
+
+// [crispy] visplanes in drawing order, see R_DrawPlanes()
+static visplane_t**	sortedplanes;
+static int		numsortedplanes;
 
 
 
@@ -100,6 +124,52 @@ void R_InitPlanes (void)
 }
 
 
+//
+// R_InitPlaneBuffers
+// [crispy] Called whenever the resolution changes.
+//
+void R_InitPlaneBuffers (void)
+{
+    int		i;
+
+    openings = I_Realloc(openings, MAXOPENINGS * sizeof(*openings));
+    floorclip = I_Realloc(floorclip, SCREENWIDTH * sizeof(*floorclip));
+    ceilingclip = I_Realloc(ceilingclip, SCREENWIDTH * sizeof(*ceilingclip));
+    spanstart = I_Realloc(spanstart, SCREENHEIGHT * sizeof(*spanstart));
+    spanstop = I_Realloc(spanstop, SCREENHEIGHT * sizeof(*spanstop));
+
+    for (i = 0; i < LOOKDIRS; i++)
+    {
+	yslopes[i] = I_Realloc(yslopes[i], SCREENHEIGHT * sizeof(**yslopes));
+    }
+    distscale = I_Realloc(distscale, SCREENWIDTH * sizeof(*distscale));
+
+    cachedheight = I_Realloc(cachedheight, SCREENHEIGHT * sizeof(*cachedheight));
+    cacheddistance = I_Realloc(cacheddistance, SCREENHEIGHT * sizeof(*cacheddistance));
+    cachedxstep = I_Realloc(cachedxstep, SCREENHEIGHT * sizeof(*cachedxstep));
+    cachedystep = I_Realloc(cachedystep, SCREENHEIGHT * sizeof(*cachedystep));
+    cachedxfrac = I_Realloc(cachedxfrac, SCREENHEIGHT * sizeof(*cachedxfrac));
+    cachedyfrac = I_Realloc(cachedyfrac, SCREENHEIGHT * sizeof(*cachedyfrac));
+    cachedlight = I_Realloc(cachedlight, SCREENHEIGHT * sizeof(*cachedlight));
+
+    batchstart = I_Realloc(batchstart, SCREENHEIGHT * sizeof(*batchstart));
+    batchstop = I_Realloc(batchstop, SCREENHEIGHT * sizeof(*batchstop));
+    batchrows = I_Realloc(batchrows, SCREENHEIGHT * sizeof(*batchrows));
+    memset(batchstop, -1, SCREENHEIGHT * sizeof(*batchstop));
+    numbatchrows = 0;
+
+    // the top[] and bottom[] arrays of the visplanes
+    //  are allocated for the previous resolution
+    for (i = 0; i < numvisplanes; i++)
+    {
+	free(visplanes[i].top - 1);
+    }
+    free(visplanes);
+    visplanes = lastvisplane = floorplane = ceilingplane = NULL;
+    numvisplanes = 0;
+}
+
+
 //
 // R_MapPlane
 //
@@ -124,6 +194,7 @@ R_MapPlane
     fixed_t	distance;
 //  fixed_t	length;
     unsigned	index;
+    fixed_t	xfrac, yfrac;
     int dx, dy;
 	
 #ifdef RANGECHECK
@@ -150,28 +221,35 @@ R_MapPlane
 	distance = cacheddistance[y] = FixedMul (planeheight, yslope[y]);
 	ds_xstep = cachedxstep[y] = (FixedMul (viewsin, planeheight) / dy) << detailshift;
 	ds_ystep = cachedystep[y] = (FixedMul (viewcos, planeheight) / dy) << detailshift;
+
+	xfrac = cachedxfrac[y] = viewx + FixedMul(viewcos, distance);
+	yfrac = cachedyfrac[y] = -viewy - FixedMul(viewsin, distance);
+
+	index = distance >> LIGHTZSHIFT;
+
+	if (index >= MAXLIGHTZ )
+	    index = MAXLIGHTZ-1;
+
+	cachedlight[y] = index;
     }
     else
     {
-	distance = cacheddistance[y];
 	ds_xstep = cachedxstep[y];
 	ds_ystep = cachedystep[y];
+	xfrac = cachedxfrac[y];
+	yfrac = cachedyfrac[y];
+	index = cachedlight[y];
     }
 
     dx = x1 - centerx;
 
-    ds_xfrac = viewx + FixedMul(viewcos, distance) + dx * ds_xstep;
-    ds_yfrac = -viewy - FixedMul(viewsin, distance) + dx * ds_ystep;
+    ds_xfrac = xfrac + dx * ds_xstep;
+    ds_yfrac = yfrac + dx * ds_ystep;
 
     if (fixedcolormap)
 	ds_colormap[0] = ds_colormap[1] = fixedcolormap;
     else
     {
-	index = distance >> LIGHTZSHIFT;
-	
-	if (index >= MAXLIGHTZ )
-	    index = MAXLIGHTZ-1;
-
 	ds_colormap[0] = planezlight[index];
 	ds_colormap[1] = zlight[LIGHTLEVELS-1][MAXLIGHTZ-1];
     }
@@ -203,9 +281,14 @@ void R_ClearPlanes (void)
 
     lastvisplane = visplanes;
     lastopening = openings;
+
+    // [crispy] empty the visplane hash buckets
+    memset (visplanehash, -1, sizeof(visplanehash));
     
     // texture calculation
-    memset (cachedheight, 0, sizeof(cachedheight));
+    // [crispy] planeheight is never negative, so this invalidates all rows,
+    //  also for planes at eye level which used to match the zeroed cache
+    memset (cachedheight, -1, SCREENHEIGHT * sizeof(*cachedheight));
 
     // left to right mapping
     angle = (viewangle-ANG90)>>ANGLETOFINESHIFT;
@@ -224,11 +307,20 @@ static void R_RaiseVisplanes (visplane_t** vp)
     {
 	int numvisplanes_old = numvisplanes;
 	visplane_t* visplanes_old = visplanes;
+	visplane_t* pl;
 
 	numvisplanes = numvisplanes ? 2 * numvisplanes : MAXVISPLANES;
 	visplanes = I_Realloc(visplanes, numvisplanes * sizeof(*visplanes));
 	memset(visplanes + numvisplanes_old, 0, (numvisplanes - numvisplanes_old) * sizeof(*visplanes));
 
+	// [crispy] leave pads for [minx-1]/[maxx+1]
+	for (pl = visplanes + numvisplanes_old; pl < visplanes + numvisplanes; pl++)
+	{
+	    pl->top = I_Realloc(NULL, 2 * (SCREENWIDTH + 2) * sizeof(*pl->top));
+	    pl->top += 1;
+	    pl->bottom = pl->top + SCREENWIDTH + 2;
+	}
+
 	lastvisplane = visplanes + numvisplanes_old;
 	floorplane = visplanes + (floorplane - visplanes_old);
 	ceilingplane = visplanes + (ceilingplane - visplanes_old);
@@ -252,6 +344,8 @@ R_FindPlane
   int		lightlevel )
 {
     visplane_t*	check;
+    unsigned	hash;
+    int		i;
 	
     // [crispy] add support for MBF sky tranfers
     if (picnum == skyflatnum || picnum & PL_SKYFLAT)
@@ -260,19 +354,23 @@ R_FindPlane
 	lightlevel = 0;
     }
 	
-    for (check=visplanes; check<lastvisplane; check++)
+    // [crispy] only visplanes created here are put into the hash,
+    //  so it finds the same (first) visplane as the linear search did
+    hash = VISPLANEHASH(height, picnum, lightlevel);
+
+    for (i = visplanehash[hash]; i >= 0; i = visplanes[i].next)
     {
+	check = &visplanes[i];
+
 	if (height == check->height
 	    && picnum == check->picnum
 	    && lightlevel == check->lightlevel)
 	{
-	    break;
+	    return check;
 	}
     }
     
-			
-    if (check < lastvisplane)
-	return check;
+    check = lastvisplane;
 		
     R_RaiseVisplanes(&check); // [crispy] remove VISPLANES limit
     if (lastvisplane - visplanes == MAXVISPLANES && false)
@@ -285,8 +383,11 @@ R_FindPlane
     check->lightlevel = lightlevel;
     check->minx = SCREENWIDTH;
     check->maxx = -1;
+
+    check->next = visplanehash[hash];
+    visplanehash[hash] = check - visplanes;
     
-    memset (check->top,0xff,sizeof(check->top));
+    memset (check->top,0xff,SCREENWIDTH * sizeof(*check->top));
 		
     return check;
 }
@@ -360,12 +461,61 @@ R_CheckPlane
     pl->minx = start;
     pl->maxx = stop;
 
-    memset (pl->top,0xff,sizeof(pl->top));
+    memset (pl->top,0xff,SCREENWIDTH * sizeof(*pl->top));
 		
     return pl;
 }
 
 
+//
+// R_BatchSpan
+// [crispy] Keeps a span back until R_FlushSpans() or until
+//  a span on the same row doesn't continue it anymore.
+//
+static void R_BatchSpan (int y, int x1, int x2)
+{
+    if (batchstop[y] < 0)
+    {
+	batchrows[numbatchrows++] = y;
+    }
+    else if (batchstop[y] + 1 == x1)
+    {
+	batchstop[y] = x2;
+	return;
+    }
+    else if (x2 + 1 == batchstart[y])
+    {
+	batchstart[y] = x1;
+	return;
+    }
+    else
+    {
+	R_MapPlane (y, batchstart[y], batchstop[y]);
+    }
+
+    batchstart[y] = x1;
+    batchstop[y] = x2;
+}
+
+//
+// R_FlushSpans
+// [crispy] Draws all spans kept back by R_BatchSpan().
+//
+static void R_FlushSpans (void)
+{
+    int i;
+
+    for (i = 0; i < numbatchrows; i++)
+    {
+	const int y = batchrows[i];
+
+	R_MapPlane (y, batchstart[y], batchstop[y]);
+	batchstop[y] = -1;
+    }
+
+    numbatchrows = 0;
+}
+
 //
 // R_MakeSpans
 //
@@ -379,12 +529,12 @@ R_MakeSpans
 {
     while (t1 < t2 && t1<=b1)
     {
-	R_MapPlane (t1,spanstart[t1],x-1);
+	R_BatchSpan (t1,spanstart[t1],x-1);
 	t1++;
     }
     while (b1 > b2 && b1>=t1)
     {
-	R_MapPlane (b1,spanstart[b1],x-1);
+	R_BatchSpan (b1,spanstart[b1],x-1);
 	b1--;
     }
 	
@@ -414,9 +564,19 @@ static char *R_DistortedFlat (int flatnum)
     static int offset[4096];
 
     static char distortedflat[4096];
+    static int distortedflatnum = -1;
     char *normalflat;
     int i;
 
+    // [crispy] the flat is still the same
+    if (swirltic == gametic && distortedflatnum == flatnum)
+    {
+	return distortedflat;
+    }
+
+    // [crispy] queued spans may still be drawn from the old flat
+    R_FlushDrawQueue();
+
     if (swirltic != gametic)
     {
 	int x, y;
@@ -457,12 +617,30 @@ static char *R_DistortedFlat (int flatnum)
 	distortedflat[i] = normalflat[offset[i]];
     }
 
-    Z_ChangeTag(normalflat, PU_CACHE);
+    W_ReleaseLumpNum(flatnum);
+
+    distortedflatnum = flatnum;
 
     return distortedflat;
 }
 
 
+// [crispy] sort visplanes by height, flat and light level
+static int R_ComparePlanes (const void *a, const void *b)
+{
+    const visplane_t *const pa = *(const visplane_t *const *) a;
+    const visplane_t *const pb = *(const visplane_t *const *) b;
+
+    if (pa->height != pb->height)
+	return (pa->height < pb->height) ? -1 : 1;
+    if (pa->picnum != pb->picnum)
+	return (pa->picnum < pb->picnum) ? -1 : 1;
+    if (pa->lightlevel != pb->lightlevel)
+	return (pa->lightlevel < pb->lightlevel) ? -1 : 1;
+
+    return (pa < pb) ? -1 : (pa > pb);
+}
+
 //
 // R_DrawPlanes
 // At the end of each frame.
@@ -470,11 +648,13 @@ static char *R_DistortedFlat (int flatnum)
 void R_DrawPlanes (void)
 {
     visplane_t*		pl;
+    visplane_t*		batchplane = NULL;
     int			light;
     int			x;
     int			stop;
     int			angle;
-    int                 lumpnum;
+    int                 lumpnum = -1;
+    int			i, numplanes;
 				
 #ifdef RANGECHECK
     if (ds_p - drawsegs > numdrawsegs)
@@ -490,13 +670,44 @@ void R_DrawPlanes (void)
 		 lastopening - openings);
 #endif
 
-    for (pl = visplanes ; pl < lastvisplane ; pl++)
+    // [crispy] draw the visplanes sorted by height, flat and light level:
+    //  planes at the same height find their rows already set up by
+    //  R_MapPlane(), and the parts of visplanes that R_CheckPlane() split
+    //  up follow each other, so their spans can be drawn together.
+    //  Visplanes never overlap, so the drawing order doesn't matter.
+    numplanes = lastvisplane - visplanes;
+
+    if (numplanes > numsortedplanes)
+    {
+	numsortedplanes = numvisplanes;
+	sortedplanes = I_Realloc(sortedplanes, numsortedplanes * sizeof(*sortedplanes));
+    }
+
+    for (i = 0; i < numplanes; i++)
+    {
+	sortedplanes[i] = &visplanes[i];
+    }
+
+    qsort(sortedplanes, numplanes, sizeof(*sortedplanes), R_ComparePlanes);
+
+    for (i = 0; i < numplanes; i++)
     {
-	const boolean swirling = (flattranslation[pl->picnum] == -1);
+	pl = sortedplanes[i];
 
 	if (pl->minx > pl->maxx)
 	    continue;
 
+	// [crispy] a different height, flat or light level ends the batch
+	if (batchplane &&
+	    (pl->height != batchplane->height ||
+	     pl->picnum != batchplane->picnum ||
+	     pl->lightlevel != batchplane->lightlevel))
+	{
+	    R_FlushSpans();
+	    W_ReleaseLumpNum(lumpnum);
+	    batchplane = NULL;
+	}
+
 	
 	// sky flat
 	// [crispy] add support for MBF sky tranfers
@@ -554,21 +765,29 @@ void R_DrawPlanes (void)
 	}
 	
 	// regular flat
-        lumpnum = firstflat + (swirling ? pl->picnum : flattranslation[pl->picnum]);
-	// [crispy] add support for SMMU swirling flats
-	ds_source = swirling ? R_DistortedFlat(lumpnum) : W_CacheLumpNum(lumpnum, PU_STATIC);
-	ds_brightmap = R_BrightmapForFlatNum(lumpnum-firstflat);
+	// [crispy] only the first visplane of a batch sets up the flat
+	if (batchplane == NULL)
+	{
+	    const boolean swirling = (flattranslation[pl->picnum] == -1);
+
+	    lumpnum = firstflat + (swirling ? pl->picnum : flattranslation[pl->picnum]);
+	    // [crispy] add support for SMMU swirling flats
+	    ds_source = swirling ? R_DistortedFlat(lumpnum) : W_CacheLumpNum(lumpnum, PU_STATIC);
+	    ds_brightmap = R_BrightmapForFlatNum(lumpnum-firstflat);
 	
-	planeheight = abs(pl->height-viewz);
-	light = (pl->lightlevel >> LIGHTSEGSHIFT)+(extralight * LIGHTBRIGHT);
+	    planeheight = abs(pl->height-viewz);
+	    light = (pl->lightlevel >> LIGHTSEGSHIFT)+(extralight * LIGHTBRIGHT);
 
-	if (light >= LIGHTLEVELS)
-	    light = LIGHTLEVELS-1;
+	    if (light >= LIGHTLEVELS)
+		light = LIGHTLEVELS-1;
 
-	if (light < 0)
-	    light = 0;
+	    if (light < 0)
+		light = 0;
 
-	planezlight = zlight[light];
+	    planezlight = zlight[light];
+	}
+
+	batchplane = pl;
 
 	pl->top[pl->maxx+1] = 0xffffffffu; // [crispy] hires / 32-bit integer math
 	pl->top[pl->minx-1] = 0xffffffffu; // [crispy] hires / 32-bit integer math
@@ -582,7 +801,11 @@ void R_DrawPlanes (void)
 			pl->top[x],
 			pl->bottom[x]);
 	}
-	
-        W_ReleaseLumpNum(lumpnum);
+    }
+
+    if (batchplane)
+    {
+	R_FlushSpans();
+	W_ReleaseLumpNum(lumpnum);
     }
 }
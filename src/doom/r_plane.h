@@ -35,14 +35,15 @@ typedef void (*planefunction_t) (int top, int bottom);
 extern planefunction_t	floorfunc;
 extern planefunction_t	ceilingfunc_t;
 
-extern int		floorclip[MAXWIDTH]; // [crispy] 32-bit integer math
-extern int		ceilingclip[MAXWIDTH]; // [crispy] 32-bit integer math
+extern int*		floorclip; // [crispy] 32-bit integer math
+extern int*		ceilingclip; // [crispy] 32-bit integer math
 
 extern fixed_t*	yslope;
-extern fixed_t		yslopes[LOOKDIRS][MAXHEIGHT];
-extern fixed_t		distscale[MAXWIDTH];
+extern fixed_t*	yslopes[LOOKDIRS];
+extern fixed_t*	distscale;
 
 void R_InitPlanes (void);
+void R_InitPlaneBuffers (void); // [crispy]
 void R_ClearPlanes (void);
 
 void
@@ -106,7 +106,7 @@ extern player_t*	viewplayer;
 extern angle_t		clipangle;
 
 extern int		viewangletox[FINEANGLES/2];
-extern angle_t		xtoviewangle[MAXWIDTH+1];
+extern angle_t*		xtoviewangle; // [crispy] allocated for the current resolution
 //extern fixed_t		finetangent[FINEANGLES/2];
 
 extern fixed_t		rw_distance;
@@ -87,8 +87,12 @@ lighttable_t**	spritelights;
 
 // constant arrays
 //  used for psprite clipping and initializing clipping
-int		negonearray[MAXWIDTH]; // [crispy] 32-bit integer math
-int		screenheightarray[MAXWIDTH]; // [crispy] 32-bit integer math
+int*		negonearray; // [crispy] 32-bit integer math
+int*		screenheightarray; // [crispy] 32-bit integer math
+
+// [crispy] sprite clipping, allocated for the current resolution
+static int*	clipbot;
+static int*	cliptop;
 
 
 //
@@ -335,15 +339,28 @@ static int	numvissprites;
 // Called at program start.
 //
 void R_InitSprites(const char **namelist)
+{
+    R_InitSpriteDefs (namelist);
+}
+
+
+//
+// R_InitSpriteBuffers
+// [crispy] Called whenever the resolution changes.
+//
+void R_InitSpriteBuffers (void)
 {
     int		i;
-	
+
+    negonearray = I_Realloc(negonearray, SCREENWIDTH * sizeof(*negonearray));
+    screenheightarray = I_Realloc(screenheightarray, SCREENWIDTH * sizeof(*screenheightarray));
+    clipbot = I_Realloc(clipbot, SCREENWIDTH * sizeof(*clipbot));
+    cliptop = I_Realloc(cliptop, SCREENWIDTH * sizeof(*cliptop));
+
     for (i=0 ; i<SCREENWIDTH ; i++)
     {
 	negonearray[i] = -1;
     }
-	
-    R_InitSpriteDefs (namelist);
 }
 
 
@@ -753,7 +770,7 @@ void R_ProjectSprite (mobj_t* thing)
     else
     {
 	// diminished light
-	index = xscale>>(LIGHTSCALESHIFT-detailshift+crispy->hires);
+	index = (xscale / hires_scale)>>(LIGHTSCALESHIFT-detailshift);
 
 	if (index >= MAXLIGHTSCALE) 
 	    index = MAXLIGHTSCALE-1;
@@ -1243,8 +1260,6 @@ void R_SortVisSprites (void)
 void R_DrawSprite (vissprite_t* spr)
 {
     drawseg_t*		ds;
-    int		clipbot[MAXWIDTH]; // [crispy] 32-bit integer math
-    int		cliptop[MAXWIDTH]; // [crispy] 32-bit integer math
     int			x;
     int			r1;
     int			r2;
@@ -30,8 +30,8 @@ extern vissprite_t	vsprsortedhead;
 
 // Constant arrays used for psprite clipping
 //  and initializing clipping.
-extern int		negonearray[MAXWIDTH]; // [crispy] 32-bit integer math
-extern int		screenheightarray[MAXWIDTH]; // [crispy] 32-bit integer math
+extern int*		negonearray; // [crispy] 32-bit integer math
+extern int*		screenheightarray; // [crispy] 32-bit integer math
 
 // vars for R_DrawMaskedColumn
 extern int*		mfloorclip; // [crispy] 32-bit integer math
@@ -52,6 +52,7 @@ void R_AddSprites (sector_t* sec);
 void R_AddPSprites (void);
 void R_DrawSprites (void);
 void R_InitSprites(const char **namelist);
+void R_InitSpriteBuffers (void); // [crispy]
 void R_ClearSprites (void);
 void R_DrawMasked (void);
 
@@ -525,6 +525,11 @@ void S_StartSound(void *origin_p, int sfx_id)
     if (crispy->demowarp)
 	return;
 
+    // [Crispy Multiplayer Doom] predicted tics are run again once the
+    // server's tics arrive; their sounds are played then
+    if (predicting)
+	return;
+
     origin = (mobj_t *) origin_p;
     volume = snd_SfxVolume;
 
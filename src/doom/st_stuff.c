@@ -2218,7 +2218,7 @@ void ST_Init (void)
     }
 
     ST_loadData();
-    st_backing_screen = (pixel_t *) Z_Malloc((ST_WIDTH << 1) * (ST_HEIGHT << 1) * sizeof(*st_backing_screen), PU_STATIC, 0);
+    st_backing_screen = (pixel_t *) Z_Malloc((ST_WIDTH * MAXHIRES) * (ST_HEIGHT * MAXHIRES) * sizeof(*st_backing_screen), PU_STATIC, 0);
 }
 
 // [crispy] Demo Timer widget
@@ -2232,7 +2232,7 @@ void ST_DrawDemoTimer (const int time)
 	n = M_snprintf(buffer, sizeof(buffer), "%02i %02i %02i",
 	               secs / 60, secs % 60, time % TICRATE);
 
-	x = (viewwindowx >> crispy->hires) + (scaledviewwidth >> crispy->hires);
+	x = (viewwindowx / hires_scale) + (scaledviewwidth / hires_scale);
 
 	// [crispy] draw the Demo Timer widget with gray numbers
 	dp_translation = cr[CR_GRAY];
@@ -2246,7 +2246,7 @@ void ST_DrawDemoTimer (const int time)
 
 		if (c >= 0 && c <= 9)
 		{
-			V_DrawPatch(x, viewwindowy >> crispy->hires, shortnum[c]);
+			V_DrawPatch(x, viewwindowy / hires_scale, shortnum[c]);
 		}
 	}
 
@@ -68,12 +68,20 @@
 #define PRINTF_ATTR(fmt, first) __attribute__((format(printf, fmt, first)))
 #define PRINTF_ARG_ATTR(x) __attribute__((format_arg(x)))
 #define NORETURN __attribute__((noreturn))
+#define PREFETCH(x) __builtin_prefetch(x)
+#define THREADLOCAL __thread
 
 #else
 #define PACKEDATTR
 #define PRINTF_ATTR(fmt, first)
 #define PRINTF_ARG_ATTR(x)
 #define NORETURN
+#define PREFETCH(x)
+#if defined(_MSC_VER)
+#define THREADLOCAL __declspec(thread)
+#else
+#define THREADLOCAL _Thread_local
+#endif
 #endif
 
 #ifdef __WATCOMC__
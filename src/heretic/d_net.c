@@ -96,7 +96,10 @@ static loop_interface_t doom_loop_interface = {
     D_ProcessEvents,
     G_BuildTiccmd,
     RunTic,
-    MN_Ticker
+    MN_Ticker,
+    NULL,
+    NULL,
+    NULL
 };
 
 
@@ -97,7 +97,10 @@ static loop_interface_t hexen_loop_interface = {
     H2_ProcessEvents,
     G_BuildTiccmd,
     RunTic,
-    MN_Ticker
+    MN_Ticker,
+    NULL,
+    NULL,
+    NULL
 };
 
 
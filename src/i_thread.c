@@ -0,0 +1,73 @@
+//
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Thread functions.
+//
+
+#include "SDL.h"
+
+#include "i_thread.h"
+
+i_thread_t *I_CreateThread(int (*func)(void *data), const char *name,
+                           void *data)
+{
+    return (i_thread_t *) SDL_CreateThread(func, name, data);
+}
+
+int I_WaitThread(i_thread_t *thread)
+{
+    int result = 0;
+
+    SDL_WaitThread((SDL_Thread *) thread, &result);
+
+    return result;
+}
+
+i_semaphore_t *I_CreateSemaphore(int value)
+{
+    return (i_semaphore_t *) SDL_CreateSemaphore(value);
+}
+
+void I_SemaphoreWait(i_semaphore_t *sem)
+{
+    SDL_SemWait((SDL_sem *) sem);
+}
+
+void I_SemaphorePost(i_semaphore_t *sem)
+{
+    SDL_SemPost((SDL_sem *) sem);
+}
+
+int I_GetCPUCount(void)
+{
+    return SDL_GetCPUCount();
+}
+
+// i_atomic_t has the same layout as SDL_atomic_t, which is just a
+// wrapped int, so that users do not need to include SDL.h.
+
+int I_AtomicGet(i_atomic_t *a)
+{
+    return SDL_AtomicGet((SDL_atomic_t *) a);
+}
+
+void I_AtomicSet(i_atomic_t *a, int value)
+{
+    SDL_AtomicSet((SDL_atomic_t *) a, value);
+}
+
+int I_AtomicAdd(i_atomic_t *a, int value)
+{
+    return SDL_AtomicAdd((SDL_atomic_t *) a, value);
+}
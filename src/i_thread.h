@@ -0,0 +1,58 @@
+//
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      System-specific thread interface
+//
+
+#ifndef __I_THREAD__
+#define __I_THREAD__
+
+typedef struct i_thread_s i_thread_t;
+typedef struct i_semaphore_s i_semaphore_t;
+
+// An integer that can safely be accessed from several threads.
+
+typedef struct
+{
+    int value;
+} i_atomic_t;
+
+// Start a new thread running func(data).  Returns NULL if the thread
+// could not be created.
+
+i_thread_t *I_CreateThread(int (*func)(void *data), const char *name,
+                           void *data);
+
+// Wait for a thread to finish and return its result.
+
+int I_WaitThread(i_thread_t *thread);
+
+// Semaphores, for handing work to threads that wait for it.  Returns
+// NULL if the semaphore could not be created.
+
+i_semaphore_t *I_CreateSemaphore(int value);
+void I_SemaphoreWait(i_semaphore_t *sem);
+void I_SemaphorePost(i_semaphore_t *sem);
+
+// Number of CPU cores available.
+
+int I_GetCPUCount(void);
+
+// Atomic operations.  I_AtomicAdd returns the value before the add.
+
+int I_AtomicGet(i_atomic_t *a);
+void I_AtomicSet(i_atomic_t *a, int value);
+int I_AtomicAdd(i_atomic_t *a, int value);
+
+#endif
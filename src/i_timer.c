@@ -58,6 +58,22 @@ int I_GetTimeMS(void)
     return ticks - basetime;
 }
 
+// [crispy] High resolution timer, in microseconds
+
+uint64_t I_GetTimeUS(void)
+{
+    static Uint64 frequency = 0;
+    Uint64 counter;
+
+    if (frequency == 0)
+        frequency = SDL_GetPerformanceFrequency();
+
+    counter = SDL_GetPerformanceCounter();
+
+    return (counter / frequency) * 1000000
+         + ((counter % frequency) * 1000000) / frequency;
+}
+
 // Sleep for a specified number of ms
 
 void I_Sleep(int ms)
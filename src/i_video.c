@@ -50,6 +50,7 @@
 #include "z_zone.h"
 
 int SCREENWIDTH, SCREENHEIGHT, SCREENHEIGHT_4_3;
+int hires_scale = 2; // [crispy]
 
 // These are (1) the window (or the full screen) that our game is rendered to
 // and (2) the renderer that scales the texture (see below) into this window.
@@ -1280,7 +1281,8 @@ void SetVideoMode(boolean resize_fb) // [crispy] un-static, resize_fb
 
         pixel_format = SDL_GetWindowPixelFormat(screen);
 
-        SDL_SetWindowMinimumSize(screen, SCREENWIDTH, actualheight);
+        // [crispy] do not let large resolution scales enforce huge windows
+        SDL_SetWindowMinimumSize(screen, ORIGWIDTH, actualheight / hires_scale);
 
         I_InitWindowTitle();
         I_InitWindowIcon();
@@ -1409,6 +1411,34 @@ void SetVideoMode(boolean resize_fb) // [crispy] un-static, resize_fb
     CreateUpscaledTexture(true);
 }
 
+// [crispy] Get the integer resolution scale for the crispy->hires setting.
+// "native" picks the largest scale whose output still fits into the
+// desktop (fullscreen) or the configured window height.
+
+static int GetHiresScale(void)
+{
+    SDL_DisplayMode mode;
+    int height, scale;
+
+    if (crispy->hires != HIRES_NATIVE)
+    {
+        return BETWEEN(1, MAXHIRES, crispy->hires + 1);
+    }
+
+    if (fullscreen && SDL_GetDesktopDisplayMode(video_display, &mode) == 0)
+    {
+        height = mode.h;
+    }
+    else
+    {
+        height = window_height;
+    }
+
+    scale = height / (aspect_ratio_correct == 1 ? ORIGHEIGHT_4_3 : ORIGHEIGHT);
+
+    return BETWEEN(1, MAXHIRES, scale);
+}
+
 void I_InitGraphics(void)
 {
     SDL_Event dummy;
@@ -1447,18 +1477,10 @@ void I_InitGraphics(void)
     }
 
     // [crispy] run-time variable high-resolution rendering
-    if (crispy->hires)
-    {
-        SCREENWIDTH = MAXWIDTH;
-        SCREENHEIGHT = MAXHEIGHT;
-        SCREENHEIGHT_4_3 = MAXHEIGHT_4_3;
-    }
-    else
-    {
-        SCREENWIDTH = ORIGWIDTH;
-        SCREENHEIGHT = ORIGHEIGHT;
-        SCREENHEIGHT_4_3 = ORIGHEIGHT_4_3;
-    }
+    hires_scale = GetHiresScale();
+    SCREENWIDTH = ORIGWIDTH * hires_scale;
+    SCREENHEIGHT = ORIGHEIGHT * hires_scale;
+    SCREENHEIGHT_4_3 = ORIGHEIGHT_4_3 * hires_scale;
     blit_rect.w = SCREENWIDTH;
     blit_rect.h = SCREENHEIGHT;
 
@@ -28,11 +28,16 @@
 #define ORIGWIDTH  320 // [crispy]
 #define ORIGHEIGHT 200 // [crispy]
 
+// [crispy] size of the static renderer buffers in Heretic, Hexen and
+// Strife, Doom allocates its buffers for the current resolution
 #define MAXWIDTH  (ORIGWIDTH << 1) // [crispy]
 #define MAXHEIGHT (ORIGHEIGHT << 1) // [crispy]
 
+#define MAXHIRES 6 // [crispy] largest integer resolution scale
+
 extern int SCREENWIDTH;
 extern int SCREENHEIGHT;
+extern int hires_scale; // [crispy] SCREENWIDTH / ORIGWIDTH
 
 // Screen height used when aspect_ratio_correct=true.
 
@@ -0,0 +1,234 @@
+//
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Startup trace, written as Chrome trace event JSON.
+//
+//      Each phase is recorded with its wall clock and CPU time and
+//      written out as a complete ("X") event, which can be loaded
+//      into chrome://tracing or Perfetto.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "doomtype.h"
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include "m_misc.h"
+#include "m_trace.h"
+
+#define MAX_TRACE_DEPTH 16
+
+typedef struct
+{
+    const char *name;
+    char *arg;
+    uint64_t start;
+    uint64_t wall;
+    uint64_t cpu;
+} trace_event_t;
+
+static char *trace_filename;
+
+static trace_event_t *events;
+static int num_events, max_events;
+
+// Phases that have begun but not ended.
+
+static int open_events[MAX_TRACE_DEPTH];
+static clock_t open_cpu[MAX_TRACE_DEPTH];
+static int depth;
+
+static uint64_t trace_start;
+
+static uint64_t CPUTimeUS(clock_t start)
+{
+    return (uint64_t) (clock() - start) * 1000000 / CLOCKS_PER_SEC;
+}
+
+void M_InitTrace(void)
+{
+    int p;
+
+    //!
+    // @arg <file>
+    // @category obscure
+    //
+    // [crispy] Record how long each phase of startup and each loaded
+    // WAD and Dehacked file takes, and write it to <file> as a Chrome
+    // trace event JSON file once the game has started.
+    //
+
+    p = M_CheckParmWithArgs("-starttrace", 1);
+
+    if (p == 0)
+    {
+        return;
+    }
+
+    trace_filename = M_StringDuplicate(myargv[p + 1]);
+    trace_start = I_GetTimeUS();
+
+    // The whole of startup is the outermost phase.
+
+    M_TraceBegin("startup", NULL);
+
+    I_AtExit(M_FinishTrace, true);
+}
+
+void M_TraceBegin(const char *name, const char *arg)
+{
+    trace_event_t *event;
+
+    if (trace_filename == NULL)
+    {
+        return;
+    }
+
+    if (depth == MAX_TRACE_DEPTH)
+    {
+        I_Error("M_TraceBegin: phases nested too deeply");
+    }
+
+    if (num_events == max_events)
+    {
+        max_events = max_events ? 2 * max_events : 128;
+        events = I_Realloc(events, max_events * sizeof(*events));
+    }
+
+    event = &events[num_events];
+    event->name = name;
+    event->arg = arg != NULL ? M_StringDuplicate(arg) : NULL;
+    event->start = I_GetTimeUS() - trace_start;
+    event->wall = 0;
+    event->cpu = 0;
+
+    open_events[depth] = num_events;
+    open_cpu[depth] = clock();
+    ++depth;
+    ++num_events;
+}
+
+void M_TraceEnd(void)
+{
+    trace_event_t *event;
+
+    if (trace_filename == NULL || depth == 0)
+    {
+        return;
+    }
+
+    --depth;
+    event = &events[open_events[depth]];
+    event->wall = I_GetTimeUS() - trace_start - event->start;
+    event->cpu = CPUTimeUS(open_cpu[depth]);
+}
+
+// Write a string as a JSON string literal.
+
+static void WriteString(FILE *fstream, const char *s)
+{
+    fputc('"', fstream);
+
+    for (; *s != '\0'; ++s)
+    {
+        if (*s == '"' || *s == '\\')
+        {
+            fprintf(fstream, "\\%c", *s);
+        }
+        else if ((unsigned char) *s < 0x20)
+        {
+            fprintf(fstream, "\\u%04x", (unsigned char) *s);
+        }
+        else
+        {
+            fputc(*s, fstream);
+        }
+    }
+
+    fputc('"', fstream);
+}
+
+void M_FinishTrace(void)
+{
+    trace_event_t *event;
+    FILE *fstream;
+    int i;
+
+    if (trace_filename == NULL)
+    {
+        return;
+    }
+
+    // End any phases that are still going, such as startup itself.
+
+    while (depth > 0)
+    {
+        M_TraceEnd();
+    }
+
+    fstream = fopen(trace_filename, "w");
+
+    if (fstream == NULL)
+    {
+        fprintf(stderr, "M_FinishTrace: Unable to write %s\n",
+                        trace_filename);
+    }
+    else
+    {
+        fprintf(fstream, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+        for (i = 0; i < num_events; ++i)
+        {
+            event = &events[i];
+
+            fprintf(fstream, "{\"name\":");
+            WriteString(fstream, event->name);
+            fprintf(fstream, ",\"cat\":\"startup\",\"ph\":\"X\","
+                             "\"pid\":1,\"tid\":1,\"ts\":%llu,\"dur\":%llu,"
+                             "\"args\":{\"cpu_ms\":%.3f",
+                    (unsigned long long) event->start,
+                    (unsigned long long) event->wall,
+                    event->cpu / 1000.0);
+
+            if (event->arg != NULL)
+            {
+                fprintf(fstream, ",\"file\":");
+                WriteString(fstream, event->arg);
+            }
+
+            fprintf(fstream, "}}%s\n", i < num_events - 1 ? "," : "");
+        }
+
+        fprintf(fstream, "]}\n");
+        fclose(fstream);
+
+        printf("M_FinishTrace: Wrote startup trace to %s\n", trace_filename);
+    }
+
+    for (i = 0; i < num_events; ++i)
+    {
+        free(events[i].arg);
+    }
+
+    free(events);
+    events = NULL;
+    num_events = max_events = 0;
+
+    free(trace_filename);
+    trace_filename = NULL;
+}
+
@@ -0,0 +1,39 @@
+//
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Startup trace, written as Chrome trace event JSON.
+//
+
+#ifndef __M_TRACE__
+#define __M_TRACE__
+
+// Start tracing if -starttrace was given.
+
+void M_InitTrace(void);
+
+// Begin a phase named name, with an optional argument such as a file
+// name (may be NULL).  Phases may be nested.
+
+void M_TraceBegin(const char *name, const char *arg);
+
+// End the innermost phase.
+
+void M_TraceEnd(void);
+
+// Write out the trace file and stop tracing.
+
+void M_FinishTrace(void);
+
+#endif /* #ifndef __M_TRACE__ */
+
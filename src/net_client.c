@@ -150,12 +150,37 @@ static net_server_recv_t recvwindow[BACKUPTICS];
 static boolean need_to_acknowledge;
 static unsigned int gamedata_recv_time;
 
+// [Crispy Multiplayer Doom] When the network thread is running, it
+// acknowledges game data as soon as it arrives, so that a slow frame
+// does not make the server resend.  It keeps its own record of which
+// tics have arrived, as the receive window belongs to the game.
+
+static boolean thread_acknowledges;
+static unsigned int thread_recvwindow_start;
+static boolean thread_recvwindow[BACKUPTICS];
+static boolean thread_need_to_acknowledge;
+
 // The latency (time between when we sent our command and we got all
 // the other players' commands from the server) for the last tic we
 // received. We include this latency in tics we send to the server so
 // that they can adjust to us.
 static int last_latency;
 
+// Adaptive latency control (-netlatency auto).  Round trip time and
+// jitter are tracked for our own link to the server and for the worst
+// remote player, as smoothed averages and mean deviations in ms (see
+// RFC 6298).  Once a second the lookahead (how many tics we may build
+// ahead of the game) is set to the smallest value that covers the
+// measured latency plus jitter.
+
+boolean net_auto_latency = false;
+
+static int local_rtt, local_jitter;
+static int remote_rtt, remote_jitter;
+static boolean have_latency_sample;
+static int lookahead = MAX_LOOKAHEAD;
+static unsigned int lookahead_update_time;
+
 // Hash checksums of our wad directory and dehacked data.
 
 sha1_digest_t net_local_wad_sha1sum;
@@ -167,6 +192,100 @@ unsigned int net_local_is_freedoom;
 
 #define NET_CL_ExpandTicNum(b) NET_ExpandTicNum(recvwindow_start, (b))
 
+// Fold a new latency sample into a smoothed average and mean deviation.
+
+static void UpdateLatencyEstimate(int *rtt, int *jitter, int sample)
+{
+    int deviation;
+
+    deviation = sample - *rtt;
+
+    if (deviation < 0)
+    {
+        deviation = -deviation;
+    }
+
+    *jitter += (deviation - *jitter) / 4;
+    *rtt += (sample - *rtt) / 8;
+}
+
+static void UpdateLatencyEstimates(int latency, int remote_latency)
+{
+    if (!have_latency_sample)
+    {
+        local_rtt = latency;
+        local_jitter = latency / 2;
+        remote_rtt = remote_latency;
+        remote_jitter = remote_latency / 2;
+        have_latency_sample = true;
+    }
+    else
+    {
+        UpdateLatencyEstimate(&local_rtt, &local_jitter, latency);
+        UpdateLatencyEstimate(&remote_rtt, &remote_jitter, remote_latency);
+    }
+}
+
+// Once a second, pick the smallest lookahead that covers the measured
+// round trip plus jitter.  Increases take effect straight away to avoid
+// stalling; decreases happen one tic at a time so that a brief lull in
+// the jitter does not cause the game to start stuttering.
+
+static void UpdateLookahead(void)
+{
+    unsigned int nowtime;
+    int worst, needed, ticms;
+
+    nowtime = I_GetTimeMS();
+
+    if (!have_latency_sample || nowtime - lookahead_update_time < 1000)
+    {
+        return;
+    }
+
+    lookahead_update_time = nowtime;
+
+    worst = local_rtt + 4 * local_jitter;
+
+    if (remote_rtt + 4 * remote_jitter > worst)
+    {
+        worst = remote_rtt + 4 * remote_jitter;
+    }
+
+    ticms = (1000 * settings.ticdup) / TICRATE;
+    needed = (worst + ticms - 1) / ticms + 1;
+
+    if (needed < MIN_LOOKAHEAD)
+    {
+        needed = MIN_LOOKAHEAD;
+    }
+    else if (needed > MAX_LOOKAHEAD)
+    {
+        needed = MAX_LOOKAHEAD;
+    }
+
+    if (needed > lookahead)
+    {
+        lookahead = needed;
+    }
+    else if (needed < lookahead)
+    {
+        --lookahead;
+    }
+}
+
+// Maximum number of tics that may be built ahead of the game.
+
+int NET_CL_GetLookahead(void)
+{
+    if (!net_auto_latency)
+    {
+        return MAX_LOOKAHEAD;
+    }
+
+    return lookahead;
+}
+
 // Called when we become disconnected from the server
 
 static void NET_CL_Disconnected(void)
@@ -177,15 +296,18 @@ static void NET_CL_Disconnected(void)
 // Called when a packet is received from the server containing game
 // data. This updates the clock synchronization variable (offsetms)
 // using a PID filter that keeps client clocks in sync.
+// The latency is measured up to the time the packet was received, not
+// the time it was processed, so that a slow frame does not upset it.
 static void UpdateClockSync(unsigned int seq,
-                            unsigned int remote_latency)
+                            unsigned int remote_latency,
+                            unsigned int recv_time)
 {
     static int last_error, cumul_error;
     int latency, error;
 
     if (seq == send_queue[seq % BACKUPTICS].seq)
     {
-        latency = I_GetTimeMS() - send_queue[seq % BACKUPTICS].time;
+        latency = recv_time - send_queue[seq % BACKUPTICS].time;
     }
     else if (seq > send_queue[seq % BACKUPTICS].seq)
     {
@@ -204,8 +326,19 @@ static void UpdateClockSync(unsigned int seq,
 #define KI 0.01
 #define KD 0.02
 
-    // How does our latency compare to the worst other player?
-    error = latency - remote_latency;
+    UpdateLatencyEstimates(latency, remote_latency);
+
+    // How does our latency compare to the worst other player?  With
+    // adaptive latency, compare the smoothed estimates so that the
+    // filter is not thrown about by jitter.
+    if (net_auto_latency)
+    {
+        error = local_rtt - remote_rtt;
+    }
+    else
+    {
+        error = latency - remote_latency;
+    }
     cumul_error += error;
 
     offsetms = KP * (FRACUNIT * error)
@@ -289,6 +422,8 @@ static void NET_CL_Shutdown(void)
     {
         net_client_connected = false;
 
+        NET_StopRecvThread(client_context);
+        thread_acknowledges = false;
         NET_FreeAddress(server_addr);
 
         // Shut down network module, etc.  To do.
@@ -316,6 +451,32 @@ void NET_CL_StartGame(net_gamesettings_t *settings)
     NET_WriteSettings(packet, settings);
 }
 
+// Write a selective acknowledgement: one bit for each tic in the receive
+// window up to the latest tic received, set if we have that tic.
+
+static void NET_CL_WriteSACK(net_packet_t *packet)
+{
+    int num_tics;
+    int i;
+
+    num_tics = 0;
+
+    for (i=0; i<BACKUPTICS; ++i)
+    {
+        if (recvwindow[i].active)
+        {
+            num_tics = i + 1;
+        }
+    }
+
+    NET_WriteInt8(packet, num_tics);
+
+    for (i=0; i<num_tics; ++i)
+    {
+        NET_WriteBits(packet, recvwindow[i].active, 1);
+    }
+}
+
 static void NET_CL_SendGameDataACK(void)
 {
     net_packet_t *packet;
@@ -325,6 +486,11 @@ static void NET_CL_SendGameDataACK(void)
     NET_WriteInt16(packet, NET_PACKET_TYPE_GAMEDATA_ACK);
     NET_WriteInt8(packet, recvwindow_start & 0xff);
 
+    if (client_connection.protocol == NET_PROTOCOL_CRISPY_MULTIPLAYER_DOOM_1)
+    {
+        NET_CL_WriteSACK(packet);
+    }
+
     NET_Conn_SendPacket(&client_connection, packet);
 
     NET_FreePacket(packet);
@@ -332,6 +498,96 @@ static void NET_CL_SendGameDataACK(void)
     need_to_acknowledge = false;
 }
 
+// Network thread: note the tics in a game data packet.
+
+static void NET_CL_ThreadPacket(byte *data, int len)
+{
+    net_packet_t packet;
+    unsigned int packet_type;
+    unsigned int seq, num_tics;
+    unsigned int i;
+    int index;
+
+    memset(&packet, 0, sizeof(packet));
+    packet.data = data;
+    packet.len = len;
+
+    if (!NET_ReadInt16(&packet, &packet_type)
+     || packet_type != NET_PACKET_TYPE_GAMEDATA
+     || !NET_ReadInt8(&packet, &seq)
+     || !NET_ReadInt8(&packet, &num_tics))
+    {
+        return;
+    }
+
+    seq = NET_ExpandTicNum(thread_recvwindow_start, seq);
+
+    for (i=0; i<num_tics; ++i)
+    {
+        index = seq - thread_recvwindow_start + i;
+
+        if (index >= 0 && index < BACKUPTICS)
+        {
+            thread_recvwindow[index] = true;
+        }
+    }
+
+    while (thread_recvwindow[0])
+    {
+        memmove(thread_recvwindow, thread_recvwindow + 1,
+                sizeof(boolean) * (BACKUPTICS - 1));
+        thread_recvwindow[BACKUPTICS - 1] = false;
+        ++thread_recvwindow_start;
+    }
+
+    thread_need_to_acknowledge = true;
+}
+
+// Network thread: write the same acknowledgement as
+// NET_CL_SendGameDataACK, from the thread's record of received tics.
+
+static int NET_CL_ThreadReply(byte *buf, int buf_len)
+{
+    net_packet_t packet;
+    int num_tics;
+    int i;
+
+    if (!thread_need_to_acknowledge)
+    {
+        return 0;
+    }
+
+    memset(&packet, 0, sizeof(packet));
+    packet.data = buf;
+    packet.alloced = buf_len;
+
+    NET_WriteInt16(&packet, NET_PACKET_TYPE_GAMEDATA_ACK);
+    NET_WriteInt8(&packet, thread_recvwindow_start & 0xff);
+
+    // Servers without selective acknowledgements ignore the bitmap.
+
+    num_tics = 0;
+
+    for (i=0; i<BACKUPTICS; ++i)
+    {
+        if (thread_recvwindow[i])
+        {
+            num_tics = i + 1;
+        }
+    }
+
+    NET_WriteInt8(&packet, num_tics);
+
+    for (i=0; i<num_tics; ++i)
+    {
+        NET_WriteBits(&packet, thread_recvwindow[i], 1);
+    }
+
+    thread_need_to_acknowledge = false;
+
+    return packet.len;
+}
+
 static void NET_CL_SendTics(int start, int end)
 {
     net_packet_t *packet;
@@ -367,9 +623,10 @@ static void NET_CL_SendTics(int start, int end)
 
         sendobj = &send_queue[i % BACKUPTICS];
 
-        NET_WriteInt16(packet, last_latency);
+        NET_WriteLatency(packet, last_latency, client_connection.protocol);
 
-        NET_WriteTiccmdDiff(packet, &sendobj->cmd, settings.lowres_turn);
+        NET_WriteTiccmdDiff(packet, &sendobj->cmd, settings.lowres_turn,
+                            client_connection.protocol);
     }
     
     // Send the packet
@@ -548,6 +805,13 @@ static void NET_CL_ParseGameStart(net_packet_t *packet)
     // Clear the send queue
 
     memset(&send_queue, 0x00, sizeof(send_queue));
+
+    // Start with the maximum lookahead until we have measured the
+    // latency to the server.
+
+    have_latency_sample = false;
+    lookahead = MAX_LOOKAHEAD;
+    lookahead_update_time = I_GetTimeMS();
 }
 
 static void NET_CL_SendResendRequest(int start, int end)
@@ -557,16 +821,26 @@ static void NET_CL_SendResendRequest(int start, int end)
     int i;
 
     //printf("CL: Send resend %i-%i\n", start, end);
-    
-    packet = NET_NewPacket(64);
-    NET_WriteInt16(packet, NET_PACKET_TYPE_GAMEDATA_RESEND);
-    NET_WriteInt32(packet, start);
-    NET_WriteInt8(packet, end - start + 1);
-    NET_Conn_SendPacket(&client_connection, packet);
-    NET_FreePacket(packet);
 
     nowtime = I_GetTimeMS();
 
+    if (client_connection.protocol == NET_PROTOCOL_CRISPY_MULTIPLAYER_DOOM_1)
+    {
+        // The server works out which tics are missing from the bitmap
+        // in our acknowledgement, and resends only those.
+
+        NET_CL_SendGameDataACK();
+    }
+    else
+    {
+        packet = NET_NewPacket(64);
+        NET_WriteInt16(packet, NET_PACKET_TYPE_GAMEDATA_RESEND);
+        NET_WriteInt32(packet, start);
+        NET_WriteInt8(packet, end - start + 1);
+        NET_Conn_SendPacket(&client_connection, packet);
+        NET_FreePacket(packet);
+    }
+
     // Save the time we sent the resend request
 
     for (i=start; i<=end; ++i)
@@ -645,8 +919,10 @@ static void NET_CL_CheckResends(void)
     // We have received some data from the server and not acknowledged
     // it yet.  Normally this gets acknowledged when we send our game
     // data, but if the client is a drone we need to do this.
+    // The network thread, if running, takes care of it.
 
-    if (need_to_acknowledge && nowtime - gamedata_recv_time > 200)
+    if (need_to_acknowledge && !thread_acknowledges
+     && nowtime - gamedata_recv_time > 200)
     {
         NET_CL_SendGameDataACK();
     }
@@ -673,7 +949,7 @@ static void NET_CL_ParseGameData(net_packet_t *packet)
         return;
     }
 
-    nowtime = I_GetTimeMS();
+    nowtime = packet->recv_time;
 
     // Whatever happens, we now need to send an acknowledgement of our
     // current receive point.
@@ -694,7 +970,8 @@ static void NET_CL_ParseGameData(net_packet_t *packet)
 
         index = seq - recvwindow_start + i;
 
-        if (!NET_ReadFullTiccmd(packet, &cmd, settings.lowres_turn))
+        if (!NET_ReadFullTiccmd(packet, &cmd, settings.lowres_turn,
+                                client_connection.protocol))
         {
             return;
         }
@@ -720,7 +997,7 @@ static void NET_CL_ParseGameData(net_packet_t *packet)
         // to trigger a clock sync update.
         if (i == num_tics - 1)
         {
-            UpdateClockSync(seq + i, cmd.latency);
+            UpdateClockSync(seq + i, cmd.latency, packet->recv_time);
         }
     }
 
@@ -772,6 +1049,50 @@ static void NET_CL_ParseGameData(net_packet_t *packet)
     }
 }
 
+// Resend the tics selected by the bitmap in a resend request, as
+// contiguous runs.
+
+static void NET_CL_SelectiveResend(net_packet_t *packet, unsigned int start,
+                                   unsigned int num_tics)
+{
+    unsigned int needed;
+    unsigned int i;
+    int run_start;
+
+    run_start = -1;
+
+    for (i=0; i<=num_tics; ++i)
+    {
+        unsigned int tic = start + i;
+
+        if (i < num_tics)
+        {
+            if (!NET_ReadBits(packet, &needed, 1))
+            {
+                return;
+            }
+
+            needed = needed
+                  && send_queue[tic % BACKUPTICS].active
+                  && send_queue[tic % BACKUPTICS].seq == tic;
+        }
+        else
+        {
+            needed = false;
+        }
+
+        if (needed && run_start < 0)
+        {
+            run_start = tic;
+        }
+        else if (!needed && run_start >= 0)
+        {
+            NET_CL_SendTics(run_start, tic - 1);
+            run_start = -1;
+        }
+    }
+}
+
 // Parse a resend request from the server due to a dropped packet
 
 static void NET_CL_ParseResendRequest(net_packet_t *packet)
@@ -795,6 +1116,15 @@ static void NET_CL_ParseResendRequest(net_packet_t *packet)
 
     end = start + num_tics - 1;
 
+    // With selective acknowledgements, the request is followed by a bitmap
+    // of which tics in the range the server actually needs.
+
+    if (client_connection.protocol == NET_PROTOCOL_CRISPY_MULTIPLAYER_DOOM_1)
+    {
+        NET_CL_SelectiveResend(packet, start, num_tics);
+        return;
+    }
+
     //printf("requested resend %i-%i .. ", start, end);
 
     // Check we have the tics being requested.  If not, reduce the 
@@ -949,6 +1279,11 @@ void NET_CL_Run(void)
         // Check if our resend requests have timed out
 
         NET_CL_CheckResends();
+
+        if (net_auto_latency)
+        {
+            UpdateLookahead();
+        }
     }
 }
 
@@ -993,6 +1328,28 @@ boolean NET_CL_Connect(net_addr_t *addr, net_connect_data_t *data)
 
     NET_AddModule(client_context, addr->module);
 
+    //!
+    // @category net
+    //
+    // [Crispy Multiplayer Doom] Receive network packets on the main
+    // thread instead of a separate network thread.
+    //
+
+    if (!M_ParmExists("-nonetthread"))
+    {
+        net_recv_hooks_t hooks;
+
+        memset(thread_recvwindow, 0, sizeof(thread_recvwindow));
+        thread_recvwindow_start = 0;
+        thread_need_to_acknowledge = false;
+
+        hooks.addr = addr;
+        hooks.Packet = NET_CL_ThreadPacket;
+        hooks.Reply = NET_CL_ThreadReply;
+
+        thread_acknowledges = NET_StartRecvThread(client_context, &hooks);
+    }
+
     net_client_connected = true;
     net_client_received_wait_data = false;
 
@@ -22,6 +22,12 @@
 #include "sha1.h"
 #include "net_defs.h"
 
+// Limits on how many tics may be built ahead of the game; with
+// -netlatency auto, the lookahead is adapted between these.
+
+#define MIN_LOOKAHEAD 2
+#define MAX_LOOKAHEAD 8
+
 boolean NET_CL_Connect(net_addr_t *addr, net_connect_data_t *data);
 void NET_CL_Disconnect(void);
 void NET_CL_Run(void);
@@ -30,6 +36,7 @@ void NET_CL_LaunchGame(void);
 void NET_CL_StartGame(net_gamesettings_t *settings);
 void NET_CL_SendTiccmd(ticcmd_t *ticcmd, int maketic);
 boolean NET_CL_GetSettings(net_gamesettings_t *_settings);
+int NET_CL_GetLookahead(void);
 void NET_Init(void);
 
 void NET_BindVariables(void);
@@ -49,5 +56,6 @@ extern sha1_digest_t net_local_deh_sha1sum;
 extern unsigned int net_local_is_freedoom;
 
 extern boolean drone;
+extern boolean net_auto_latency;
 
 #endif /* #ifndef NET_CLIENT_H */
@@ -49,6 +49,23 @@ struct net_reliable_packet_s
 // Why did the server reject us?
 char *net_client_reject_reason = NULL;
 
+// Time remaining until "nowtime - start > period" becomes true, which is
+// the form the connection and server timeout checks take.
+
+int NET_TimeUntil(unsigned int nowtime, unsigned int start, int period)
+{
+    int elapsed;
+
+    elapsed = (int) (nowtime - start);
+
+    if (elapsed > period)
+    {
+        return 0;
+    }
+
+    return period - elapsed + 1;
+}
+
 static void NET_Conn_Init(net_connection_t *conn, net_addr_t *addr,
                           net_protocol_t protocol)
 {
@@ -392,6 +409,65 @@ void NET_Conn_Run(net_connection_t *conn)
     }
 }
 
+// Returns the number of milliseconds until NET_Conn_Run next has
+// something to do for this connection (keepalive, reliable packet
+// resend, disconnect retry or timeout).  Zero means "right now".
+
+int NET_Conn_TimeToNextEvent(net_connection_t *conn)
+{
+    unsigned int nowtime;
+    int result, t;
+
+    nowtime = I_GetTimeMS();
+
+    if (conn->state == NET_CONN_STATE_CONNECTED)
+    {
+        result = NET_TimeUntil(nowtime, conn->keepalive_send_time,
+                           KEEPALIVE_PERIOD * 1000);
+
+        t = NET_TimeUntil(nowtime, conn->keepalive_recv_time,
+                      CONNECTION_TIMEOUT_LEN * 1000);
+
+        if (t < result)
+        {
+            result = t;
+        }
+
+        if (conn->reliable_packets != NULL)
+        {
+            if (conn->reliable_packets->last_send_time < 0)
+            {
+                return 0;
+            }
+
+            t = NET_TimeUntil(nowtime, conn->reliable_packets->last_send_time,
+                          1000);
+
+            if (t < result)
+            {
+                result = t;
+            }
+        }
+
+        return result;
+    }
+    else if (conn->state == NET_CONN_STATE_DISCONNECTING)
+    {
+        if (conn->last_send_time < 0)
+        {
+            return 0;
+        }
+
+        return NET_TimeUntil(nowtime, conn->last_send_time, 1000);
+    }
+    else if (conn->state == NET_CONN_STATE_DISCONNECTED_SLEEP)
+    {
+        return NET_TimeUntil(nowtime, conn->last_send_time, 5000);
+    }
+
+    return 0;
+}
+
 net_packet_t *NET_Conn_NewReliable(net_connection_t *conn, int packet_type)
 {
     net_packet_t *packet;
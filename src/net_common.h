@@ -92,9 +92,11 @@ boolean NET_Conn_Packet(net_connection_t *conn, net_packet_t *packet,
 void NET_Conn_Disconnect(net_connection_t *conn);
 void NET_Conn_Run(net_connection_t *conn);
 net_packet_t *NET_Conn_NewReliable(net_connection_t *conn, int packet_type);
+int NET_Conn_TimeToNextEvent(net_connection_t *conn);
 
 // Other miscellaneous common functions
 unsigned int NET_ExpandTicNum(unsigned int relative, unsigned int b);
+int NET_TimeUntil(unsigned int nowtime, unsigned int start, int period);
 boolean NET_ValidGameSettings(GameMode_t mode, GameMission_t mission,
                               net_gamesettings_t *settings);
 
@@ -26,6 +26,7 @@
 #include "m_argv.h"
 
 #include "net_defs.h"
+#include "net_posix.h"
 #include "net_sdl.h"
 #include "net_server.h"
 
@@ -41,7 +42,9 @@ static char *not_dedicated_options[] =
     "-deh", "-iwad", "-cdrom", "-gameversion", "-nomonsters", "-respawn",
     "-fast", "-altdeath", "-deathmatch", "-turbo", "-merge", "-af", "-as",
     "-aa", "-file", "-wart", "-skill", "-episode", "-timer", "-avg", "-warp",
-    "-loadgame", "-longtics", "-extratics", "-dup", "-shorttics", NULL,
+    "-loadgame", "-longtics", "-extratics", "-dup", "-shorttics", "-netlatency",
+    "-predict", "-nonetthread",
+    NULL,
 };
 
 static void CheckForClientOptions(void)
@@ -61,14 +64,129 @@ static void CheckForClientOptions(void)
     }
 }
 
+// How often to print wakeup statistics when running with -eventstats.
+
+#define EVENT_STATS_PERIOD 60 /* 1 minute */
+
+static void RunEventLoop(void)
+{
+    unsigned int busy_wakeups, idle_wakeups;
+    int stats_time, nowtime;
+    boolean print_stats;
+    boolean busy;
+
+    //!
+    // @category net
+    //
+    // When running an event-driven dedicated server, periodically print
+    // how many wakeups were caused by incoming packets (busy) and how
+    // many only ran timers (idle).
+    //
+
+    print_stats = M_CheckParm("-eventstats") > 0;
+
+    busy_wakeups = 0;
+    idle_wakeups = 0;
+    stats_time = I_GetTimeMS();
+
+    while (true)
+    {
+        NET_SV_Run();
+
+        busy = NET_SV_WaitPacket(NET_SV_TimeToNextEvent());
+
+        if (busy)
+        {
+            ++busy_wakeups;
+        }
+        else
+        {
+            ++idle_wakeups;
+        }
+
+        nowtime = I_GetTimeMS();
+
+        if (print_stats && nowtime - stats_time > EVENT_STATS_PERIOD * 1000)
+        {
+            printf("SV: %u wakeups in %is: %u busy, %u idle\n",
+                   busy_wakeups + idle_wakeups, (nowtime - stats_time) / 1000,
+                   busy_wakeups, idle_wakeups);
+
+            busy_wakeups = 0;
+            idle_wakeups = 0;
+            stats_time = nowtime;
+        }
+    }
+}
+
 void NET_DedicatedServer(void)
 {
+    int sessions;
+    int p;
+
     CheckForClientOptions();
 
-    NET_SV_Init();
-    NET_SV_AddModule(&net_sdl_module);
+    //!
+    // @category net
+    // @arg <n>
+    //
+    // Host n independent game sessions in a single dedicated server
+    // process, all on the same UDP port.  Connecting players join the
+    // first session that is still waiting for players.
+    //
+
+    p = M_CheckParmWithArgs("-sessions", 1);
+
+    if (p > 0)
+    {
+        sessions = atoi(myargv[p + 1]);
+
+        if (sessions < 1)
+        {
+            I_Error("Invalid number of sessions: '%s'", myargv[p + 1]);
+        }
+    }
+    else
+    {
+        sessions = 1;
+    }
+
+    NET_SV_InitSessions(sessions);
+
+#ifndef _WIN32
+    //!
+    // @category net
+    // @platform unix
+    //
+    // When running a dedicated server, use the native BSD sockets
+    // networking module (with batched packet I/O where supported)
+    // instead of SDL_net.
+    //
+
+    if (M_CheckParm("-posixnet") > 0)
+    {
+        NET_SV_AddModule(&net_posix_module);
+    }
+    else
+#endif
+    {
+        NET_SV_AddModule(&net_sdl_module);
+    }
     NET_SV_RegisterWithMaster();
 
+    //!
+    // @category net
+    //
+    // Run the dedicated server event-driven: instead of polling for
+    // packets every 10ms, sleep until a packet arrives or until the next
+    // resend/timeout is due.
+    //
+
+    if (M_CheckParm("-eventloop") > 0)
+    {
+        RunEventLoop();
+    }
+
     while (true)
     {
         NET_SV_Run();
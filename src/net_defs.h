@@ -28,11 +28,13 @@
 // NET_MAXPLAYERS, as there may be observers that are not participating
 // (eg. left/right monitors)
 
-#define MAXNETNODES 16
+#define MAXNETNODES 64
 
 // The maximum number of players, multiplayer/networking.
 // This is the maximum supported by the networking code; individual games
 // have their own values for MAXPLAYERS that can be smaller.
+// The Chocolate Doom protocol cannot send ticcmds for more than 8 players,
+// but NET_PROTOCOL_CRISPY_MULTIPLAYER_DOOM_0 has no such limit.
 
 #define NET_MAXPLAYERS 8
 
@@ -49,12 +51,28 @@ typedef struct _net_packet_s net_packet_t;
 typedef struct _net_addr_s net_addr_t;
 typedef struct _net_context_s net_context_t;
 
+// [Crispy Multiplayer Doom] Opaque, module-specific copy of a sender's
+// address, filled in by RecvRaw without allocating anything.
+
+typedef struct
+{
+    byte data[32];
+} net_rawaddr_t;
+
 struct _net_packet_s
 {
     byte *data;
     size_t len;
     size_t alloced;
     unsigned int pos;
+
+    // Bit offset of the next bit for NET_ReadBits/NET_WriteBits.  Only
+    // meaningful while it points into the last byte read or written.
+    size_t bitpos;
+
+    // [Crispy Multiplayer Doom] Time in ms at which the packet was
+    // received from the network.
+    unsigned int recv_time;
 };
 
 struct _net_module_s
@@ -88,6 +106,47 @@ struct _net_module_s
     // Try to resolve a name to an address
 
     net_addr_t *(*ResolveAddress)(char *addr);
+
+    // Block for up to timeout milliseconds until a packet can be
+    // received.  May be NULL if the module cannot wait on its sockets.
+    //
+    // Returns true if a packet is ready to be received
+
+    boolean (*WaitPacket)(int timeout);
+
+    // Send any packets the module has queued up.  May be NULL if the
+    // module sends packets immediately.
+
+    void (*FlushPackets)(void);
+
+    // [Crispy Multiplayer Doom] Wait for up to timeout milliseconds
+    // for a packet and copy it into buf.  Must not allocate memory or
+    // touch any state used by the other functions, as it is called
+    // from the network thread.  May be NULL.
+    //
+    // Returns the packet length, -1 if no packet was received, or -2
+    // on error, with a description of the error copied into error.
+
+    int (*RecvRaw)(byte *buf, int buf_len, net_rawaddr_t *from, int timeout,
+                   char *error, int error_len);
+
+    // [Crispy Multiplayer Doom] Look up the address of a packet
+    // received through RecvRaw.
+
+    net_addr_t *(*FindRawAddress)(net_rawaddr_t *from);
+
+    // [Crispy Multiplayer Doom] Check whether a packet received through
+    // RecvRaw came from addr.  Called from the network thread.
+
+    boolean (*MatchRawAddress)(net_rawaddr_t *from, net_addr_t *addr);
+
+    // [Crispy Multiplayer Doom] Send len bytes from buf to addr, from
+    // the network thread, with the same restrictions as RecvRaw.
+    //
+    // Returns false on error, with a description copied into error.
+
+    boolean (*SendRaw)(net_addr_t *addr, byte *buf, int len,
+                       char *error, int error_len);
 };
 
 // net_addr_t
@@ -122,6 +181,18 @@ typedef enum
     // number in this enum.
     NET_PROTOCOL_CHOCOLATE_DOOM_0,
 
+    // [Crispy Multiplayer Doom] Ticcmd bundles carry a count and a list of
+    // (player, ticcmd) pairs instead of a fixed 8-bit player bitfield, so
+    // only the players actually in a bundle take up space and the number
+    // of players is not limited by the format.
+    NET_PROTOCOL_CRISPY_MULTIPLAYER_DOOM_0,
+
+    // [Crispy Multiplayer Doom] As above, but ticcmd diffs, latencies and
+    // bundle headers are bit-packed with variable-length fields, and lost
+    // tics are recovered with selective acknowledgements (a bitmap of
+    // received tics) rather than contiguous resend ranges.
+    NET_PROTOCOL_CRISPY_MULTIPLAYER_DOOM_1,
+
     // Add your own protocol here; be sure to add a name for it to the list
     // in net_common.c too.
 
@@ -17,18 +17,65 @@
 //
 
 #include <stdio.h>
+#include <string.h>
+
+#include "SDL.h"
 
 #include "i_system.h"
+#include "i_timer.h"
 #include "net_defs.h"
 #include "net_io.h"
+#include "net_packet.h"
 #include "z_zone.h"
 
 #define MAX_MODULES 16
 
+// [Crispy Multiplayer Doom] Size of the ring between the network thread
+// and the game, in packets.  Must be a power of two.
+
+#define RECV_RING_SIZE 64
+
+#define MAX_RAW_PACKET_SIZE 1500
+
+// Largest packet that a Reply hook may send.
+
+#define MAX_REPLY_SIZE 64
+
+typedef struct
+{
+    net_module_t *module;
+    net_rawaddr_t from;
+    unsigned int recv_time;
+    int len;
+    byte data[MAX_RAW_PACKET_SIZE];
+} net_rawpacket_t;
+
+// Single producer, single consumer ring: only the network thread writes
+// head and only the game writes tail.  Entries between tail and head
+// belong to the game; the rest belong to the network thread.
+
+typedef struct
+{
+    SDL_Thread *thread;
+    SDL_sem *ready;
+    SDL_atomic_t running;
+    SDL_atomic_t head;
+    SDL_atomic_t tail;
+    net_rawpacket_t ring[RECV_RING_SIZE];
+    net_recv_hooks_t hooks;
+
+    // Set by the network thread when it stops on an error, which the
+    // game then reports, as I_Error must not be called from the thread.
+
+    SDL_atomic_t failed;
+    char error[256];
+} net_recv_thread_t;
+
 struct _net_context_s
 {
     net_module_t *modules[MAX_MODULES];
     int num_modules;
+    net_recv_thread_t *recv_thread;
 };
 
 net_addr_t net_broadcast_addr;
@@ -39,6 +86,7 @@ net_context_t *NET_NewContext(void)
 
     context = Z_Malloc(sizeof(net_context_t), PU_STATIC, 0);
     context->num_modules = 0;
+    context->recv_thread = NULL;
 
     return context;
 }
@@ -89,11 +137,176 @@ void NET_SendBroadcast(net_context_t *context, net_packet_t *packet)
     }
 }
 
+// [Crispy Multiplayer Doom] Network thread: receive packets as soon as
+// they arrive, so that they are timestamped accurately and the socket
+// buffer does not fill up while the game is busy.
+
+// Stop the network thread on an error, and wake up the game so that
+// it can report it.
+
+static void RecvThreadFailed(net_recv_thread_t *rt)
+{
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&rt->failed, 1);
+    SDL_SemPost(rt->ready);
+}
+
+// Send the reply, if any, to the packets passed to the Packet hook.
+
+static boolean SendReply(net_recv_thread_t *rt, net_module_t *module)
+{
+    byte buf[MAX_REPLY_SIZE];
+    int len;
+
+    len = rt->hooks.Reply(buf, sizeof(buf));
+
+    return len <= 0
+        || module->SendRaw(rt->hooks.addr, buf, len,
+                           rt->error, sizeof(rt->error));
+}
+
+static int RecvThread(void *data)
+{
+    net_context_t *context = data;
+    net_recv_thread_t *rt = context->recv_thread;
+    net_module_t *module = context->modules[0];
+    net_rawpacket_t *entry;
+    boolean need_reply;
+    unsigned int head;
+    int len;
+
+    need_reply = false;
+
+    while (SDL_AtomicGet(&rt->running))
+    {
+        head = (unsigned int) SDL_AtomicGet(&rt->head);
+
+        // If the game has fallen behind, leave the packets in the
+        // socket buffer until it catches up.
+
+        if (head - (unsigned int) SDL_AtomicGet(&rt->tail) >= RECV_RING_SIZE)
+        {
+            if (need_reply && !SendReply(rt, module))
+            {
+                RecvThreadFailed(rt);
+                break;
+            }
+
+            need_reply = false;
+            SDL_Delay(1);
+            continue;
+        }
+
+        entry = &rt->ring[head % RECV_RING_SIZE];
+
+        // Don't wait while a reply is due; send it as soon as all the
+        // packets that have already arrived have been read.
+
+        len = module->RecvRaw(entry->data, MAX_RAW_PACKET_SIZE,
+                              &entry->from, need_reply ? 0 : 10,
+                              rt->error, sizeof(rt->error));
+
+        if (len == -2)
+        {
+            RecvThreadFailed(rt);
+            break;
+        }
+
+        if (len < 0)
+        {
+            if (need_reply && !SendReply(rt, module))
+            {
+                RecvThreadFailed(rt);
+                break;
+            }
+
+            need_reply = false;
+            continue;
+        }
+
+        entry->module = module;
+        entry->recv_time = I_GetTimeMS();
+        entry->len = len;
+
+        if (rt->hooks.Packet != NULL
+         && module->MatchRawAddress(&entry->from, rt->hooks.addr))
+        {
+            rt->hooks.Packet(entry->data, len);
+            need_reply = true;
+        }
+
+        // Only hand the entry over once it has been completely written.
+
+        SDL_MemoryBarrierRelease();
+        SDL_AtomicSet(&rt->head, (int) (head + 1));
+        SDL_SemPost(rt->ready);
+    }
+
+    return 0;
+}
+
+// Report an error that stopped the network thread.
+
+static void CheckRecvThread(net_recv_thread_t *rt)
+{
+    if (SDL_AtomicGet(&rt->failed))
+    {
+        SDL_MemoryBarrierAcquire();
+        I_Error("Network thread: %s", rt->error);
+    }
+}
+
+static boolean RingEmpty(net_recv_thread_t *rt)
+{
+    return SDL_AtomicGet(&rt->head) == SDL_AtomicGet(&rt->tail);
+}
+
+static boolean RecvFromThread(net_recv_thread_t *rt,
+                              net_addr_t **addr,
+                              net_packet_t **packet)
+{
+    net_rawpacket_t *entry;
+    unsigned int tail;
+
+    if (RingEmpty(rt))
+    {
+        return false;
+    }
+
+    SDL_MemoryBarrierAcquire();
+
+    tail = (unsigned int) SDL_AtomicGet(&rt->tail);
+    entry = &rt->ring[tail % RECV_RING_SIZE];
+
+    // Packets and addresses are allocated from the zone, which is not
+    // thread safe, so this is done here rather than in the thread.
+
+    *packet = NET_NewPacket(entry->len);
+    memcpy((*packet)->data, entry->data, entry->len);
+    (*packet)->len = entry->len;
+    (*packet)->recv_time = entry->recv_time;
+
+    *addr = entry->module->FindRawAddress(&entry->from);
+
+    // Give the entry back to the network thread.
+
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&rt->tail, (int) (tail + 1));
+
+    return true;
+}
+
 boolean NET_RecvPacket(net_context_t *context, 
                        net_addr_t **addr, 
                        net_packet_t **packet)
 {
     int i;
+
+    if (context->recv_thread != NULL)
+    {
+        CheckRecvThread(context->recv_thread);
+        return RecvFromThread(context->recv_thread, addr, packet);
+    }
     
     // check all modules for new packets
     
@@ -101,6 +314,7 @@ boolean NET_RecvPacket(net_context_t *context,
     {
         if (context->modules[i]->RecvPacket(addr, packet))
         {
+            (*packet)->recv_time = I_GetTimeMS();
             return true;
         }
     }
@@ -108,6 +322,147 @@ boolean NET_RecvPacket(net_context_t *context,
     return false;
 }
 
+// [Crispy Multiplayer Doom] Start a thread to receive packets for the
+// context.  Only possible if there is a single module that supports
+// receiving from another thread.  While the thread is running, the
+// module's RecvPacket and WaitPacket functions are not called.
+// If hooks is not NULL, the thread runs them for packets from hooks->addr.
+//
+// Returns true if the thread was started.
+
+boolean NET_StartRecvThread(net_context_t *context, net_recv_hooks_t *hooks)
+{
+    net_recv_thread_t *rt;
+
+    if (context->recv_thread != NULL)
+    {
+        return true;
+    }
+
+    if (context->num_modules != 1
+     || context->modules[0]->RecvRaw == NULL
+     || context->modules[0]->FindRawAddress == NULL)
+    {
+        return false;
+    }
+
+    if (hooks != NULL
+     && (context->modules[0]->MatchRawAddress == NULL
+      || context->modules[0]->SendRaw == NULL))
+    {
+        return false;
+    }
+
+    rt = Z_Malloc(sizeof(net_recv_thread_t), PU_STATIC, 0);
+    SDL_AtomicSet(&rt->running, 1);
+    SDL_AtomicSet(&rt->head, 0);
+    SDL_AtomicSet(&rt->tail, 0);
+    SDL_AtomicSet(&rt->failed, 0);
+
+    if (hooks != NULL)
+    {
+        rt->hooks = *hooks;
+    }
+    else
+    {
+        memset(&rt->hooks, 0, sizeof(rt->hooks));
+    }
+    rt->ready = SDL_CreateSemaphore(0);
+
+    if (rt->ready == NULL)
+    {
+        Z_Free(rt);
+        return false;
+    }
+
+    context->recv_thread = rt;
+    rt->thread = SDL_CreateThread(RecvThread, "net_recv", context);
+
+    if (rt->thread == NULL)
+    {
+        context->recv_thread = NULL;
+        SDL_DestroySemaphore(rt->ready);
+        Z_Free(rt);
+        return false;
+    }
+
+    return true;
+}
+
+// [Crispy Multiplayer Doom] Stop the context's network thread, if it
+// has one.  Any packets it has received that have not been read yet
+// are dropped.
+
+void NET_StopRecvThread(net_context_t *context)
+{
+    net_recv_thread_t *rt = context->recv_thread;
+
+    if (rt == NULL)
+    {
+        return;
+    }
+
+    SDL_AtomicSet(&rt->running, 0);
+    SDL_WaitThread(rt->thread, NULL);
+    SDL_DestroySemaphore(rt->ready);
+
+    context->recv_thread = NULL;
+    Z_Free(rt);
+}
+
+// Send any packets that modules in the context have queued up
+
+void NET_FlushPackets(net_context_t *context)
+{
+    int i;
+
+    for (i=0; i<context->num_modules; ++i)
+    {
+        if (context->modules[i]->FlushPackets != NULL)
+        {
+            context->modules[i]->FlushPackets();
+        }
+    }
+}
+
+// Wait for up to timeout milliseconds for a packet to arrive on the
+// context.  Only possible if there is a single module that supports
+// waiting; otherwise we just sleep for a short time and let the caller
+// poll for packets as before.
+//
+// Returns true if a packet is ready to be received.
+
+boolean NET_WaitPacket(net_context_t *context, int timeout)
+{
+    net_recv_thread_t *rt = context->recv_thread;
+
+    if (rt != NULL)
+    {
+        CheckRecvThread(rt);
+
+        if (RingEmpty(rt) && timeout > 0)
+        {
+            SDL_SemWaitTimeout(rt->ready, timeout);
+            CheckRecvThread(rt);
+        }
+
+        return !RingEmpty(rt);
+    }
+
+    if (context->num_modules == 1
+     && context->modules[0]->WaitPacket != NULL)
+    {
+        return context->modules[0]->WaitPacket(timeout);
+    }
+
+    if (timeout > 0)
+    {
+        I_Sleep(timeout < 10 ? timeout : 10);
+    }
+
+    return false;
+}
+
 // Note: this prints into a static buffer, calling again overwrites
 // the first result
 
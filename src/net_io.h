@@ -22,12 +22,30 @@
 
 extern net_addr_t net_broadcast_addr;
 
+// [Crispy Multiplayer Doom] Callbacks run on the network thread, so that
+// packets can be answered while the game is busy.  Packet is called for
+// every packet received from addr.  Once no more packets are waiting,
+// Reply may write a packet to send back to addr into buf and return its
+// length, or return 0.  Neither may allocate memory or touch state used
+// by the game.
+
+typedef struct
+{
+    net_addr_t *addr;
+    void (*Packet)(byte *data, int len);
+    int (*Reply)(byte *buf, int buf_len);
+} net_recv_hooks_t;
+
 net_context_t *NET_NewContext(void);
 void NET_AddModule(net_context_t *context, net_module_t *module);
 void NET_SendPacket(net_addr_t *addr, net_packet_t *packet);
 void NET_SendBroadcast(net_context_t *context, net_packet_t *packet);
 boolean NET_RecvPacket(net_context_t *context, net_addr_t **addr, 
                        net_packet_t **packet);
+boolean NET_WaitPacket(net_context_t *context, int timeout);
+boolean NET_StartRecvThread(net_context_t *context, net_recv_hooks_t *hooks);
+void NET_StopRecvThread(net_context_t *context);
+void NET_FlushPackets(net_context_t *context);
 char *NET_AddrToString(net_addr_t *addr);
 void NET_FreeAddress(net_addr_t *addr);
 net_addr_t *NET_ResolveAddress(net_context_t *context, char *address);
@@ -151,6 +151,12 @@ net_module_t net_loop_client_module =
     NET_CL_AddrToString,
     NET_CL_FreeAddress,
     NET_CL_ResolveAddress,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
 };
 
 //-----------------------------------------------------------------------------
@@ -226,6 +232,12 @@ net_module_t net_loop_server_module =
     NET_SV_AddrToString,
     NET_SV_FreeAddress,
     NET_SV_ResolveAddress,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
 };
 
 
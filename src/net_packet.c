@@ -36,6 +36,8 @@ net_packet_t *NET_NewPacket(int initial_size)
     packet->data = Z_Malloc(initial_size, PU_STATIC, 0);
     packet->len = 0;
     packet->pos = 0;
+    packet->bitpos = 0;
+    packet->recv_time = 0;
 
     total_packet_memory += sizeof(net_packet_t) + initial_size;
 
@@ -323,6 +325,68 @@ void NET_WriteString(net_packet_t *packet, const char *string)
     packet->len += string_size;
 }
 
+// Read a number of bits (up to 32) from the packet, most significant
+// bit first.  Consecutive bit reads share bytes; the first bit read
+// after a byte-oriented read starts on a new byte.
 
+boolean NET_ReadBits(net_packet_t *packet, unsigned int *data, int bits)
+{
+    unsigned int result;
+
+    if ((packet->bitpos & 7) == 0 || packet->bitpos / 8 + 1 != packet->pos)
+    {
+        packet->bitpos = packet->pos * 8;
+    }
+
+    result = 0;
+
+    while (bits > 0)
+    {
+        if ((packet->bitpos & 7) == 0)
+        {
+            if (packet->pos + 1 > packet->len)
+                return false;
 
+            ++packet->pos;
+        }
+
+        result = (result << 1)
+               | ((packet->data[packet->bitpos / 8]
+                   >> (7 - (packet->bitpos & 7))) & 1);
+
+        ++packet->bitpos;
+        --bits;
+    }
+
+    *data = result;
+
+    return true;
+}
 
+// Write a number of bits (up to 32) to the packet, most significant bit
+// first.  Unused bits in the last byte are left as zero.
+
+void NET_WriteBits(net_packet_t *packet, unsigned int i, int bits)
+{
+    if ((packet->bitpos & 7) == 0 || packet->bitpos / 8 + 1 != packet->len)
+    {
+        packet->bitpos = packet->len * 8;
+    }
+
+    while (bits > 0)
+    {
+        --bits;
+
+        if ((packet->bitpos & 7) == 0)
+        {
+            NET_WriteInt8(packet, 0);
+        }
+
+        if ((i >> bits) & 1)
+        {
+            packet->data[packet->bitpos / 8] |= 1 << (7 - (packet->bitpos & 7));
+        }
+
+        ++packet->bitpos;
+    }
+}
@@ -35,11 +35,15 @@ boolean NET_ReadSInt32(net_packet_t *packet, signed int *data);
 char *NET_ReadString(net_packet_t *packet);
 char *NET_ReadSafeString(net_packet_t *packet);
 
+boolean NET_ReadBits(net_packet_t *packet, unsigned int *data, int bits);
+
 void NET_WriteInt8(net_packet_t *packet, unsigned int i);
 void NET_WriteInt16(net_packet_t *packet, unsigned int i);
 void NET_WriteInt32(net_packet_t *packet, unsigned int i);
 
 void NET_WriteString(net_packet_t *packet, const char *string);
 
+void NET_WriteBits(net_packet_t *packet, unsigned int i, int bits);
+
 #endif /* #ifndef NET_PACKET_H */
 
@@ -0,0 +1,552 @@
+//
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Networking module which uses BSD sockets directly.  Where the
+//     system supports it, packets are received and sent in batches
+//     with recvmmsg()/sendmmsg() to cut down on system calls.
+//
+
+#define _GNU_SOURCE
+
+#include "config.h"
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include "doomtype.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_misc.h"
+#include "net_defs.h"
+#include "net_io.h"
+#include "net_packet.h"
+#include "net_posix.h"
+#include "z_zone.h"
+
+#define DEFAULT_PORT 2342
+
+// Largest datagram we expect to receive, and the size of the buffers
+// used to queue outgoing packets.  Larger outgoing packets bypass the
+// queue and are sent immediately.
+
+#define MAX_PACKET_SIZE 1500
+
+// Number of packets received/sent per system call.
+
+#define BATCH_SIZE 32
+
+// Number of buckets in the address hash table (must be a power of two).
+
+#define ADDR_HASH_SIZE 256
+
+typedef struct addrpair_s addrpair_t;
+
+struct addrpair_s
+{
+    net_addr_t net_addr;
+    struct sockaddr_in sin;
+    addrpair_t *next;
+};
+
+static boolean initted = false;
+static int port = DEFAULT_PORT;
+static int udpsocket = -1;
+
+static addrpair_t *addr_table[ADDR_HASH_SIZE];
+
+// Receive batch: packets read by the last receive call that have not
+// been passed up to the caller yet.
+
+static byte recv_buffers[BATCH_SIZE][MAX_PACKET_SIZE];
+static struct sockaddr_in recv_addrs[BATCH_SIZE];
+static size_t recv_lens[BATCH_SIZE];
+static int recv_count = 0;
+static int recv_next = 0;
+
+// Send queue: packets waiting for the next flush.
+
+static byte send_buffers[BATCH_SIZE][MAX_PACKET_SIZE];
+static struct sockaddr_in send_addrs[BATCH_SIZE];
+static size_t send_lens[BATCH_SIZE];
+static int send_count = 0;
+
+static unsigned int HashAddress(const struct sockaddr_in *sin)
+{
+    unsigned int h;
+
+    h = sin->sin_addr.s_addr * 2654435761U;
+    h ^= sin->sin_port * 40503U;
+
+    return (h ^ (h >> 16)) & (ADDR_HASH_SIZE - 1);
+}
+
+// Finds an address in the hash table.  If the address is not found,
+// it is added to the table.
+
+static net_addr_t *NET_POSIX_FindAddress(const struct sockaddr_in *sin)
+{
+    addrpair_t *entry;
+    unsigned int hash;
+
+    hash = HashAddress(sin);
+
+    for (entry = addr_table[hash]; entry != NULL; entry = entry->next)
+    {
+        if (entry->sin.sin_addr.s_addr == sin->sin_addr.s_addr
+         && entry->sin.sin_port == sin->sin_port)
+        {
+            return &entry->net_addr;
+        }
+    }
+
+    // Was not found in the table.  Add a new entry.
+
+    entry = Z_Malloc(sizeof(addrpair_t), PU_STATIC, 0);
+    memset(entry, 0, sizeof(addrpair_t));
+
+    entry->sin.sin_family = AF_INET;
+    entry->sin.sin_addr = sin->sin_addr;
+    entry->sin.sin_port = sin->sin_port;
+    entry->net_addr.handle = &entry->sin;
+    entry->net_addr.module = &net_posix_module;
+
+    entry->next = addr_table[hash];
+    addr_table[hash] = entry;
+
+    return &entry->net_addr;
+}
+
+static void NET_POSIX_FreeAddress(net_addr_t *addr)
+{
+    addrpair_t **entry;
+
+    for (entry = &addr_table[HashAddress(addr->handle)];
+         *entry != NULL;
+         entry = &(*entry)->next)
+    {
+        if (&(*entry)->net_addr == addr)
+        {
+            addrpair_t *freed = *entry;
+
+            *entry = freed->next;
+            Z_Free(freed);
+            return;
+        }
+    }
+
+    I_Error("NET_POSIX_FreeAddress: Attempted to remove an unused address!");
+}
+
+static void OpenSocket(int bind_port)
+{
+    struct sockaddr_in sin;
+    int broadcast = 1;
+
+    udpsocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+    if (udpsocket < 0)
+    {
+        I_Error("NET_POSIX: Unable to open a socket: %s", strerror(errno));
+    }
+
+    setsockopt(udpsocket, SOL_SOCKET, SO_BROADCAST,
+               &broadcast, sizeof(broadcast));
+
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_ANY);
+    sin.sin_port = htons(bind_port);
+
+    if (bind(udpsocket, (struct sockaddr *) &sin, sizeof(sin)) < 0)
+    {
+        I_Error("NET_POSIX: Unable to bind to port %i: %s",
+                bind_port, strerror(errno));
+    }
+}
+
+static void ParsePortParameter(void)
+{
+    int p;
+
+    p = M_CheckParmWithArgs("-port", 1);
+    if (p > 0)
+        port = atoi(myargv[p+1]);
+}
+
+static boolean NET_POSIX_InitClient(void)
+{
+    if (initted)
+        return true;
+
+    ParsePortParameter();
+    OpenSocket(0);
+
+    initted = true;
+
+    return true;
+}
+
+static boolean NET_POSIX_InitServer(void)
+{
+    if (initted)
+        return true;
+
+    ParsePortParameter();
+    OpenSocket(port);
+
+    initted = true;
+
+    return true;
+}
+
+static void SendError(void)
+{
+    // The socket buffer being full is not fatal; it is the same as the
+    // packet being lost on the way and the usual resend logic recovers.
+
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS
+     && errno != ECONNREFUSED && errno != EINTR)
+    {
+        I_Error("NET_POSIX_SendPacket: Error transmitting packet: %s",
+                strerror(errno));
+    }
+}
+
+// Send all queued packets.
+
+static void NET_POSIX_FlushPackets(void)
+{
+    int i;
+
+    if (send_count == 0)
+    {
+        return;
+    }
+
+#ifdef HAVE_SENDMMSG
+    {
+        struct mmsghdr msgs[BATCH_SIZE];
+        struct iovec iovs[BATCH_SIZE];
+        int sent, result;
+
+        memset(msgs, 0, sizeof(struct mmsghdr) * send_count);
+
+        for (i=0; i<send_count; ++i)
+        {
+            iovs[i].iov_base = send_buffers[i];
+            iovs[i].iov_len = send_lens[i];
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &send_addrs[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        }
+
+        sent = 0;
+
+        while (sent < send_count)
+        {
+            result = sendmmsg(udpsocket, msgs + sent, send_count - sent, 0);
+
+            if (result < 0)
+            {
+                SendError();
+
+                // Drop the packet that failed and carry on with the rest.
+
+                result = 1;
+            }
+
+            sent += result;
+        }
+    }
+#else
+    for (i=0; i<send_count; ++i)
+    {
+        if (sendto(udpsocket, send_buffers[i], send_lens[i], 0,
+                   (struct sockaddr *) &send_addrs[i],
+                   sizeof(struct sockaddr_in)) < 0)
+        {
+            SendError();
+        }
+    }
+#endif
+
+    send_count = 0;
+}
+
+static void NET_POSIX_SendPacket(net_addr_t *addr, net_packet_t *packet)
+{
+    struct sockaddr_in sin;
+
+    if (addr == &net_broadcast_addr)
+    {
+        memset(&sin, 0, sizeof(sin));
+        sin.sin_family = AF_INET;
+        sin.sin_addr.s_addr = htonl(INADDR_BROADCAST);
+        sin.sin_port = htons(port);
+    }
+    else
+    {
+        sin = *((struct sockaddr_in *) addr->handle);
+    }
+
+    // Oversized packets can't be queued; send straight away, after
+    // anything already in the queue so that ordering is preserved.
+
+    if (packet->len > MAX_PACKET_SIZE)
+    {
+        NET_POSIX_FlushPackets();
+
+        if (sendto(udpsocket, packet->data, packet->len, 0,
+                   (struct sockaddr *) &sin, sizeof(sin)) < 0)
+        {
+            SendError();
+        }
+
+        return;
+    }
+
+    if (send_count >= BATCH_SIZE)
+    {
+        NET_POSIX_FlushPackets();
+    }
+
+    memcpy(send_buffers[send_count], packet->data, packet->len);
+    send_lens[send_count] = packet->len;
+    send_addrs[send_count] = sin;
+    ++send_count;
+}
+
+// Read the next batch of packets from the socket without blocking.
+
+static void ReceiveBatch(void)
+{
+    int result;
+
+    recv_next = 0;
+    recv_count = 0;
+
+#ifdef HAVE_RECVMMSG
+    {
+        struct mmsghdr msgs[BATCH_SIZE];
+        struct iovec iovs[BATCH_SIZE];
+        int i;
+
+        memset(msgs, 0, sizeof(msgs));
+
+        for (i=0; i<BATCH_SIZE; ++i)
+        {
+            iovs[i].iov_base = recv_buffers[i];
+            iovs[i].iov_len = MAX_PACKET_SIZE;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &recv_addrs[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        }
+
+        result = recvmmsg(udpsocket, msgs, BATCH_SIZE, MSG_DONTWAIT, NULL);
+
+        for (i=0; i<result; ++i)
+        {
+            recv_lens[i] = msgs[i].msg_len;
+        }
+    }
+#else
+    {
+        socklen_t addrlen;
+
+        // Without recvmmsg, the "batch" is one packet.
+
+        addrlen = sizeof(struct sockaddr_in);
+        result = recvfrom(udpsocket, recv_buffers[0], MAX_PACKET_SIZE,
+                          MSG_DONTWAIT, (struct sockaddr *) &recv_addrs[0],
+                          &addrlen);
+
+        if (result >= 0)
+        {
+            recv_lens[0] = result;
+            result = 1;
+        }
+    }
+#endif
+
+    if (result < 0)
+    {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR
+         && errno != ECONNREFUSED)
+        {
+            I_Error("NET_POSIX_RecvPacket: Error receiving packet: %s",
+                    strerror(errno));
+        }
+
+        return;
+    }
+
+    recv_count = result;
+}
+
+static boolean NET_POSIX_RecvPacket(net_addr_t **addr, net_packet_t **packet)
+{
+    size_t len;
+
+    if (recv_next >= recv_count)
+    {
+        ReceiveBatch();
+
+        // no packets received
+
+        if (recv_count == 0)
+            return false;
+    }
+
+    // Put the data into a new packet structure
+
+    len = recv_lens[recv_next];
+    *packet = NET_NewPacket(len);
+    memcpy((*packet)->data, recv_buffers[recv_next], len);
+    (*packet)->len = len;
+
+    // Address
+
+    *addr = NET_POSIX_FindAddress(&recv_addrs[recv_next]);
+
+    ++recv_next;
+
+    return true;
+}
+
+static boolean NET_POSIX_WaitPacket(int timeout)
+{
+    struct pollfd pfd;
+    int result;
+
+    // Anything still queued goes out before we go to sleep.
+
+    NET_POSIX_FlushPackets();
+
+    if (recv_next < recv_count)
+    {
+        return true;
+    }
+
+    pfd.fd = udpsocket;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    result = poll(&pfd, 1, timeout);
+
+    return result > 0 && (pfd.revents & POLLIN) != 0;
+}
+
+static void NET_POSIX_AddrToString(net_addr_t *addr, char *buffer,
+                                   int buffer_len)
+{
+    struct sockaddr_in *sin;
+    uint32_t host;
+    uint16_t addr_port;
+
+    sin = (struct sockaddr_in *) addr->handle;
+    host = ntohl(sin->sin_addr.s_addr);
+    addr_port = ntohs(sin->sin_port);
+
+    M_snprintf(buffer, buffer_len, "%i.%i.%i.%i",
+               (host >> 24) & 0xff, (host >> 16) & 0xff,
+               (host >> 8) & 0xff, host & 0xff);
+
+    // Same as the SDL module: only show the port if it isn't the default.
+
+    if (addr_port != DEFAULT_PORT)
+    {
+        char portbuf[10];
+        M_snprintf(portbuf, sizeof(portbuf), ":%i", addr_port);
+        M_StringConcat(buffer, portbuf, buffer_len);
+    }
+}
+
+static net_addr_t *NET_POSIX_ResolveAddress(char *address)
+{
+    struct addrinfo hints, *result;
+    struct sockaddr_in sin;
+    char *addr_hostname;
+    int addr_port;
+    char *colon;
+    int err;
+
+    colon = strchr(address, ':');
+
+    addr_hostname = M_StringDuplicate(address);
+
+    if (colon != NULL)
+    {
+        addr_hostname[colon - address] = '\0';
+        addr_port = atoi(colon + 1);
+    }
+    else
+    {
+        addr_port = port;
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    err = getaddrinfo(addr_hostname, NULL, &hints, &result);
+
+    free(addr_hostname);
+
+    if (err != 0 || result == NULL)
+    {
+        // unable to resolve
+
+        return NULL;
+    }
+
+    memcpy(&sin, result->ai_addr, sizeof(struct sockaddr_in));
+    sin.sin_port = htons(addr_port);
+    freeaddrinfo(result);
+
+    return NET_POSIX_FindAddress(&sin);
+}
+
+// Complete module
+
+net_module_t net_posix_module =
+{
+    NET_POSIX_InitClient,
+    NET_POSIX_InitServer,
+    NET_POSIX_SendPacket,
+    NET_POSIX_RecvPacket,
+    NET_POSIX_AddrToString,
+    NET_POSIX_FreeAddress,
+    NET_POSIX_ResolveAddress,
+    NET_POSIX_WaitPacket,
+    NET_POSIX_FlushPackets,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+};
+
+#endif /* #ifndef _WIN32 */
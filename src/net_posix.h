@@ -0,0 +1,28 @@
+//
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//     Networking module which uses BSD sockets directly
+//
+
+#ifndef NET_POSIX_H
+#define NET_POSIX_H
+
+#include "net_defs.h"
+
+#ifndef _WIN32
+extern net_module_t net_posix_module;
+#endif
+
+#endif /* #ifndef NET_POSIX_H */
+
@@ -41,6 +41,7 @@ static boolean initted = false;
 static int port = DEFAULT_PORT;
 static UDPsocket udpsocket;
 static UDPpacket *recvpacket;
+static SDLNet_SocketSet socketset = NULL;
 
 typedef struct
 {
@@ -68,6 +69,21 @@ static boolean AddressesEqual(IPaddress *a, IPaddress *b)
         && a->port == b->port;
 }
 
+// [Crispy Multiplayer Doom] The socket set is created up front rather
+// than on first use, as the network thread waits on it.
+
+static void NET_SDL_InitSocketSet(void)
+{
+    socketset = SDLNet_AllocSocketSet(1);
+
+    if (socketset == NULL
+     || SDLNet_UDP_AddSocket(socketset, udpsocket) < 0)
+    {
+        I_Error("NET_SDL_InitSocketSet: Unable to create socket set: %s",
+                SDLNet_GetError());
+    }
+}
+
 // Finds an address by searching the table.  If the address is not found,
 // it is added to the table.
 
@@ -179,6 +195,8 @@ static boolean NET_SDL_InitClient(void)
     {
         I_Error("NET_SDL_InitClient: Unable to open a socket!");
     }
+
+    NET_SDL_InitSocketSet();
     
     recvpacket = SDLNet_AllocPacket(1500);
 
@@ -211,6 +229,8 @@ static boolean NET_SDL_InitServer(void)
         I_Error("NET_SDL_InitServer: Unable to bind to port %i", port);
     }
 
+    NET_SDL_InitSocketSet();
+
     recvpacket = SDLNet_AllocPacket(1500);
 #ifdef DROP_PACKETS
     srand(time(NULL));
@@ -299,6 +319,100 @@ static boolean NET_SDL_RecvPacket(net_addr_t **addr, net_packet_t **packet)
     return true;
 }
 
+static boolean NET_SDL_WaitPacket(int timeout)
+{
+    int result;
+
+    result = SDLNet_CheckSockets(socketset, timeout);
+
+    if (result < 0)
+    {
+        // Interrupted or otherwise failed; let the caller poll as normal.
+
+        return false;
+    }
+
+    return result > 0;
+}
+
+// [Crispy Multiplayer Doom] Receive into a caller-supplied buffer, for
+// the network thread.  The main thread does not use the socket set or
+// receive while the thread is running.
+
+static int NET_SDL_RecvRaw(byte *buf, int buf_len, net_rawaddr_t *from,
+                           int timeout, char *error, int error_len)
+{
+    UDPpacket sdl_packet;
+    int result;
+
+    if (SDLNet_CheckSockets(socketset, timeout) <= 0)
+    {
+        return -1;
+    }
+
+    sdl_packet.channel = -1;
+    sdl_packet.data = buf;
+    sdl_packet.len = 0;
+    sdl_packet.maxlen = buf_len;
+
+    result = SDLNet_UDP_Recv(udpsocket, &sdl_packet);
+
+    if (result < 0)
+    {
+        M_StringCopy(error, SDLNet_GetError(), error_len);
+        return -2;
+    }
+
+    if (result == 0)
+    {
+        return -1;
+    }
+
+    memcpy(from->data, &sdl_packet.address, sizeof(IPaddress));
+
+    return sdl_packet.len;
+}
+
+static net_addr_t *NET_SDL_FindRawAddress(net_rawaddr_t *from)
+{
+    IPaddress ip;
+
+    memcpy(&ip, from->data, sizeof(IPaddress));
+
+    return NET_SDL_FindAddress(&ip);
+}
+
+static boolean NET_SDL_MatchRawAddress(net_rawaddr_t *from, net_addr_t *addr)
+{
+    IPaddress ip;
+
+    memcpy(&ip, from->data, sizeof(IPaddress));
+
+    return AddressesEqual(&ip, (IPaddress *) addr->handle);
+}
+
+// [Crispy Multiplayer Doom] Send from the network thread.  Unlike
+// NET_SDL_SendPacket, errors are returned rather than fatal.
+
+static boolean NET_SDL_SendRaw(net_addr_t *addr, byte *buf, int len,
+                               char *error, int error_len)
+{
+    UDPpacket sdl_packet;
+
+    sdl_packet.channel = 0;
+    sdl_packet.data = buf;
+    sdl_packet.len = len;
+    sdl_packet.address = *((IPaddress *) addr->handle);
+
+    if (!SDLNet_UDP_Send(udpsocket, -1, &sdl_packet))
+    {
+        M_StringCopy(error, SDLNet_GetError(), error_len);
+        return false;
+    }
+
+    return true;
+}
+
 void NET_SDL_AddrToString(net_addr_t *addr, char *buffer, int buffer_len)
 {
     IPaddress *ip;
@@ -377,5 +491,11 @@ net_module_t net_sdl_module =
     NET_SDL_AddrToString,
     NET_SDL_FreeAddress,
     NET_SDL_ResolveAddress,
+    NET_SDL_WaitPacket,
+    NULL,
+    NET_SDL_RecvRaw,
+    NET_SDL_FindRawAddress,
+    NET_SDL_MatchRawAddress,
+    NET_SDL_SendRaw,
 };
 
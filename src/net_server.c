@@ -38,6 +38,7 @@
 #include "net_server.h"
 #include "net_sdl.h"
 #include "net_structrw.h"
+#include "z_zone.h"
 
 // How often to refresh our registration with the master server.
 
@@ -47,6 +48,11 @@
 
 #define MASTER_RESOLVE_PERIOD 8 * 60 * 60 /* 8 hours */
 
+// Minimum time between resends of the same tic in response to selective
+// acknowledgements.
+
+#define SACK_RESEND_TIME 200
+
 typedef enum
 {
     // waiting for the game to be "launched" (key player to press the start
@@ -101,6 +107,11 @@ typedef struct
 
     unsigned int acknowledged;
 
+    // Last time each tic in the send queue was resent in response to
+    // a selective acknowledgement
+
+    unsigned int resend_time[BACKUPTICS];
+
     // Value of max_players specified by the client on connect.
 
     int max_players;
@@ -145,14 +156,34 @@ typedef struct
     net_ticdiff_t diff;
 } net_client_recv_t;
 
-static net_server_state_t server_state;
+// A single game session.  Normally the server runs just one of these,
+// but with -sessions a single process (and socket) can host several
+// independent games at once.
+
+typedef struct
+{
+    net_server_state_t state;
+    net_client_t clients[MAXNETNODES];
+    net_client_t *players[NET_MAXPLAYERS];
+    unsigned int gamemode;
+    unsigned int gamemission;
+    net_gamesettings_t settings;
+
+    // receive window
+
+    unsigned int recvwindow_start;
+    net_client_recv_t recvwindow[BACKUPTICS][NET_MAXPLAYERS];
+} net_session_t;
+
 static boolean server_initialized = false;
-static net_client_t clients[MAXNETNODES];
-static net_client_t *sv_players[NET_MAXPLAYERS];
 static net_context_t *server_context;
-static unsigned int sv_gamemode;
-static unsigned int sv_gamemission;
-static net_gamesettings_t sv_settings;
+
+// All sessions hosted by this server, and the session currently being
+// processed.  All of the per-game code below works on "sv".
+
+static net_session_t *sessions;
+static int num_sessions;
+static net_session_t *sv;
 
 // For registration with master server:
 
@@ -160,12 +191,7 @@ static net_addr_t *master_server = NULL;
 static unsigned int master_refresh_time;
 static unsigned int master_resolve_time;
 
-// receive window
-
-static unsigned int recvwindow_start;
-static net_client_recv_t recvwindow[BACKUPTICS][NET_MAXPLAYERS];
-
-#define NET_SV_ExpandTicNum(b) NET_ExpandTicNum(recvwindow_start, (b))
+#define NET_SV_ExpandTicNum(b) NET_ExpandTicNum(sv->recvwindow_start, (b))
 
 static void NET_SV_DisconnectClient(net_client_t *client)
 {
@@ -216,9 +242,9 @@ static void NET_SV_BroadcastMessage(char *s, ...)
 
     for (i=0; i<MAXNETNODES; ++i)
     {
-        if (ClientConnected(&clients[i]))
+        if (ClientConnected(&sv->clients[i]))
         {
-            NET_SV_SendConsoleMessage(&clients[i], buf);
+            NET_SV_SendConsoleMessage(&sv->clients[i], buf);
         }
     }
 
@@ -237,24 +263,24 @@ static void NET_SV_AssignPlayers(void)
 
     for (i=0; i<MAXNETNODES; ++i)
     {
-        if (ClientConnected(&clients[i]))
+        if (ClientConnected(&sv->clients[i]))
         {
-            if (!clients[i].drone)
+            if (!sv->clients[i].drone)
             {
-                sv_players[pl] = &clients[i];
-                sv_players[pl]->player_number = pl;
+                sv->players[pl] = &sv->clients[i];
+                sv->players[pl]->player_number = pl;
                 ++pl;
             }
             else
             {
-                clients[i].player_number = -1;
+                sv->clients[i].player_number = -1;
             }
         }
     }
 
     for (; pl<NET_MAXPLAYERS; ++pl)
     {
-        sv_players[pl] = NULL;
+        sv->players[pl] = NULL;
     }
 }
 
@@ -269,7 +295,7 @@ static int NET_SV_NumPlayers(void)
 
     for (i=0; i<NET_MAXPLAYERS; ++i)
     {
-        if (sv_players[i] != NULL && ClientConnected(sv_players[i]))
+        if (sv->players[i] != NULL && ClientConnected(sv->players[i]))
         {
             result += 1;
         }
@@ -287,8 +313,8 @@ static int NET_SV_NumReadyPlayers(void)
 
     for (i = 0; i < MAXNETNODES; ++i)
     {
-        if (ClientConnected(&clients[i])
-         && !clients[i].drone && clients[i].ready)
+        if (ClientConnected(&sv->clients[i])
+         && !sv->clients[i].drone && sv->clients[i].ready)
         {
             ++result;
         }
@@ -305,9 +331,9 @@ static int NET_SV_MaxPlayers(void)
 
     for (i = 0; i < MAXNETNODES; ++i)
     {
-        if (ClientConnected(&clients[i]))
+        if (ClientConnected(&sv->clients[i]))
         {
-            return clients[i].max_players;
+            return sv->clients[i].max_players;
         }
     }
 
@@ -325,7 +351,7 @@ static int NET_SV_NumDrones(void)
 
     for (i=0; i<MAXNETNODES; ++i)
     {
-        if (ClientConnected(&clients[i]) && clients[i].drone)
+        if (ClientConnected(&sv->clients[i]) && sv->clients[i].drone)
         {
             result += 1;
         }
@@ -345,7 +371,7 @@ static int NET_SV_NumClients(void)
 
     for (i=0; i<MAXNETNODES; ++i)
     {
-        if (ClientConnected(&clients[i]))
+        if (ClientConnected(&sv->clients[i]))
         {
             ++count;
         }
@@ -369,14 +395,14 @@ static net_client_t *NET_SV_Controller(void)
     {
         // Can't be controller?
 
-        if (!ClientConnected(&clients[i]) || clients[i].drone)
+        if (!ClientConnected(&sv->clients[i]) || sv->clients[i].drone)
         {
             continue;
         }
 
-        if (best == NULL || clients[i].connect_time < best->connect_time)
+        if (best == NULL || sv->clients[i].connect_time < best->connect_time)
         {
-            best = &clients[i];
+            best = &sv->clients[i];
         }
     }
 
@@ -421,10 +447,10 @@ static void NET_SV_SendWaitingData(net_client_t *client)
     for (i = 0; i < wait_data.num_players; ++i)
     {
         M_StringCopy(wait_data.player_names[i],
-                     sv_players[i]->name,
+                     sv->players[i]->name,
                      MAXPLAYERNAME);
         M_StringCopy(wait_data.player_addrs[i],
-                     NET_AddrToString(sv_players[i]->addr),
+                     NET_AddrToString(sv->players[i]->addr),
                      MAXPLAYERNAME);
     }
 
@@ -450,11 +476,11 @@ static unsigned int NET_SV_LatestAcknowledged(void)
 
     for (i=0; i<MAXNETNODES; ++i) 
     {
-        if (ClientConnected(&clients[i]))
+        if (ClientConnected(&sv->clients[i]))
         {
-            if (clients[i].acknowledged < lowtic)
+            if (sv->clients[i].acknowledged < lowtic)
             {
-                lowtic = clients[i].acknowledged;
+                lowtic = sv->clients[i].acknowledged;
             }
         }
     }
@@ -480,7 +506,7 @@ static void NET_SV_AdvanceWindow(void)
 
     // Advance the recv window until it catches up with lowtic
 
-    while (recvwindow_start < lowtic)
+    while (sv->recvwindow_start < lowtic)
     {    
         boolean should_advance;
 
@@ -491,12 +517,12 @@ static void NET_SV_AdvanceWindow(void)
 
         for (i=0; i<NET_MAXPLAYERS; ++i)
         {
-            if (sv_players[i] == NULL || !ClientConnected(sv_players[i]))
+            if (sv->players[i] == NULL || !ClientConnected(sv->players[i]))
             {
                 continue;
             }
 
-            if (!recvwindow[0][i].active)
+            if (!sv->recvwindow[0][i].active)
             {
                 should_advance = false;
                 break;
@@ -514,12 +540,12 @@ static void NET_SV_AdvanceWindow(void)
         
         // Advance the window
 
-        memmove(recvwindow, recvwindow + 1,
-                sizeof(*recvwindow) * (BACKUPTICS - 1));
-        memset(&recvwindow[BACKUPTICS-1], 0, sizeof(*recvwindow));
-        ++recvwindow_start;
+        memmove(sv->recvwindow, sv->recvwindow + 1,
+                sizeof(*sv->recvwindow) * (BACKUPTICS - 1));
+        memset(&sv->recvwindow[BACKUPTICS-1], 0, sizeof(*sv->recvwindow));
+        ++sv->recvwindow_start;
 
-        //printf("SV: advanced to %i\n", recvwindow_start);
+        //printf("SV: advanced to %i\n", sv->recvwindow_start);
     }
 }
 
@@ -531,17 +557,63 @@ static net_client_t *NET_SV_FindClient(net_addr_t *addr)
 
     for (i=0; i<MAXNETNODES; ++i) 
     {
-        if (clients[i].active && clients[i].addr == addr)
+        if (sv->clients[i].active && sv->clients[i].addr == addr)
         {
             // found the client
 
-            return &clients[i];
+            return &sv->clients[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Given an address, find the corresponding client in any session.
+// The session the client belongs to becomes the current session.
+
+static net_client_t *NET_SV_FindSessionClient(net_addr_t *addr)
+{
+    net_client_t *client;
+    int i;
+
+    for (i=0; i<num_sessions; ++i)
+    {
+        sv = &sessions[i];
+        client = NET_SV_FindClient(addr);
+
+        if (client != NULL)
+        {
+            return client;
         }
     }
 
     return NULL;
 }
 
+// Choose the session that a newly connecting client should join: the
+// first session still waiting for players that has room left, so that
+// sessions fill up one at a time.  If every session is busy, the first
+// session is returned and will reject the client in the usual way.
+
+static net_session_t *NET_SV_OpenSession(void)
+{
+    int i;
+
+    for (i=0; i<num_sessions; ++i)
+    {
+        sv = &sessions[i];
+
+        if (sv->state == SERVER_WAITING_LAUNCH
+         && NET_SV_NumClients() < MAXNETNODES
+         && NET_SV_NumPlayers() < NET_SV_MaxPlayers())
+        {
+            return sv;
+        }
+    }
+
+    return &sessions[0];
+}
+
 // send a rejection packet to a client
 
 static void NET_SV_SendReject(net_addr_t *addr, char *msg)
@@ -574,6 +646,7 @@ static void NET_SV_InitNewClient(net_client_t *client, net_addr_t *addr,
     client->last_gamedata_time = 0;
 
     memset(client->sendqueue, 0xff, sizeof(client->sendqueue));
+    memset(client->resend_time, 0, sizeof(client->resend_time));
 }
 
 // parse a SYN from a client(initiating a connection)
@@ -655,7 +728,7 @@ static void NET_SV_ParseSYN(net_packet_t *packet, net_client_t *client,
     // At this point we have received a valid SYN.
 
     // Not accepting new connections?
-    if (server_state != SERVER_WAITING_LAUNCH)
+    if (sv->state != SERVER_WAITING_LAUNCH)
     {
         NET_SV_SendReject(addr,
                           "Server is not currently accepting connections");
@@ -680,19 +753,19 @@ static void NET_SV_ParseSYN(net_packet_t *packet, net_client_t *client,
     // Adopt the game mode and mission of the first connecting client:
     if (num_players == 0 && !data.drone)
     {
-        sv_gamemode = data.gamemode;
-        sv_gamemission = data.gamemission;
+        sv->gamemode = data.gamemode;
+        sv->gamemission = data.gamemission;
     }
 
     // Check the connecting client is playing the same game as all
     // the other clients
-    if (data.gamemode != sv_gamemode || data.gamemission != sv_gamemission)
+    if (data.gamemode != sv->gamemode || data.gamemission != sv->gamemission)
     {
         char msg[128];
         M_snprintf(msg, sizeof(msg),
                    "Game mismatch: server is %s (%s), client is %s (%s)",
-                   D_GameMissionString(sv_gamemission),
-                   D_GameModeString(sv_gamemode),
+                   D_GameMissionString(sv->gamemission),
+                   D_GameModeString(sv->gamemode),
                    D_GameMissionString(data.gamemission),
                    D_GameModeString(data.gamemode));
 
@@ -707,9 +780,9 @@ static void NET_SV_ParseSYN(net_packet_t *packet, net_client_t *client,
 
         for (i=0; i<MAXNETNODES; ++i)
         {
-            if (!clients[i].active)
+            if (!sv->clients[i].active)
             {
-                client = &clients[i];
+                client = &sv->clients[i];
                 break;
             }
         }
@@ -774,7 +847,7 @@ static void NET_SV_ParseLaunch(net_packet_t *packet, net_client_t *client)
 
     // Can only launch when we are in the waiting state.
 
-    if (server_state != SERVER_WAITING_LAUNCH)
+    if (sv->state != SERVER_WAITING_LAUNCH)
     {
         return;
     }
@@ -786,17 +859,17 @@ static void NET_SV_ParseLaunch(net_packet_t *packet, net_client_t *client)
 
     for (i=0; i<MAXNETNODES; ++i)
     {
-        if (!ClientConnected(&clients[i]))
+        if (!ClientConnected(&sv->clients[i]))
             continue;
 
-        launchpacket = NET_Conn_NewReliable(&clients[i].connection,
+        launchpacket = NET_Conn_NewReliable(&sv->clients[i].connection,
                                             NET_PACKET_TYPE_LAUNCH);
         NET_WriteInt8(launchpacket, num_players);
     }
 
     // Now in launch state.
 
-    server_state = SERVER_WAITING_START;
+    sv->state = SERVER_WAITING_START;
 }
 
 // Transition to the in-game state and send all players the start game
@@ -815,29 +888,29 @@ static void StartGame(void)
 
     // Check if anyone is recording a demo and set lowres_turn if so.
 
-    sv_settings.lowres_turn = false;
+    sv->settings.lowres_turn = false;
 
     for (i = 0; i < NET_MAXPLAYERS; ++i)
     {
-        if (sv_players[i] != NULL && sv_players[i]->recording_lowres)
+        if (sv->players[i] != NULL && sv->players[i]->recording_lowres)
         {
-            sv_settings.lowres_turn = true;
+            sv->settings.lowres_turn = true;
         }
     }
 
-    sv_settings.num_players = NET_SV_NumPlayers();
+    sv->settings.num_players = NET_SV_NumPlayers();
 
     // Copy player classes:
 
     for (i = 0; i < NET_MAXPLAYERS; ++i)
     {
-        if (sv_players[i] != NULL)
+        if (sv->players[i] != NULL)
         {
-            sv_settings.player_classes[i] = sv_players[i]->player_class;
+            sv->settings.player_classes[i] = sv->players[i]->player_class;
         }
         else
         {
-            sv_settings.player_classes[i] = 0;
+            sv->settings.player_classes[i] = 0;
         }
     }
 
@@ -847,25 +920,25 @@ static void StartGame(void)
 
     for (i = 0; i < MAXNETNODES; ++i)
     {
-        if (!ClientConnected(&clients[i]))
+        if (!ClientConnected(&sv->clients[i]))
             continue;
 
-        clients[i].last_gamedata_time = nowtime;
+        sv->clients[i].last_gamedata_time = nowtime;
 
-        startpacket = NET_Conn_NewReliable(&clients[i].connection,
+        startpacket = NET_Conn_NewReliable(&sv->clients[i].connection,
                                            NET_PACKET_TYPE_GAMESTART);
 
-        sv_settings.consoleplayer = clients[i].player_number;
+        sv->settings.consoleplayer = sv->clients[i].player_number;
 
-        NET_WriteSettings(startpacket, &sv_settings);
+        NET_WriteSettings(startpacket, &sv->settings);
     }
 
     // Change server state
 
-    server_state = SERVER_IN_GAME;
+    sv->state = SERVER_IN_GAME;
 
-    memset(recvwindow, 0, sizeof(recvwindow));
-    recvwindow_start = 0;
+    memset(sv->recvwindow, 0, sizeof(sv->recvwindow));
+    sv->recvwindow_start = 0;
 }
 
 // Returns true when all nodes have indicated readiness to start the game.
@@ -876,7 +949,7 @@ static boolean AllNodesReady(void)
 
     for (i = 0; i < MAXNETNODES; ++i)
     {
-        if (ClientConnected(&clients[i]) && !clients[i].ready)
+        if (ClientConnected(&sv->clients[i]) && !sv->clients[i].ready)
         {
             return false;
         }
@@ -904,9 +977,9 @@ static void SendAllWaitingData(void)
 
     for (i = 0; i < MAXNETNODES; ++i)
     {
-        if (ClientConnected(&clients[i]) && clients[i].ready)
+        if (ClientConnected(&sv->clients[i]) && sv->clients[i].ready)
         {
-            NET_SV_SendWaitingData(&clients[i]);
+            NET_SV_SendWaitingData(&sv->clients[i]);
         }
     }
 }
@@ -919,7 +992,7 @@ static void NET_SV_ParseGameStart(net_packet_t *packet, net_client_t *client)
 
     // Can only start a game if we are in the waiting start state.
 
-    if (server_state != SERVER_WAITING_START)
+    if (sv->state != SERVER_WAITING_START)
     {
         return;
     }
@@ -935,12 +1008,12 @@ static void NET_SV_ParseGameStart(net_packet_t *packet, net_client_t *client)
 
         // Check the game settings are valid
 
-        if (!NET_ValidGameSettings(sv_gamemode, sv_gamemission, &settings))
+        if (!NET_ValidGameSettings(sv->gamemode, sv->gamemission, &settings))
         {
             return;
         }
 
-        sv_settings = settings;
+        sv->settings = settings;
     }
 
     client->ready = true;
@@ -954,6 +1027,63 @@ static void NET_SV_ParseGameStart(net_packet_t *packet, net_client_t *client)
     SendAllWaitingData();
 }
 
+// Send a single resend request to a client covering all tics in the
+// receive window that have timed out, with a bitmap of those needed.
+
+static void NET_SV_SendSelectiveResendRequest(net_client_t *client,
+                                              boolean *need_resend)
+{
+    net_packet_t *packet;
+    unsigned int nowtime;
+    int first, last;
+    int i;
+
+    first = -1;
+    last = -1;
+
+    for (i=0; i<BACKUPTICS; ++i)
+    {
+        if (need_resend[i])
+        {
+            if (first < 0)
+            {
+                first = i;
+            }
+
+            last = i;
+        }
+    }
+
+    if (first < 0)
+    {
+        return;
+    }
+
+    packet = NET_NewPacket(20);
+
+    NET_WriteInt16(packet, NET_PACKET_TYPE_GAMEDATA_RESEND);
+    NET_WriteInt32(packet, sv->recvwindow_start + first);
+    NET_WriteInt8(packet, last - first + 1);
+
+    for (i=first; i<=last; ++i)
+    {
+        NET_WriteBits(packet, need_resend[i], 1);
+    }
+
+    NET_Conn_SendPacket(&client->connection, packet);
+    NET_FreePacket(packet);
+
+    nowtime = I_GetTimeMS();
+
+    for (i=first; i<=last; ++i)
+    {
+        if (need_resend[i])
+        {
+            sv->recvwindow[i][client->player_number].resend_time = nowtime;
+        }
+    }
+}
+
 // Send a resend request to a client
 
 static void NET_SV_SendResendRequest(net_client_t *client, int start, int end)
@@ -966,6 +1096,23 @@ static void NET_SV_SendResendRequest(net_client_t *client, int start, int end)
 
     //printf("SV: send resend for %i-%i\n", start, end);
 
+    // With selective acknowledgements, the client expects a bitmap of
+    // the tics needed, so ask for every tic in the range.
+
+    if (client->connection.protocol == NET_PROTOCOL_CRISPY_MULTIPLAYER_DOOM_1)
+    {
+        boolean need_resend[BACKUPTICS];
+
+        for (i=0; i<BACKUPTICS; ++i)
+        {
+            index = sv->recvwindow_start + i;
+            need_resend[i] = index >= start && index <= end;
+        }
+
+        NET_SV_SendSelectiveResendRequest(client, need_resend);
+        return;
+    }
+
     packet = NET_NewPacket(20);
 
     NET_WriteInt16(packet, NET_PACKET_TYPE_GAMEDATA_RESEND);
@@ -981,7 +1128,7 @@ static void NET_SV_SendResendRequest(net_client_t *client, int start, int end)
 
     for (i=start; i<=end; ++i)
     {
-        index = i - recvwindow_start;
+        index = i - sv->recvwindow_start;
 
         if (index >= BACKUPTICS)
         {
@@ -990,7 +1137,7 @@ static void NET_SV_SendResendRequest(net_client_t *client, int start, int end)
             continue;
         }
         
-        recvobj = &recvwindow[index][client->player_number];
+        recvobj = &sv->recvwindow[index][client->player_number];
 
         recvobj->resend_time = nowtime;
     }
@@ -1000,6 +1147,7 @@ static void NET_SV_SendResendRequest(net_client_t *client, int start, int end)
 
 static void NET_SV_CheckResends(net_client_t *client)
 {
+    boolean need_resend[BACKUPTICS];
     int i;
     int player;
     int resend_start, resend_end;
@@ -1014,18 +1162,29 @@ static void NET_SV_CheckResends(net_client_t *client)
     for (i=0; i<BACKUPTICS; ++i)
     {
         net_client_recv_t *recvobj;
-        boolean need_resend;
 
-        recvobj = &recvwindow[i][player];
+        recvobj = &sv->recvwindow[i][player];
 
         // if need_resend is true, this tic needs another retransmit
         // request (300ms timeout)
 
-        need_resend = !recvobj->active
-                   && recvobj->resend_time != 0
-                   && nowtime > recvobj->resend_time + 300;
+        need_resend[i] = !recvobj->active
+                      && recvobj->resend_time != 0
+                      && nowtime > recvobj->resend_time + 300;
+    }
+
+    // With selective acknowledgements, all timed out tics go in one
+    // request, whether or not they are contiguous.
+
+    if (client->connection.protocol == NET_PROTOCOL_CRISPY_MULTIPLAYER_DOOM_1)
+    {
+        NET_SV_SendSelectiveResendRequest(client, need_resend);
+        return;
+    }
 
-        if (need_resend)
+    for (i=0; i<BACKUPTICS; ++i)
+    {
+        if (need_resend[i])
         {
             // Start a new run of resend tics?
  
@@ -1044,8 +1203,8 @@ static void NET_SV_CheckResends(net_client_t *client)
 
                 //printf("SV: resend request timed out: %i-%i\n", resend_start, resend_end);
                 NET_SV_SendResendRequest(client, 
-                                         recvwindow_start + resend_start,
-                                         recvwindow_start + resend_end);
+                                         sv->recvwindow_start + resend_start,
+                                         sv->recvwindow_start + resend_end);
 
                 resend_start = -1;
             }
@@ -1055,8 +1214,8 @@ static void NET_SV_CheckResends(net_client_t *client)
     if (resend_start >= 0)
     {
         NET_SV_SendResendRequest(client, 
-                                 recvwindow_start + resend_start,
-                                 recvwindow_start + resend_end);
+                                 sv->recvwindow_start + resend_start,
+                                 sv->recvwindow_start + resend_end);
     }
 }
 
@@ -1074,7 +1233,7 @@ static void NET_SV_ParseGameData(net_packet_t *packet, net_client_t *client)
     int resend_start, resend_end;
     int index;
 
-    if (server_state != SERVER_IN_GAME)
+    if (sv->state != SERVER_IN_GAME)
     {
         return;
     }
@@ -1112,13 +1271,14 @@ static void NET_SV_ParseGameData(net_packet_t *packet, net_client_t *client)
         net_ticdiff_t diff;
         signed int latency;
 
-        if (!NET_ReadSInt16(packet, &latency)
-         || !NET_ReadTiccmdDiff(packet, &diff, sv_settings.lowres_turn))
+        if (!NET_ReadLatency(packet, &latency, client->connection.protocol)
+         || !NET_ReadTiccmdDiff(packet, &diff, sv->settings.lowres_turn,
+                                client->connection.protocol))
         {
             return;
         }
 
-        index = seq + i - recvwindow_start;
+        index = seq + i - sv->recvwindow_start;
 
         if (index < 0 || index >= BACKUPTICS)
         {
@@ -1127,7 +1287,7 @@ static void NET_SV_ParseGameData(net_packet_t *packet, net_client_t *client)
             continue;
         }
 
-        recvobj = &recvwindow[index][player];
+        recvobj = &sv->recvwindow[index][player];
         recvobj->active = true;
         recvobj->diff = diff;
         recvobj->latency = latency;
@@ -1148,7 +1308,7 @@ static void NET_SV_ParseGameData(net_packet_t *packet, net_client_t *client)
 
     //printf("SV: %p: %i\n", client, seq);
 
-    resend_end = seq - recvwindow_start;
+    resend_end = seq - sv->recvwindow_start;
 
     if (resend_end <= 0)
         return;
@@ -1161,7 +1321,7 @@ static void NET_SV_ParseGameData(net_packet_t *packet, net_client_t *client)
     
     while (index >= 0)
     {
-        recvobj = &recvwindow[index][player];
+        recvobj = &sv->recvwindow[index][player];
 
         if (recvobj->active)
         {
@@ -1187,41 +1347,13 @@ static void NET_SV_ParseGameData(net_packet_t *packet, net_client_t *client)
     {
             /*
         printf("missed %i-%i before %i, send resend\n",
-                        recvwindow_start + resend_start,
-                        recvwindow_start + resend_end - 1,
+                        sv->recvwindow_start + resend_start,
+                        sv->recvwindow_start + resend_end - 1,
                         seq);
                         */
         NET_SV_SendResendRequest(client, 
-                                 recvwindow_start + resend_start, 
-                                 recvwindow_start + resend_end - 1);
-    }
-}
-
-static void NET_SV_ParseGameDataACK(net_packet_t *packet, net_client_t *client)
-{
-    unsigned int ackseq;
-
-    if (server_state != SERVER_IN_GAME)
-    {
-        return;
-    }
-
-    // Read header
-
-    if (!NET_ReadInt8(packet, &ackseq))
-    {
-        return;
-    }
-
-    // Expand 8-bit values to the full sequence number
-
-    ackseq = NET_SV_ExpandTicNum(ackseq);
-
-    // Higher acknowledgement point than we already have?
-
-    if (ackseq > client->acknowledged)
-    {
-        client->acknowledged = ackseq;
+                                 sv->recvwindow_start + resend_start, 
+                                 sv->recvwindow_start + resend_end - 1);
     }
 }
 
@@ -1255,7 +1387,8 @@ static void NET_SV_SendTics(net_client_t *client,
 
         // Add command
        
-        NET_WriteFullTiccmd(packet, cmd, sv_settings.lowres_turn);
+        NET_WriteFullTiccmd(packet, cmd, sv->settings.lowres_turn,
+                            client->connection.protocol);
     }
     
     // Send packet
@@ -1265,6 +1398,97 @@ static void NET_SV_SendTics(net_client_t *client,
     NET_FreePacket(packet);
 }
 
+// Parse the bitmap of received tics in a selective acknowledgement and
+// resend any holes: tics before the latest received that the client has
+// not got.  Each tic is resent at most once per SACK_RESEND_TIME ms, as
+// every acknowledgement until the resend arrives will report the hole.
+
+static void NET_SV_ParseSACK(net_packet_t *packet, net_client_t *client,
+                             unsigned int ackseq)
+{
+    unsigned int num_tics;
+    unsigned int received;
+    unsigned int nowtime;
+    unsigned int i;
+    int run_start;
+
+    if (!NET_ReadInt8(packet, &num_tics))
+    {
+        return;
+    }
+
+    nowtime = I_GetTimeMS();
+    run_start = -1;
+
+    for (i=0; i<=num_tics; ++i)
+    {
+        unsigned int tic = ackseq + i;
+        boolean resend = false;
+
+        if (i < num_tics)
+        {
+            if (!NET_ReadBits(packet, &received, 1))
+            {
+                return;
+            }
+
+            resend = !received
+                  && tic < (unsigned int) client->sendseq
+                  && client->sendqueue[tic % BACKUPTICS].seq == tic
+                  && nowtime - client->resend_time[tic % BACKUPTICS]
+                         >= SACK_RESEND_TIME;
+        }
+
+        if (resend)
+        {
+            client->resend_time[tic % BACKUPTICS] = nowtime;
+
+            if (run_start < 0)
+            {
+                run_start = tic;
+            }
+        }
+        else if (run_start >= 0)
+        {
+            NET_SV_SendTics(client, run_start, tic - 1);
+            run_start = -1;
+        }
+    }
+}
+
+static void NET_SV_ParseGameDataACK(net_packet_t *packet, net_client_t *client)
+{
+    unsigned int ackseq;
+
+    if (sv->state != SERVER_IN_GAME)
+    {
+        return;
+    }
+
+    // Read header
+
+    if (!NET_ReadInt8(packet, &ackseq))
+    {
+        return;
+    }
+
+    // Expand 8-bit values to the full sequence number
+
+    ackseq = NET_SV_ExpandTicNum(ackseq);
+
+    // Higher acknowledgement point than we already have?
+
+    if (ackseq > client->acknowledged)
+    {
+        client->acknowledged = ackseq;
+    }
+
+    if (client->connection.protocol == NET_PROTOCOL_CRISPY_MULTIPLAYER_DOOM_1)
+    {
+        NET_SV_ParseSACK(packet, client, ackseq);
+    }
+}
+
 // Parse a retransmission request from a client
 
 static void NET_SV_ParseResendRequest(net_packet_t *packet, net_client_t *client)
@@ -1323,7 +1547,7 @@ void NET_SV_SendQueryResponse(net_addr_t *addr)
 
     // Server state
 
-    querydata.server_state = server_state;
+    querydata.server_state = sv->state;
 
     // Number of players/maximum players
 
@@ -1332,8 +1556,8 @@ void NET_SV_SendQueryResponse(net_addr_t *addr)
 
     // Game mode/mission
 
-    querydata.gamemode = sv_gamemode;
-    querydata.gamemission = sv_gamemission;
+    querydata.gamemode = sv->gamemode;
+    querydata.gamemission = sv->gamemission;
 
     //!
     // @category net
@@ -1377,9 +1601,15 @@ static void NET_SV_Packet(net_packet_t *packet, net_addr_t *addr)
         return;
     }
 
-    // Find which client this packet came from
+    // Find which session and client this packet came from.  Packets
+    // from unknown addresses go to the session that new clients join.
 
-    client = NET_SV_FindClient(addr);
+    client = NET_SV_FindSessionClient(addr);
+
+    if (client == NULL)
+    {
+        sv = NET_SV_OpenSession();
+    }
 
     // Read the packet type
 
@@ -1437,7 +1667,7 @@ static void NET_SV_Packet(net_packet_t *packet, net_addr_t *addr)
     // If this address is not in the list of clients, be sure to
     // free it back.
 
-    if (NET_SV_FindClient(addr) == NULL)
+    if (NET_SV_FindSessionClient(addr) == NULL)
     {
         NET_FreeAddress(addr);
     }
@@ -1462,7 +1692,7 @@ static void NET_SV_PumpSendQueue(net_client_t *client)
     
     // Work out the index into the receive window
    
-    recv_index = client->sendseq - recvwindow_start;
+    recv_index = client->sendseq - sv->recvwindow_start;
 
     if (recv_index < 0 || recv_index >= BACKUPTICS)
     {
@@ -1476,19 +1706,19 @@ static void NET_SV_PumpSendQueue(net_client_t *client)
 
     for (i=0; i<NET_MAXPLAYERS; ++i)
     {
-        if (sv_players[i] == client)
+        if (sv->players[i] == client)
         {
             // Client does not rely on itself for data
 
             continue;
         }
 
-        if (sv_players[i] == NULL || !ClientConnected(sv_players[i]))
+        if (sv->players[i] == NULL || !ClientConnected(sv->players[i]))
         {
             continue;
         }
 
-        if (!recvwindow[recv_index][i].active)
+        if (!sv->recvwindow[recv_index][i].active)
         {
             // We do not have this player's ticcmd, so we cannot
             // generate a complete command yet.
@@ -1505,7 +1735,7 @@ static void NET_SV_PumpSendQueue(net_client_t *client)
     // and never stopping. Don't let the server get too far ahead
     // of the client.
 
-    if (num_players == 0 && client->sendseq > recvwindow_start + 10)
+    if (num_players == 0 && client->sendseq > sv->recvwindow_start + 10)
     {
         return;
     }
@@ -1524,7 +1754,7 @@ static void NET_SV_PumpSendQueue(net_client_t *client)
     {
         net_client_recv_t *recvobj;
 
-        if (sv_players[i] == client)
+        if (sv->players[i] == client)
         {
             // Not the player we are sending to
 
@@ -1532,7 +1762,7 @@ static void NET_SV_PumpSendQueue(net_client_t *client)
             continue;
         }
         
-        if (sv_players[i] == NULL || !recvwindow[recv_index][i].active)
+        if (sv->players[i] == NULL || !sv->recvwindow[recv_index][i].active)
         {
             cmd.playeringame[i] = false;
             continue;
@@ -1540,7 +1770,7 @@ static void NET_SV_PumpSendQueue(net_client_t *client)
 
         cmd.playeringame[i] = true;
 
-        recvobj = &recvwindow[recv_index][i];
+        recvobj = &sv->recvwindow[recv_index][i];
 
         cmd.cmds[i] = recvobj->diff;
 
@@ -1556,7 +1786,7 @@ static void NET_SV_PumpSendQueue(net_client_t *client)
 
     // Transmit the new tic to the client
 
-    starttic = client->sendseq - sv_settings.extratics;
+    starttic = client->sendseq - sv->settings.extratics;
     endtic = client->sendseq;
 
     if (starttic < 0)
@@ -1597,15 +1827,15 @@ void NET_SV_CheckDeadlock(net_client_t *client)
 
         for (i=0; i<BACKUPTICS; ++i)
         {
-            if (!recvwindow[client->player_number][i].active)
+            if (!sv->recvwindow[client->player_number][i].active)
             {
                 //printf("Possible deadlock: Sending resend request\n");
 
                 // Found a tic we haven't received.  Send a resend request.
 
                 NET_SV_SendResendRequest(client,
-                                         recvwindow_start + i,
-                                         recvwindow_start + i + 5);
+                                         sv->recvwindow_start + i,
+                                         sv->recvwindow_start + i + 5);
 
                 client->last_gamedata_time = nowtime;
                 break;
@@ -1621,14 +1851,14 @@ static void NET_SV_GameEnded(void)
 {
     int i;
 
-    server_state = SERVER_WAITING_LAUNCH;
-    sv_gamemode = indetermined;
+    sv->state = SERVER_WAITING_LAUNCH;
+    sv->gamemode = indetermined;
 
     for (i=0; i<MAXNETNODES; ++i)
     {
-        if (clients[i].active)
+        if (sv->clients[i].active)
         {
-            NET_SV_DisconnectClient(&clients[i]);
+            NET_SV_DisconnectClient(&sv->clients[i]);
         }
     }
 }
@@ -1657,7 +1887,7 @@ static void NET_SV_RunClient(net_client_t *client)
         // If we were about to start a game, any player disconnecting
         // should cause an abort.
 
-        if (server_state == SERVER_WAITING_START && !client->drone)
+        if (sv->state == SERVER_WAITING_START && !client->drone)
         {
             NET_SV_BroadcastMessage("Game startup aborted because "
                                     "player '%s' disconnected.",
@@ -1686,7 +1916,7 @@ static void NET_SV_RunClient(net_client_t *client)
         return;
     }
 
-    if (server_state == SERVER_WAITING_LAUNCH)
+    if (sv->state == SERVER_WAITING_LAUNCH)
     {
         // Waiting for the game to start
 
@@ -1700,7 +1930,7 @@ static void NET_SV_RunClient(net_client_t *client)
         }
     }
 
-    if (server_state == SERVER_IN_GAME)
+    if (sv->state == SERVER_IN_GAME)
     {
         NET_SV_PumpSendQueue(client);
         NET_SV_CheckDeadlock(client);
@@ -1715,30 +1945,47 @@ void NET_SV_AddModule(net_module_t *module)
     NET_AddModule(server_context, module);
 }
 
-// Initialize server and wait for connections
+// Initialize server and wait for connections, hosting the given number
+// of independent game sessions.
 
-void NET_SV_Init(void)
+void NET_SV_InitSessions(int count)
 {
-    int i;
+    int i, j;
 
     // initialize send/receive context
 
     server_context = NET_NewContext();
 
-    // no clients yet
-   
-    for (i=0; i<MAXNETNODES; ++i) 
+    num_sessions = count;
+    sessions = Z_Malloc(sizeof(net_session_t) * num_sessions, PU_STATIC, 0);
+    memset(sessions, 0, sizeof(net_session_t) * num_sessions);
+
+    for (j=0; j<num_sessions; ++j)
     {
-        clients[i].active = false;
-    }
+        sv = &sessions[j];
 
-    NET_SV_AssignPlayers();
+        // no clients yet
+
+        for (i=0; i<MAXNETNODES; ++i)
+        {
+            sv->clients[i].active = false;
+        }
+
+        NET_SV_AssignPlayers();
 
-    server_state = SERVER_WAITING_LAUNCH;
-    sv_gamemode = indetermined;
+        sv->state = SERVER_WAITING_LAUNCH;
+        sv->gamemode = indetermined;
+    }
+
+    sv = &sessions[0];
     server_initialized = true;
 }
 
+void NET_SV_Init(void)
+{
+    NET_SV_InitSessions(1);
+}
+
 static void UpdateMasterServer(void)
 {
     unsigned int now;
@@ -1802,6 +2049,46 @@ void NET_SV_RegisterWithMaster(void)
     }
 }
 
+// Run the timer-driven parts of the current session
+
+static void NET_SV_RunSession(void)
+{
+    int i;
+
+    // "Run" any clients that may have things to do, independent of responses
+    // to received packets
+
+    for (i=0; i<MAXNETNODES; ++i)
+    {
+        if (sv->clients[i].active)
+        {
+            NET_SV_RunClient(&sv->clients[i]);
+        }
+    }
+
+    switch (sv->state)
+    {
+        case SERVER_WAITING_LAUNCH:
+            break;
+
+        case SERVER_WAITING_START:
+            CheckStartGame();
+            break;
+
+        case SERVER_IN_GAME:
+            NET_SV_AdvanceWindow();
+
+            for (i = 0; i < NET_MAXPLAYERS; ++i)
+            {
+                if (sv->players[i] != NULL && ClientConnected(sv->players[i]))
+                {
+                    NET_SV_CheckResends(sv->players[i]);
+                }
+            }
+            break;
+    }
+}
+
 // Run server code to check for new packets/send packets as the server
 // requires
 
@@ -1827,43 +2114,153 @@ void NET_SV_Run(void)
         UpdateMasterServer();
     }
 
-    // "Run" any clients that may have things to do, independent of responses
-    // to received packets
+    for (i=0; i<num_sessions; ++i)
+    {
+        sv = &sessions[i];
+        NET_SV_RunSession();
+    }
+
+    // Send everything generated this run in one go.
+
+    NET_FlushPackets(server_context);
+}
+
+// Longest time the server will wait for a packet before running its
+// timers anyway; this also bounds the error on the master server refresh.
+
+#define MAX_EVENT_WAIT 1000
+
+// Work out how long (in ms) the current session can wait for packets
+// before NET_SV_Run next has timer-driven work to do: expired resend
+// requests (NET_SV_CheckResends), deadlock checks (NET_SV_CheckDeadlock),
+// waiting data updates and the connection keepalives/retries.
+
+static int NET_SV_SessionTimeToNextEvent(unsigned int nowtime)
+{
+    net_client_t *client;
+    net_client_recv_t *recvobj;
+    int result, t;
+    int i, j;
+
+    result = MAX_EVENT_WAIT;
 
     for (i=0; i<MAXNETNODES; ++i)
     {
-        if (clients[i].active)
+        client = &sv->clients[i];
+
+        if (!client->active)
+        {
+            continue;
+        }
+
+        t = NET_Conn_TimeToNextEvent(&client->connection);
+
+        if (t < result)
+        {
+            result = t;
+        }
+
+        if (!ClientConnected(client))
+        {
+            continue;
+        }
+
+        if (sv->state == SERVER_WAITING_LAUNCH)
+        {
+            if (client->last_send_time < 0)
+            {
+                return 0;
+            }
+
+            t = NET_TimeUntil(nowtime, client->last_send_time, 1000);
+        }
+        else if (sv->state == SERVER_IN_GAME && !client->drone)
+        {
+            t = NET_TimeUntil(nowtime, client->last_gamedata_time, 1000);
+        }
+        else
+        {
+            continue;
+        }
+
+        if (t < result)
         {
-            NET_SV_RunClient(&clients[i]);
+            result = t;
         }
     }
 
-    switch (server_state)
+    if (sv->state == SERVER_IN_GAME)
     {
-        case SERVER_WAITING_LAUNCH:
-            break;
+        for (i=0; i<BACKUPTICS; ++i)
+        {
+            for (j=0; j<NET_MAXPLAYERS; ++j)
+            {
+                recvobj = &sv->recvwindow[i][j];
 
-        case SERVER_WAITING_START:
-            CheckStartGame();
-            break;
+                if (sv->players[j] == NULL || recvobj->active
+                 || recvobj->resend_time == 0)
+                {
+                    continue;
+                }
 
-        case SERVER_IN_GAME:
-            NET_SV_AdvanceWindow();
+                t = NET_TimeUntil(nowtime, recvobj->resend_time, 300);
 
-            for (i = 0; i < NET_MAXPLAYERS; ++i)
-            {
-                if (sv_players[i] != NULL && ClientConnected(sv_players[i]))
+                if (t < result)
                 {
-                    NET_SV_CheckResends(sv_players[i]);
+                    result = t;
                 }
             }
-            break;
+        }
     }
+
+    return result;
 }
 
-void NET_SV_Shutdown(void)
+int NET_SV_TimeToNextEvent(void)
 {
+    unsigned int nowtime;
+    int result, t;
     int i;
+
+    if (!server_initialized)
+    {
+        return MAX_EVENT_WAIT;
+    }
+
+    nowtime = I_GetTimeMS();
+    result = MAX_EVENT_WAIT;
+
+    for (i=0; i<num_sessions && result > 0; ++i)
+    {
+        sv = &sessions[i];
+        t = NET_SV_SessionTimeToNextEvent(nowtime);
+
+        if (t < result)
+        {
+            result = t;
+        }
+    }
+
+    return result;
+}
+
+// Block until a packet arrives for the server or timeout ms have passed.
+// Returns true if there is a packet waiting to be processed.
+
+boolean NET_SV_WaitPacket(int timeout)
+{
+    if (!server_initialized)
+    {
+        I_Sleep(timeout);
+        return false;
+    }
+
+    return NET_WaitPacket(server_context, timeout);
+}
+
+void NET_SV_Shutdown(void)
+{
+    int i, j;
     boolean running;
     int start_time;
 
@@ -1875,12 +2272,17 @@ void NET_SV_Shutdown(void)
     fprintf(stderr, "SV: Shutting down server...\n");
 
     // Disconnect all clients
-    
-    for (i=0; i<MAXNETNODES; ++i)
+
+    for (j=0; j<num_sessions; ++j)
     {
-        if (clients[i].active)
+        sv = &sessions[j];
+
+        for (i=0; i<MAXNETNODES; ++i)
         {
-            NET_SV_DisconnectClient(&clients[i]);
+            if (sv->clients[i].active)
+            {
+                NET_SV_DisconnectClient(&sv->clients[i]);
+            }
         }
     }
 
@@ -1895,11 +2297,14 @@ void NET_SV_Shutdown(void)
 
         running = false;
 
-        for (i=0; i<MAXNETNODES; ++i)
+        for (j=0; j<num_sessions; ++j)
         {
-            if (clients[i].active)
+            for (i=0; i<MAXNETNODES; ++i)
             {
-                running = true;
+                if (sessions[j].clients[i].active)
+                {
+                    running = true;
+                }
             }
         }
 
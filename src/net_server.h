@@ -21,10 +21,23 @@
 
 void NET_SV_Init(void);
 
+// initialize server hosting several independent game sessions
+
+void NET_SV_InitSessions(int count);
+
 // run server: check for new packets received etc.
 
 void NET_SV_Run(void);
 
+// Number of ms until the server next has timer-driven work to do
+
+int NET_SV_TimeToNextEvent(void);
+
+// Wait up to timeout ms for a packet to arrive for the server.
+// Returns true if a packet is waiting.
+
+boolean NET_SV_WaitPacket(int timeout);
+
 // Shut down the server
 // Blocks until all clients disconnect, or until a 5 second timeout
 
@@ -32,6 +32,8 @@ static struct
     const char *name;
 } protocol_names[] = {
     {NET_PROTOCOL_CHOCOLATE_DOOM_0, "CHOCOLATE_DOOM_0"},
+    {NET_PROTOCOL_CRISPY_MULTIPLAYER_DOOM_0, "CRISPY_MULTIPLAYER_DOOM_0"},
+    {NET_PROTOCOL_CRISPY_MULTIPLAYER_DOOM_1, "CRISPY_MULTIPLAYER_DOOM_1"},
 };
 
 void NET_WriteConnectData(net_packet_t *packet, net_connect_data_t *data)
@@ -231,9 +233,248 @@ void NET_WriteQueryData(net_packet_t *packet, net_querydata_t *query)
     NET_WriteProtocolList(packet);
 }
 
+// [Crispy Multiplayer Doom] Bit-packed encoding used by
+// NET_PROTOCOL_CRISPY_MULTIPLAYER_DOOM_1.
+//
+// Variable-length integers are sent as groups of 4 bits, least
+// significant first, each followed by a bit saying whether another group
+// follows.  Signed values are zigzag-encoded first so that small negative
+// numbers stay small.
+
+static void WriteVarUInt(net_packet_t *packet, unsigned int value)
+{
+    unsigned int nibble;
+
+    do
+    {
+        nibble = value & 0xf;
+        value >>= 4;
+        NET_WriteBits(packet, (nibble << 1) | (value != 0), 5);
+    } while (value != 0);
+}
+
+static boolean ReadVarUInt(net_packet_t *packet, unsigned int *value)
+{
+    unsigned int group;
+    int shift;
+
+    *value = 0;
+
+    for (shift = 0; shift < 32; shift += 4)
+    {
+        if (!NET_ReadBits(packet, &group, 5))
+        {
+            return false;
+        }
+
+        *value |= (group >> 1) << shift;
+
+        if ((group & 1) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void WriteVarSInt(net_packet_t *packet, signed int value)
+{
+    WriteVarUInt(packet, ((unsigned int) value << 1) ^ (value < 0 ? ~0U : 0));
+}
+
+static boolean ReadVarSInt(net_packet_t *packet, signed int *value)
+{
+    unsigned int u;
+
+    if (!ReadVarUInt(packet, &u))
+    {
+        return false;
+    }
+
+    *value = (signed int) ((u >> 1) ^ (~(u & 1) + 1));
+
+    return true;
+}
+
+// Movement is most often changing to or from zero (keys pressed and
+// released), so zero gets a one-bit code.
+
+static void WriteMoveBits(net_packet_t *packet, signed char move)
+{
+    NET_WriteBits(packet, move != 0, 1);
+
+    if (move != 0)
+    {
+        NET_WriteBits(packet, (byte) move, 8);
+    }
+}
+
+static boolean ReadMoveBits(net_packet_t *packet, signed char *move)
+{
+    unsigned int val;
+
+    if (!NET_ReadBits(packet, &val, 1))
+        return false;
+
+    if (val == 0)
+    {
+        *move = 0;
+        return true;
+    }
+
+    if (!NET_ReadBits(packet, &val, 8))
+        return false;
+
+    *move = (signed char) val;
+
+    return true;
+}
+
+// The first five diff flags are the ones that change during normal play;
+// the game-specific and chat flags follow behind an extension bit.
+
+#define NET_TICDIFF_COMMON_BITS 5
+
+static void WriteTiccmdDiffBits(net_packet_t *packet, net_ticdiff_t *diff,
+                                boolean lowres_turn)
+{
+    unsigned int extra;
+
+    NET_WriteBits(packet, diff->diff, NET_TICDIFF_COMMON_BITS);
+
+    extra = diff->diff >> NET_TICDIFF_COMMON_BITS;
+    NET_WriteBits(packet, extra != 0, 1);
+
+    if (extra != 0)
+    {
+        NET_WriteBits(packet, extra, 8 - NET_TICDIFF_COMMON_BITS);
+    }
+
+    if (diff->diff & NET_TICDIFF_FORWARD)
+        WriteMoveBits(packet, diff->cmd.forwardmove);
+    if (diff->diff & NET_TICDIFF_SIDE)
+        WriteMoveBits(packet, diff->cmd.sidemove);
+    if (diff->diff & NET_TICDIFF_TURN)
+    {
+        if (lowres_turn)
+        {
+            WriteVarSInt(packet, diff->cmd.angleturn / 256);
+        }
+        else
+        {
+            WriteVarSInt(packet, diff->cmd.angleturn);
+        }
+    }
+    if (diff->diff & NET_TICDIFF_BUTTONS)
+        NET_WriteBits(packet, diff->cmd.buttons, 8);
+    if (diff->diff & NET_TICDIFF_CONSISTANCY)
+        NET_WriteBits(packet, diff->cmd.consistancy, 8);
+    if (diff->diff & NET_TICDIFF_CHATCHAR)
+        NET_WriteBits(packet, diff->cmd.chatchar, 8);
+    if (diff->diff & NET_TICDIFF_RAVEN)
+    {
+        NET_WriteBits(packet, diff->cmd.lookfly, 8);
+        NET_WriteBits(packet, diff->cmd.arti, 8);
+    }
+    if (diff->diff & NET_TICDIFF_STRIFE)
+    {
+        NET_WriteBits(packet, diff->cmd.buttons2, 8);
+        NET_WriteBits(packet, diff->cmd.inventory & 0xffff, 16);
+    }
+}
+
+static boolean ReadTiccmdDiffBits(net_packet_t *packet, net_ticdiff_t *diff,
+                                  boolean lowres_turn)
+{
+    unsigned int val;
+    signed int sval;
+
+    if (!NET_ReadBits(packet, &diff->diff, NET_TICDIFF_COMMON_BITS)
+     || !NET_ReadBits(packet, &val, 1))
+        return false;
+
+    if (val != 0)
+    {
+        if (!NET_ReadBits(packet, &val, 8 - NET_TICDIFF_COMMON_BITS))
+            return false;
+        diff->diff |= val << NET_TICDIFF_COMMON_BITS;
+    }
+
+    if (diff->diff & NET_TICDIFF_FORWARD)
+    {
+        if (!ReadMoveBits(packet, &diff->cmd.forwardmove))
+            return false;
+    }
+
+    if (diff->diff & NET_TICDIFF_SIDE)
+    {
+        if (!ReadMoveBits(packet, &diff->cmd.sidemove))
+            return false;
+    }
+
+    if (diff->diff & NET_TICDIFF_TURN)
+    {
+        if (!ReadVarSInt(packet, &sval))
+            return false;
+        diff->cmd.angleturn = lowres_turn ? sval * 256 : sval;
+    }
+
+    if (diff->diff & NET_TICDIFF_BUTTONS)
+    {
+        if (!NET_ReadBits(packet, &val, 8))
+            return false;
+        diff->cmd.buttons = val;
+    }
+
+    if (diff->diff & NET_TICDIFF_CONSISTANCY)
+    {
+        if (!NET_ReadBits(packet, &val, 8))
+            return false;
+        diff->cmd.consistancy = val;
+    }
+
+    if (diff->diff & NET_TICDIFF_CHATCHAR)
+    {
+        if (!NET_ReadBits(packet, &val, 8))
+            return false;
+        diff->cmd.chatchar = val;
+    }
+
+    if (diff->diff & NET_TICDIFF_RAVEN)
+    {
+        if (!NET_ReadBits(packet, &val, 8))
+            return false;
+        diff->cmd.lookfly = val;
+
+        if (!NET_ReadBits(packet, &val, 8))
+            return false;
+        diff->cmd.arti = val;
+    }
+
+    if (diff->diff & NET_TICDIFF_STRIFE)
+    {
+        if (!NET_ReadBits(packet, &val, 8))
+            return false;
+        diff->cmd.buttons2 = val;
+
+        if (!NET_ReadBits(packet, &val, 16))
+            return false;
+        diff->cmd.inventory = val;
+    }
+
+    return true;
+}
+
 void NET_WriteTiccmdDiff(net_packet_t *packet, net_ticdiff_t *diff,
-                         boolean lowres_turn)
+                         boolean lowres_turn, net_protocol_t protocol)
 {
+    if (protocol == NET_PROTOCOL_CRISPY_MULTIPLAYER_DOOM_1)
+    {
+        WriteTiccmdDiffBits(packet, diff, lowres_turn);
+        return;
+    }
+
     // Header
 
     NET_WriteInt8(packet, diff->diff);
@@ -274,11 +515,16 @@ void NET_WriteTiccmdDiff(net_packet_t *packet, net_ticdiff_t *diff,
 }
 
 boolean NET_ReadTiccmdDiff(net_packet_t *packet, net_ticdiff_t *diff,
-                           boolean lowres_turn)
+                           boolean lowres_turn, net_protocol_t protocol)
 {
     unsigned int val;
     signed int sval;
 
+    if (protocol == NET_PROTOCOL_CRISPY_MULTIPLAYER_DOOM_1)
+    {
+        return ReadTiccmdDiffBits(packet, diff, lowres_turn);
+    }
+
     // Read header
 
     if (!NET_ReadInt8(packet, &diff->diff))
@@ -362,6 +608,34 @@ boolean NET_ReadTiccmdDiff(net_packet_t *packet, net_ticdiff_t *diff,
     return true;
 }
 
+// Latency values sent along with each tic
+
+void NET_WriteLatency(net_packet_t *packet, signed int latency,
+                      net_protocol_t protocol)
+{
+    if (protocol == NET_PROTOCOL_CRISPY_MULTIPLAYER_DOOM_1)
+    {
+        WriteVarSInt(packet, latency);
+    }
+    else
+    {
+        NET_WriteInt16(packet, latency);
+    }
+}
+
+boolean NET_ReadLatency(net_packet_t *packet, signed int *latency,
+                        net_protocol_t protocol)
+{
+    if (protocol == NET_PROTOCOL_CRISPY_MULTIPLAYER_DOOM_1)
+    {
+        return ReadVarSInt(packet, latency);
+    }
+    else
+    {
+        return NET_ReadSInt16(packet, latency);
+    }
+}
+
 void NET_TiccmdDiff(ticcmd_t *tic1, ticcmd_t *tic2, net_ticdiff_t *diff)
 {
     diff->diff = 0;
@@ -442,18 +716,178 @@ void NET_TiccmdPatch(ticcmd_t *src, net_ticdiff_t *diff, ticcmd_t *dest)
 // net_full_ticcmd_t
 // 
 
-boolean NET_ReadFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd, boolean lowres_turn)
+// [Crispy Multiplayer Doom] Variable-length ticcmd bundle: a count
+// followed by (player number, ticcmd diff) pairs.
+
+static boolean ReadFullTiccmdPlayers(net_packet_t *packet,
+                                     net_full_ticcmd_t *cmd,
+                                     boolean lowres_turn,
+                                     net_protocol_t protocol)
+{
+    unsigned int num_cmds;
+    unsigned int player;
+    unsigned int i;
+
+    if (!NET_ReadInt8(packet, &num_cmds))
+    {
+        return false;
+    }
+
+    for (i=0; i<NET_MAXPLAYERS; ++i)
+    {
+        cmd->playeringame[i] = false;
+    }
+
+    for (i=0; i<num_cmds; ++i)
+    {
+        if (!NET_ReadInt8(packet, &player)
+         || player >= NET_MAXPLAYERS
+         || cmd->playeringame[player]
+         || !NET_ReadTiccmdDiff(packet, &cmd->cmds[player], lowres_turn,
+                                protocol))
+        {
+            return false;
+        }
+
+        cmd->playeringame[player] = true;
+    }
+
+    return true;
+}
+
+// [Crispy Multiplayer Doom] Bit-packed ticcmd bundle: the number of player
+// slots covered, one bit per slot saying whether the player is present,
+// then the diffs of the players that are.
+
+static boolean ReadFullTiccmdBits(net_packet_t *packet,
+                                  net_full_ticcmd_t *cmd,
+                                  boolean lowres_turn,
+                                  net_protocol_t protocol)
+{
+    unsigned int num_slots;
+    unsigned int val;
+    unsigned int i;
+
+    if (!ReadVarUInt(packet, &num_slots) || num_slots > NET_MAXPLAYERS)
+    {
+        return false;
+    }
+
+    for (i=0; i<NET_MAXPLAYERS; ++i)
+    {
+        cmd->playeringame[i] = false;
+    }
+
+    for (i=0; i<num_slots; ++i)
+    {
+        if (!NET_ReadBits(packet, &val, 1))
+        {
+            return false;
+        }
+
+        cmd->playeringame[i] = val != 0;
+    }
+
+    for (i=0; i<num_slots; ++i)
+    {
+        if (cmd->playeringame[i]
+         && !NET_ReadTiccmdDiff(packet, &cmd->cmds[i], lowres_turn, protocol))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void WriteFullTiccmdPlayers(net_packet_t *packet,
+                                   net_full_ticcmd_t *cmd,
+                                   boolean lowres_turn,
+                                   net_protocol_t protocol)
+{
+    unsigned int num_cmds;
+    int i;
+
+    num_cmds = 0;
+
+    for (i=0; i<NET_MAXPLAYERS; ++i)
+    {
+        if (cmd->playeringame[i])
+        {
+            ++num_cmds;
+        }
+    }
+
+    NET_WriteInt8(packet, num_cmds);
+
+    for (i=0; i<NET_MAXPLAYERS; ++i)
+    {
+        if (cmd->playeringame[i])
+        {
+            NET_WriteInt8(packet, i);
+            NET_WriteTiccmdDiff(packet, &cmd->cmds[i], lowres_turn,
+                                protocol);
+        }
+    }
+}
+
+static void WriteFullTiccmdBits(net_packet_t *packet,
+                                net_full_ticcmd_t *cmd,
+                                boolean lowres_turn,
+                                net_protocol_t protocol)
+{
+    unsigned int num_slots;
+    unsigned int i;
+
+    num_slots = 0;
+
+    for (i=0; i<NET_MAXPLAYERS; ++i)
+    {
+        if (cmd->playeringame[i])
+        {
+            num_slots = i + 1;
+        }
+    }
+
+    WriteVarUInt(packet, num_slots);
+
+    for (i=0; i<num_slots; ++i)
+    {
+        NET_WriteBits(packet, cmd->playeringame[i] != 0, 1);
+    }
+
+    for (i=0; i<num_slots; ++i)
+    {
+        if (cmd->playeringame[i])
+        {
+            NET_WriteTiccmdDiff(packet, &cmd->cmds[i], lowres_turn,
+                                protocol);
+        }
+    }
+}
+
+boolean NET_ReadFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd,
+                           boolean lowres_turn, net_protocol_t protocol)
 {
     unsigned int bitfield;
     int i;
 
     // Latency
 
-    if (!NET_ReadSInt16(packet, &cmd->latency))
+    if (!NET_ReadLatency(packet, &cmd->latency, protocol))
     {
         return false;
     }
 
+    if (protocol == NET_PROTOCOL_CRISPY_MULTIPLAYER_DOOM_0)
+    {
+        return ReadFullTiccmdPlayers(packet, cmd, lowres_turn, protocol);
+    }
+    else if (protocol == NET_PROTOCOL_CRISPY_MULTIPLAYER_DOOM_1)
+    {
+        return ReadFullTiccmdBits(packet, cmd, lowres_turn, protocol);
+    }
+
     // Regenerate playeringame from the "header" bitfield
 
     if (!NET_ReadInt8(packet, &bitfield))
@@ -463,7 +897,7 @@ boolean NET_ReadFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd, boolean
           
     for (i=0; i<NET_MAXPLAYERS; ++i)
     {
-        cmd->playeringame[i] = (bitfield & (1 << i)) != 0;
+        cmd->playeringame[i] = i < 8 && (bitfield & (1 << i)) != 0;
     }
         
     // Read cmds
@@ -472,7 +906,8 @@ boolean NET_ReadFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd, boolean
     {
         if (cmd->playeringame[i])
         {
-            if (!NET_ReadTiccmdDiff(packet, &cmd->cmds[i], lowres_turn))
+            if (!NET_ReadTiccmdDiff(packet, &cmd->cmds[i], lowres_turn,
+                                    protocol))
             {
                 return false;
             }
@@ -482,21 +917,33 @@ boolean NET_ReadFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd, boolean
     return true;
 }
 
-void NET_WriteFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd, boolean lowres_turn)
+void NET_WriteFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd,
+                         boolean lowres_turn, net_protocol_t protocol)
 {
     unsigned int bitfield;
     int i;
 
     // Write the latency
 
-    NET_WriteInt16(packet, cmd->latency);
+    NET_WriteLatency(packet, cmd->latency, protocol);
+
+    if (protocol == NET_PROTOCOL_CRISPY_MULTIPLAYER_DOOM_0)
+    {
+        WriteFullTiccmdPlayers(packet, cmd, lowres_turn, protocol);
+        return;
+    }
+    else if (protocol == NET_PROTOCOL_CRISPY_MULTIPLAYER_DOOM_1)
+    {
+        WriteFullTiccmdBits(packet, cmd, lowres_turn, protocol);
+        return;
+    }
 
     // Write "header" byte indicating which players are active
-    // in this ticcmd
+    // in this ticcmd.  Only the first 8 players fit.
 
     bitfield = 0;
     
-    for (i=0; i<NET_MAXPLAYERS; ++i)
+    for (i=0; i<NET_MAXPLAYERS && i<8; ++i)
     {
         if (cmd->playeringame[i])
         {
@@ -508,11 +955,12 @@ void NET_WriteFullTiccmd(net_packet_t *packet, net_full_ticcmd_t *cmd, boolean l
 
     // Write player ticcmds
 
-    for (i=0; i<NET_MAXPLAYERS; ++i)
+    for (i=0; i<NET_MAXPLAYERS && i<8; ++i)
     {
         if (cmd->playeringame[i])
         {
-            NET_WriteTiccmdDiff(packet, &cmd->cmds[i], lowres_turn);
+            NET_WriteTiccmdDiff(packet, &cmd->cmds[i], lowres_turn,
+                                protocol);
         }
     }
 }
@@ -95,12 +95,12 @@ void V_CopyRect(int srcx, int srcy, pixel_t *source,
     pixel_t *src;
     pixel_t *dest;
  
-    srcx <<= crispy->hires;
-    srcy <<= crispy->hires;
-    width <<= crispy->hires;
-    height <<= crispy->hires;
-    destx <<= crispy->hires;
-    desty <<= crispy->hires;
+    srcx *= hires_scale;
+    srcy *= hires_scale;
+    width *= hires_scale;
+    height *= hires_scale;
+    destx *= hires_scale;
+    desty *= hires_scale;
 
 #ifdef RANGECHECK 
     if (srcx < 0
@@ -325,7 +325,7 @@ void V_DrawPatchFullScreen(patch_t *patch, boolean flipped)
     }
 
     dx = (SCREENWIDTH << FRACBITS) / ORIGWIDTH;
-    dxi = (ORIGWIDTH << FRACBITS) / SCREENWIDTH;
+    dxi = ((ORIGWIDTH << FRACBITS) + SCREENWIDTH - 1) / SCREENWIDTH;
     dy = (SCREENHEIGHT << FRACBITS) / ORIGHEIGHT;
     dyi = (ORIGHEIGHT << FRACBITS) / SCREENHEIGHT;
 }
@@ -705,7 +705,7 @@ void V_DrawBlock(int x, int y, int width, int height, pixel_t *src)
  
     V_MarkRect (x, y, width, height); 
  
-    dest = dest_screen + (y << crispy->hires) * SCREENWIDTH + x;
+    dest = dest_screen + (y * hires_scale) * SCREENWIDTH + x;
 
     while (height--) 
     { 
@@ -732,13 +732,13 @@ void V_DrawScaledBlock(int x, int y, int width, int height, byte *src)
 
     V_MarkRect (x, y, width, height);
 
-    dest = dest_screen + (y << crispy->hires) * SCREENWIDTH + (x << crispy->hires);
+    dest = dest_screen + (y * hires_scale) * SCREENWIDTH + (x * hires_scale);
 
-    for (i = 0; i < (height << crispy->hires); i++)
+    for (i = 0; i < (height * hires_scale); i++)
     {
-        for (j = 0; j < (width << crispy->hires); j++)
+        for (j = 0; j < (width * hires_scale); j++)
         {
-            *(dest + i * SCREENWIDTH + j) = *(src + (i >> crispy->hires) * width + (j >> crispy->hires));
+            *(dest + i * SCREENWIDTH + j) = *(src + (i / hires_scale) * width + (j / hires_scale));
         }
     }
 }
@@ -820,11 +820,11 @@ void V_CopyScaledBuffer(byte *dest, byte *src, size_t size)
 
     while (size--)
     {
-        for (i = 0; i <= crispy->hires; i++)
+        for (i = 0; i < hires_scale; i++)
         {
-            for (j = 0; j <= crispy->hires; j++)
+            for (j = 0; j < hires_scale; j++)
             {
-                *(dest + (size << crispy->hires) + (crispy->hires * (int) (size / ORIGWIDTH) + i) * SCREENWIDTH + j) = *(src + size);
+                *(dest + (size * hires_scale) + ((hires_scale - 1) * (int) (size / ORIGWIDTH) + i) * SCREENWIDTH + j) = *(src + size);
             }
         }
     }
@@ -844,7 +844,8 @@ void V_Init (void)
     if (SCREENWIDTH && SCREENHEIGHT)
     {
         dx = (SCREENWIDTH << FRACBITS) / ORIGWIDTH;
-        dxi = (ORIGWIDTH << FRACBITS) / SCREENWIDTH;
+        // [crispy] round up, or odd scales overshoot the patch width by a column
+        dxi = ((ORIGWIDTH << FRACBITS) + SCREENWIDTH - 1) / SCREENWIDTH;
         dy = (SCREENHEIGHT << FRACBITS) / ORIGHEIGHT;
         dyi = (ORIGHEIGHT << FRACBITS) / SCREENHEIGHT;
     }
@@ -17,6 +17,7 @@
 //
 
 #include <stdio.h>
+#include <string.h>
 
 #include "config.h"
 
@@ -26,6 +27,7 @@
 #include "w_file.h"
 
 extern wad_file_class_t stdc_wad_file;
+extern wad_file_class_t zip_wad_file;
 
 #ifdef _WIN32
 extern wad_file_class_t win32_wad_file;
@@ -46,20 +48,60 @@ static wad_file_class_t *wad_file_classes[] =
     &stdc_wad_file,
 };
 
+// [crispy] ZIP/PK3 archives
+
+boolean W_IsArchive(const char *path)
+{
+    size_t len = strlen(path);
+
+    return len > 4 && (!strcasecmp(path + len - 4, ".pk3")
+                    || !strcasecmp(path + len - 4, ".zip"));
+}
+
 wad_file_t *W_OpenFile(const char *path)
+{
+    if (W_IsArchive(path))
+    {
+        return zip_wad_file.OpenFile(path);
+    }
+
+    return W_OpenRawFile(path);
+}
+
+wad_file_t *W_OpenRawFile(const char *path)
 {
     wad_file_t *result;
     int i;
 
+    //!
+    // @category obscure
+    //
+    // Do not map WAD files into memory, read lumps into the zone instead.
+    //
+
+    if (M_CheckParm("-nommap"))
+    {
+        return stdc_wad_file.OpenFile(path);
+    }
+
     //!
     // @category obscure
     //
     // Use the OS's virtual memory subsystem to map WAD files
-    // directly into memory.
+    // directly into memory.  This is the default on POSIX systems.
     //
 
     if (!M_CheckParm("-mmap"))
     {
+#ifdef HAVE_MMAP
+        // [crispy] serve lumps straight from the mapping
+        result = posix_wad_file.OpenFile(path);
+
+        if (result != NULL)
+        {
+            return result;
+        }
+#endif
         return stdc_wad_file.OpenFile(path);
     }
 
@@ -91,3 +133,26 @@ size_t W_Read(wad_file_t *wad, unsigned int offset,
     return wad->file_class->Read(wad, offset, buffer, buffer_len);
 }
 
+byte *W_MapLump(wad_file_t *wad, unsigned int offset, size_t len)
+{
+    if (wad->mapped != NULL)
+    {
+        return wad->mapped + offset;
+    }
+    else if (wad->file_class->MapLump != NULL)
+    {
+        return wad->file_class->MapLump(wad, offset, len);
+    }
+
+    return NULL;
+}
+
+void W_Advise(wad_file_t *wad, unsigned int offset,
+              size_t len, wad_advice_t advice)
+{
+    if (wad->file_class->Advise != NULL)
+    {
+        wad->file_class->Advise(wad, offset, len, advice);
+    }
+}
+
@@ -25,6 +25,14 @@
 
 typedef struct _wad_file_s wad_file_t;
 
+// Hints about how a range of a mapped file is going to be accessed.
+
+typedef enum
+{
+    WAD_ADVICE_SEQUENTIAL,      // Read once, from start to end.
+    WAD_ADVICE_WILLNEED,        // Read soon, so start reading it in now.
+} wad_advice_t;
+
 typedef struct
 {
     // Open a file for reading.
@@ -37,6 +45,16 @@ typedef struct
     // provided buffer.  Returns the number of bytes read.
     size_t (*Read)(wad_file_t *file, unsigned int offset,
                    void *buffer, size_t buffer_len);
+
+    // Give a hint about how the specified range of the mapped file
+    // will be accessed.  May be NULL.
+    void (*Advise)(wad_file_t *file, unsigned int offset,
+                   size_t len, wad_advice_t advice);
+
+    // Get a pointer to the specified range of the file in memory, if
+    // it can be accessed in place even though the file as a whole is
+    // not mapped.  Returns NULL otherwise.  May be NULL.
+    byte *(*MapLump)(wad_file_t *file, unsigned int offset, size_t len);
 } wad_file_class_t;
 
 struct _wad_file_s
@@ -65,6 +83,15 @@ struct _wad_file_s
 
 wad_file_t *W_OpenFile(const char *path);
 
+// Open the specified file as it is, without looking inside archives.
+
+wad_file_t *W_OpenRawFile(const char *path);
+
+// Returns true if the specified file is a ZIP/PK3 archive, going by
+// its extension.
+
+boolean W_IsArchive(const char *path);
+
 // Close the specified WAD file.
 
 void W_CloseFile(wad_file_t *wad);
@@ -76,4 +103,15 @@ void W_CloseFile(wad_file_t *wad);
 size_t W_Read(wad_file_t *wad, unsigned int offset,
               void *buffer, size_t buffer_len);
 
+// Get a pointer to the specified range of the file in memory, or NULL
+// if it must be read with W_Read.
+
+byte *W_MapLump(wad_file_t *wad, unsigned int offset, size_t len);
+
+// Give a hint about how the specified range of the file will be
+// accessed.  Does nothing if the file is not in memory.
+
+void W_Advise(wad_file_t *wad, unsigned int offset,
+              size_t len, wad_advice_t advice);
+
 #endif /* #ifndef __W_FILE__ */
@@ -56,17 +56,26 @@ static void MapFile(posix_wad_file_t *wad, const char *filename)
 
     flags = MAP_PRIVATE;
 
+    // [crispy] an empty file cannot be mapped, but has no lumps either
+
+    if (wad->wad.length == 0)
+    {
+        wad->wad.mapped = NULL;
+        return;
+    }
+
     result = mmap(NULL, wad->wad.length,
                   protection, flags, 
                   wad->handle, 0);
 
-    wad->wad.mapped = result;
-
-    if (result == NULL)
+    if (result == MAP_FAILED)
     {
         fprintf(stderr, "W_POSIX_OpenFile: Unable to mmap() %s - %s\n",
                         filename, strerror(errno));
+        result = NULL;
     }
+
+    wad->wad.mapped = result;
 }
 
 unsigned int GetFileLength(int handle)
@@ -109,6 +118,11 @@ static void W_POSIX_CloseFile(wad_file_t *wad)
 
     // If mapped, unmap it.
 
+    if (posix_wad->wad.mapped != NULL)
+    {
+        munmap(posix_wad->wad.mapped, posix_wad->wad.length);
+    }
+
     // Close the file
   
     close(posix_wad->handle);
@@ -157,12 +171,46 @@ size_t W_POSIX_Read(wad_file_t *wad, unsigned int offset,
     return bytes_read;
 }
 
+// [crispy] Pass a hint about how a range of the file will be accessed
+// on to the virtual memory subsystem.
+
+static void W_POSIX_Advise(wad_file_t *wad, unsigned int offset,
+                           size_t len, wad_advice_t advice)
+{
+#ifdef HAVE_MADVISE
+    static uintptr_t pagemask;
+    uintptr_t start, end;
+    int flags;
+
+    if (wad->mapped == NULL)
+    {
+        return;
+    }
+
+    if (pagemask == 0)
+    {
+        pagemask = (uintptr_t) sysconf(_SC_PAGESIZE) - 1;
+    }
+
+    // madvise() wants a page-aligned start address.
+
+    start = (uintptr_t) (wad->mapped + offset) & ~pagemask;
+    end = (uintptr_t) (wad->mapped + offset + len);
+
+    flags = advice == WAD_ADVICE_SEQUENTIAL ? MADV_SEQUENTIAL : MADV_WILLNEED;
+
+    madvise((void *) start, end - start, flags);
+#endif
+}
+
 
 wad_file_class_t posix_wad_file = 
 {
     W_POSIX_OpenFile,
     W_POSIX_CloseFile,
     W_POSIX_Read,
+    W_POSIX_Advise,
+    NULL,
 };
 
 
@@ -92,6 +92,8 @@ wad_file_class_t stdc_wad_file =
     W_StdC_OpenFile,
     W_StdC_CloseFile,
     W_StdC_Read,
+    NULL,
+    NULL,
 };
 
 
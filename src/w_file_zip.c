@@ -0,0 +1,1084 @@
+//
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	WAD I/O functions for ZIP/PK3 archives.
+//
+//	An archive is presented as a virtual PWAD: a WAD header and
+//	directory, built from the archive's central directory, followed
+//	by the contents of its entries.  W_AddFile reads it like any
+//	other WAD file.  Stored entries are served straight from the
+//	underlying file, deflated entries are inflated on demand into
+//	a cache of limited size, from which the least recently used
+//	entries are dropped.
+//
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
+#include "i_swap.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_misc.h"
+#include "w_file.h"
+#include "z_zone.h"
+
+#define ZIP_LOCAL_SIG           0x04034b50
+#define ZIP_CENTRAL_SIG         0x02014b50
+#define ZIP_END_SIG             0x06054b50
+
+#define ZIP_LOCAL_SIZE          30
+#define ZIP_CENTRAL_SIZE        46
+#define ZIP_END_SIZE            22
+
+#define ZIP_METHOD_STORE        0
+#define ZIP_METHOD_DEFLATE      8
+
+// Inflated entries are kept up to this many megabytes by default.
+
+#define DEFAULT_CACHE_SIZE      16
+
+typedef PACKED_STRUCT (
+{
+    char                identification[4];
+    int                 numlumps;
+    int                 infotableofs;
+}) zip_wadinfo_t;
+
+typedef PACKED_STRUCT (
+{
+    int                 filepos;
+    int                 size;
+    char                name[8];
+}) zip_filelump_t;
+
+typedef struct zip_entry_s zip_entry_t;
+
+struct zip_entry_s
+{
+    // Offset of the contents in the virtual WAD.
+    unsigned int base;
+
+    // Uncompressed and compressed sizes.
+    unsigned int size;
+    unsigned int csize;
+
+    // Offset of the local file header in the archive, and of the
+    // data that follows it once known (or -1).
+    unsigned int local_offset;
+    int data_offset;
+
+    int method;
+
+    // Inflated contents, if cached.
+    byte *cache;
+    zip_entry_t *lru_prev, *lru_next;
+};
+
+typedef struct
+{
+    wad_file_t wad;
+
+    // The archive file itself.
+    wad_file_t *file;
+
+    // WAD header and directory, at the start of the virtual WAD.
+    byte *directory;
+    unsigned int directory_len;
+
+    // Entries, sorted by base.
+    zip_entry_t *entries;
+    int numentries;
+} zip_wad_file_t;
+
+extern wad_file_class_t zip_wad_file;
+
+// Inflated entries of all archives, most recently used first.
+
+static zip_entry_t cache_head = {0, 0, 0, 0, 0, 0, NULL,
+                                 &cache_head, &cache_head};
+static size_t cache_size, cache_limit;
+
+// A lump being added to the virtual directory.
+
+typedef struct
+{
+    char name[8];
+    int entry;
+    unsigned int offset;
+    unsigned int size;
+} zip_lump_t;
+
+typedef struct
+{
+    zip_lump_t *lumps;
+    int numlumps, maxlumps;
+} zip_lumplist_t;
+
+static unsigned int ReadShort(const byte *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned int ReadLong(const byte *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+static void AddLump(zip_lumplist_t *list, const char *name, int entry,
+                    unsigned int offset, unsigned int size)
+{
+    zip_lump_t *lump;
+
+    if (list->numlumps == list->maxlumps)
+    {
+        list->maxlumps = list->maxlumps ? 2 * list->maxlumps : 64;
+        list->lumps = I_Realloc(list->lumps,
+                                list->maxlumps * sizeof(*list->lumps));
+    }
+
+    lump = &list->lumps[list->numlumps++];
+    strncpy(lump->name, name, 8);
+    lump->entry = entry;
+    lump->offset = offset;
+    lump->size = size;
+}
+
+//
+// Inflate cache
+//
+
+static void CacheUnlink(zip_entry_t *entry)
+{
+    entry->lru_prev->lru_next = entry->lru_next;
+    entry->lru_next->lru_prev = entry->lru_prev;
+}
+
+static void CacheLinkFront(zip_entry_t *entry)
+{
+    entry->lru_next = cache_head.lru_next;
+    entry->lru_prev = &cache_head;
+    cache_head.lru_next->lru_prev = entry;
+    cache_head.lru_next = entry;
+}
+
+static void CacheDrop(zip_entry_t *entry)
+{
+    CacheUnlink(entry);
+    cache_size -= entry->size;
+    free(entry->cache);
+    entry->cache = NULL;
+}
+
+static void InitCache(void)
+{
+    int p;
+
+    if (cache_limit != 0)
+    {
+        return;
+    }
+
+    cache_limit = DEFAULT_CACHE_SIZE;
+
+    //!
+    // @arg <mb>
+    // @category obscure
+    //
+    // [crispy] Keep up to <mb> megabytes of lumps inflated from
+    // ZIP/PK3 archives in memory (default 16).
+    //
+
+    p = M_CheckParmWithArgs("-zipcache", 1);
+
+    if (p > 0)
+    {
+        cache_limit = atoi(myargv[p + 1]);
+    }
+
+    cache_limit *= 1024 * 1024;
+}
+
+//
+// Reading entries
+//
+
+// Find the data following the local file header of an entry.
+
+static boolean FindEntryData(zip_wad_file_t *zip, zip_entry_t *entry)
+{
+    byte header[ZIP_LOCAL_SIZE];
+
+    if (entry->data_offset >= 0)
+    {
+        return true;
+    }
+
+    if (W_Read(zip->file, entry->local_offset, header, sizeof(header))
+            != sizeof(header)
+     || ReadLong(header) != ZIP_LOCAL_SIG)
+    {
+        fprintf(stderr, "W_Zip: bad local header in %s\n", zip->wad.path);
+        return false;
+    }
+
+    entry->data_offset = entry->local_offset + ZIP_LOCAL_SIZE
+                       + ReadShort(header + 26) + ReadShort(header + 28);
+
+    if ((unsigned int) entry->data_offset + entry->csize > zip->file->length)
+    {
+        fprintf(stderr, "W_Zip: truncated entry in %s\n", zip->wad.path);
+        entry->data_offset = -1;
+        return false;
+    }
+
+    return true;
+}
+
+#ifdef HAVE_LIBZ
+
+static boolean InflateEntry(zip_wad_file_t *zip, zip_entry_t *entry,
+                            byte *dest)
+{
+    z_stream zstream;
+    byte *source;
+    boolean copied;
+    int err;
+
+    copied = zip->file->mapped == NULL;
+
+    if (!copied)
+    {
+        source = zip->file->mapped + entry->data_offset;
+    }
+    else
+    {
+        source = malloc(entry->csize);
+
+        if (source == NULL
+         || W_Read(zip->file, entry->data_offset, source, entry->csize)
+                != entry->csize)
+        {
+            free(source);
+            return false;
+        }
+    }
+
+    memset(&zstream, 0, sizeof(zstream));
+    zstream.next_in = source;
+    zstream.avail_in = entry->csize;
+    zstream.next_out = dest;
+    zstream.avail_out = entry->size;
+
+    // Raw deflate data, without a zlib header.
+
+    err = inflateInit2(&zstream, -MAX_WBITS);
+
+    if (err == Z_OK)
+    {
+        err = inflate(&zstream, Z_FINISH);
+        inflateEnd(&zstream);
+    }
+
+    if (copied)
+    {
+        free(source);
+    }
+
+    if (err != Z_STREAM_END || zstream.total_out != entry->size)
+    {
+        fprintf(stderr, "W_Zip: failed to inflate an entry of %s\n",
+                        zip->wad.path);
+        return false;
+    }
+
+    return true;
+}
+
+#else
+
+static boolean InflateEntry(zip_wad_file_t *zip, zip_entry_t *entry,
+                            byte *dest)
+{
+    return false;
+}
+
+#endif
+
+// Get the inflated contents of an entry, through the cache.
+
+static byte *CacheEntry(zip_wad_file_t *zip, zip_entry_t *entry)
+{
+    if (entry->cache != NULL)
+    {
+        CacheUnlink(entry);
+        CacheLinkFront(entry);
+        return entry->cache;
+    }
+
+    // Make room, dropping the least recently used entries.
+
+    while (cache_size + entry->size > cache_limit
+        && cache_head.lru_prev != &cache_head)
+    {
+        CacheDrop(cache_head.lru_prev);
+    }
+
+    entry->cache = malloc(entry->size > 0 ? entry->size : 1);
+
+    if (entry->cache == NULL)
+    {
+        I_Error("W_Zip: failed to allocate %u bytes", entry->size);
+    }
+
+    if (!InflateEntry(zip, entry, entry->cache))
+    {
+        free(entry->cache);
+        entry->cache = NULL;
+        return NULL;
+    }
+
+    CacheLinkFront(entry);
+    cache_size += entry->size;
+
+    return entry->cache;
+}
+
+// Read part of the contents of an entry.  Returns the number of bytes
+// read.
+
+static size_t ReadEntry(zip_wad_file_t *zip, zip_entry_t *entry,
+                        unsigned int offset, byte *buffer, size_t len)
+{
+    byte *data;
+
+    if (!FindEntryData(zip, entry))
+    {
+        return 0;
+    }
+
+    if (entry->method == ZIP_METHOD_STORE)
+    {
+        return W_Read(zip->file, entry->data_offset + offset, buffer, len);
+    }
+
+    // Reading all of an entry that is too big for the cache: inflate it
+    // straight into the buffer.
+
+    if (entry->cache == NULL && offset == 0 && len == entry->size
+     && entry->size > cache_limit)
+    {
+        return InflateEntry(zip, entry, buffer) ? len : 0;
+    }
+
+    data = CacheEntry(zip, entry);
+
+    if (data == NULL)
+    {
+        return 0;
+    }
+
+    memcpy(buffer, data + offset, len);
+
+    return len;
+}
+
+// Find the entry containing the given offset into the virtual WAD.
+
+static zip_entry_t *FindEntry(zip_wad_file_t *zip, unsigned int offset)
+{
+    int lo, hi, mid;
+
+    lo = 0;
+    hi = zip->numentries - 1;
+
+    while (lo <= hi)
+    {
+        mid = (lo + hi) / 2;
+
+        if (offset < zip->entries[mid].base)
+        {
+            hi = mid - 1;
+        }
+        else if (offset - zip->entries[mid].base >= zip->entries[mid].size)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            return &zip->entries[mid];
+        }
+    }
+
+    return NULL;
+}
+
+//
+// Building the directory
+//
+
+// Read the central directory of the archive into a buffer.  Returns
+// NULL if the file is not a ZIP archive.
+
+static byte *ReadCentralDirectory(wad_file_t *file, int *numentries,
+                                  unsigned int *length)
+{
+    byte *buf, *end, *p;
+    unsigned int buflen, offset;
+
+    // The end of central directory record is at the end of the file,
+    // followed by a comment of up to 64 KB.
+
+    buflen = ZIP_END_SIZE + 0xffff;
+
+    if (buflen > file->length)
+    {
+        buflen = file->length;
+    }
+
+    if (buflen < ZIP_END_SIZE)
+    {
+        return NULL;
+    }
+
+    buf = malloc(buflen);
+
+    if (buf == NULL
+     || W_Read(file, file->length - buflen, buf, buflen) != buflen)
+    {
+        free(buf);
+        return NULL;
+    }
+
+    end = NULL;
+
+    for (p = buf + buflen - ZIP_END_SIZE; p >= buf; --p)
+    {
+        if (ReadLong(p) == ZIP_END_SIG)
+        {
+            end = p;
+            break;
+        }
+    }
+
+    if (end == NULL)
+    {
+        free(buf);
+        return NULL;
+    }
+
+    *numentries = ReadShort(end + 10);
+    *length = ReadLong(end + 12);
+    offset = ReadLong(end + 16);
+    free(buf);
+
+    if (offset > file->length || *length > file->length - offset)
+    {
+        return NULL;
+    }
+
+    buf = malloc(*length > 0 ? *length : 1);
+
+    if (buf == NULL || W_Read(file, offset, buf, *length) != *length)
+    {
+        free(buf);
+        return NULL;
+    }
+
+    return buf;
+}
+
+// Get the lump name for a file name, or return false if the name is
+// not a valid lump name.
+
+static boolean LumpName(const char *filename, int len, char *name)
+{
+    int i;
+
+    memset(name, 0, 8);
+
+    for (i = 0; i < len && filename[i] != '.'; ++i)
+    {
+        if (i == 8)
+        {
+            return false;
+        }
+
+        name[i] = toupper(filename[i]);
+    }
+
+    return i > 0;
+}
+
+// Add the lumps of a WAD file stored in the archive, such as a map in
+// maps/.
+
+static void AddEmbeddedWAD(zip_wad_file_t *zip, zip_lumplist_t *list,
+                           int entry_num)
+{
+    zip_entry_t *entry = &zip->entries[entry_num];
+    zip_wadinfo_t header;
+    zip_filelump_t *fileinfo;
+    unsigned int numlumps, infotableofs, filepos, size;
+    unsigned int i;
+
+    if (entry->size < sizeof(header)
+     || ReadEntry(zip, entry, 0, (byte *) &header, sizeof(header))
+            != sizeof(header)
+     || (strncmp(header.identification, "PWAD", 4)
+      && strncmp(header.identification, "IWAD", 4)))
+    {
+        return;
+    }
+
+    numlumps = LONG(header.numlumps);
+    infotableofs = LONG(header.infotableofs);
+
+    if (infotableofs > entry->size
+     || numlumps > (entry->size - infotableofs) / sizeof(*fileinfo))
+    {
+        return;
+    }
+
+    fileinfo = malloc(numlumps * sizeof(*fileinfo) + 1);
+
+    if (ReadEntry(zip, entry, infotableofs, (byte *) fileinfo,
+                  numlumps * sizeof(*fileinfo))
+            == numlumps * sizeof(*fileinfo))
+    {
+        for (i = 0; i < numlumps; ++i)
+        {
+            filepos = LONG(fileinfo[i].filepos);
+            size = LONG(fileinfo[i].size);
+
+            if (filepos > entry->size || size > entry->size - filepos)
+            {
+                size = filepos = 0;
+            }
+
+            AddLump(list, fileinfo[i].name, entry_num, filepos, size);
+        }
+    }
+
+    free(fileinfo);
+}
+
+// Build the WAD header and directory for the virtual WAD, once the
+// entries have been placed after it.
+
+static void BuildDirectory(zip_wad_file_t *zip, zip_lumplist_t *list)
+{
+    zip_wadinfo_t *header;
+    zip_filelump_t *filelump;
+    zip_lump_t *lump;
+    int i;
+
+    zip->directory = Z_Malloc(zip->directory_len, PU_STATIC, 0);
+
+    header = (zip_wadinfo_t *) zip->directory;
+    memcpy(header->identification, "PWAD", 4);
+    header->numlumps = LONG(list->numlumps);
+    header->infotableofs = LONG(sizeof(*header));
+
+    filelump = (zip_filelump_t *) (header + 1);
+
+    for (i = 0; i < list->numlumps; ++i)
+    {
+        lump = &list->lumps[i];
+
+        if (lump->entry >= 0)
+        {
+            filelump->filepos = LONG(zip->entries[lump->entry].base
+                                   + lump->offset);
+        }
+        else
+        {
+            filelump->filepos = 0;
+        }
+
+        filelump->size = LONG(lump->size);
+        memcpy(filelump->name, lump->name, 8);
+        ++filelump;
+    }
+}
+
+// The directories in an archive that lumps are taken from.  Flats and
+// sprites are placed between markers, as in a PWAD.
+
+enum
+{
+    NS_GLOBAL,
+    NS_FLATS,
+    NS_SPRITES,
+    NS_MAPS,
+    NUM_NAMESPACES
+};
+
+static const struct
+{
+    const char *dir;
+    int ns;
+} namespaces[] =
+{
+    { "",          NS_GLOBAL  },
+    { "patches",   NS_GLOBAL  },
+    { "graphics",  NS_GLOBAL  },
+    { "sounds",    NS_GLOBAL  },
+    { "music",     NS_GLOBAL  },
+    { "colormaps", NS_GLOBAL  },
+    { "flats",     NS_FLATS   },
+    { "sprites",   NS_SPRITES },
+    { "maps",      NS_MAPS    },
+};
+
+static int EntryNamespace(const char *filename, int len, int *baselen)
+{
+    const char *slash;
+    int dirlen;
+    int i;
+
+    slash = memchr(filename, '/', len);
+
+    if (slash == NULL)
+    {
+        *baselen = len;
+        return NS_GLOBAL;
+    }
+
+    dirlen = slash - filename;
+    *baselen = len - dirlen - 1;
+
+    // Only one level of directories.
+
+    if (memchr(slash + 1, '/', *baselen) != NULL)
+    {
+        return -1;
+    }
+
+    for (i = 1; i < arrlen(namespaces); ++i)
+    {
+        if (strlen(namespaces[i].dir) == dirlen
+         && !strncasecmp(filename, namespaces[i].dir, dirlen))
+        {
+            return namespaces[i].ns;
+        }
+    }
+
+    return -1;
+}
+
+static boolean ParseCentralDirectory(zip_wad_file_t *zip, byte *cdir,
+                                     unsigned int cdir_len, int numentries,
+                                     zip_lumplist_t *lists)
+{
+    zip_entry_t *entry;
+    byte *p, *end;
+    const char *filename;
+    char name[8];
+    unsigned int base;
+    int namelen, extralen, commentlen, baselen;
+    int flags, ns;
+    int skipped;
+    int i;
+
+    zip->entries = calloc(numentries + 1, sizeof(*zip->entries));
+    zip->numentries = 0;
+    skipped = 0;
+    p = cdir;
+    end = cdir + cdir_len;
+
+    // The contents follow the directory, which is not known yet, so
+    // the entries are placed from zero and moved later.
+
+    base = 0;
+
+    for (i = 0; i < numentries; ++i)
+    {
+        if ((size_t) (end - p) < ZIP_CENTRAL_SIZE
+         || ReadLong(p) != ZIP_CENTRAL_SIG)
+        {
+            fprintf(stderr, "W_Zip: bad central directory in %s\n",
+                            zip->wad.path);
+            return false;
+        }
+
+        namelen = ReadShort(p + 28);
+        extralen = ReadShort(p + 30);
+        commentlen = ReadShort(p + 32);
+
+        if ((size_t) (end - p)
+                < ZIP_CENTRAL_SIZE + namelen + extralen + commentlen)
+        {
+            fprintf(stderr, "W_Zip: bad central directory in %s\n",
+                            zip->wad.path);
+            return false;
+        }
+
+        entry = &zip->entries[zip->numentries];
+        flags = ReadShort(p + 8);
+        entry->method = ReadShort(p + 10);
+        entry->csize = ReadLong(p + 20);
+        entry->size = ReadLong(p + 24);
+        entry->local_offset = ReadLong(p + 42);
+        entry->data_offset = -1;
+        filename = (const char *) p + ZIP_CENTRAL_SIZE;
+
+        p += ZIP_CENTRAL_SIZE + namelen + extralen + commentlen;
+
+        // Directories
+
+        if (namelen == 0 || filename[namelen - 1] == '/')
+        {
+            continue;
+        }
+
+        ns = EntryNamespace(filename, namelen, &baselen);
+
+        if (ns < 0)
+        {
+            continue;
+        }
+
+        // Entries that cannot be read: encrypted, ZIP64 or compressed
+        // with an unsupported method.
+
+        if ((flags & 1) != 0
+         || entry->size == 0xffffffff || entry->csize == 0xffffffff
+         || (entry->method != ZIP_METHOD_STORE
+#ifdef HAVE_LIBZ
+          && entry->method != ZIP_METHOD_DEFLATE
+#endif
+            )
+         || (entry->method == ZIP_METHOD_STORE
+          && entry->size != entry->csize))
+        {
+            ++skipped;
+            continue;
+        }
+
+        if (!LumpName(filename + namelen - baselen, baselen, name))
+        {
+            ++skipped;
+            continue;
+        }
+
+        if (entry->size > 0x7fffffff - base)
+        {
+            fprintf(stderr, "W_Zip: %s is too big\n", zip->wad.path);
+            return false;
+        }
+
+        entry->base = base;
+        base += entry->size;
+
+        if (ns == NS_MAPS)
+        {
+            AddEmbeddedWAD(zip, &lists[ns], zip->numentries);
+        }
+        else
+        {
+            AddLump(&lists[ns], name, zip->numentries, 0, entry->size);
+        }
+
+        ++zip->numentries;
+    }
+
+    if (skipped > 0)
+    {
+        printf(" skipped %d unusable entries in %s\n",
+               skipped, zip->wad.basename ? zip->wad.basename : zip->wad.path);
+    }
+
+    return true;
+}
+
+static void FreeZipFile(zip_wad_file_t *zip)
+{
+    int i;
+
+    for (i = 0; i < zip->numentries; ++i)
+    {
+        if (zip->entries[i].cache != NULL)
+        {
+            CacheDrop(&zip->entries[i]);
+        }
+    }
+
+    free(zip->entries);
+
+    if (zip->directory != NULL)
+    {
+        Z_Free(zip->directory);
+    }
+
+    W_CloseFile(zip->file);
+    free(zip->wad.path);
+    Z_Free(zip);
+}
+
+static wad_file_t *W_Zip_OpenFile(const char *path)
+{
+    zip_wad_file_t *result;
+    zip_lumplist_t lists[NUM_NAMESPACES], all;
+    wad_file_t *file;
+    byte *cdir;
+    unsigned int cdir_len;
+    int numentries;
+    int i;
+
+    file = W_OpenRawFile(path);
+
+    if (file == NULL)
+    {
+        return NULL;
+    }
+
+    cdir = ReadCentralDirectory(file, &numentries, &cdir_len);
+
+    if (cdir == NULL)
+    {
+        fprintf(stderr, "W_Zip_OpenFile: %s is not a ZIP archive\n", path);
+        W_CloseFile(file);
+        return NULL;
+    }
+
+    InitCache();
+
+    result = Z_Malloc(sizeof(zip_wad_file_t), PU_STATIC, 0);
+    memset(result, 0, sizeof(*result));
+    result->wad.file_class = &zip_wad_file;
+    result->wad.mapped = NULL;
+    result->wad.path = M_StringDuplicate(path);
+    result->file = file;
+
+    memset(lists, 0, sizeof(lists));
+    memset(&all, 0, sizeof(all));
+
+    if (!ParseCentralDirectory(result, cdir, cdir_len, numentries, lists))
+    {
+        free(cdir);
+        FreeZipFile(result);
+        return NULL;
+    }
+
+    free(cdir);
+
+    // Put the lumps in order: global lumps, maps, then flats and sprites
+    // between markers.
+
+    all = lists[NS_GLOBAL];
+
+    for (i = 0; i < lists[NS_MAPS].numlumps; ++i)
+    {
+        zip_lump_t *lump = &lists[NS_MAPS].lumps[i];
+        AddLump(&all, lump->name, lump->entry, lump->offset, lump->size);
+    }
+
+    if (lists[NS_FLATS].numlumps > 0)
+    {
+        AddLump(&all, "FF_START", -1, 0, 0);
+
+        for (i = 0; i < lists[NS_FLATS].numlumps; ++i)
+        {
+            zip_lump_t *lump = &lists[NS_FLATS].lumps[i];
+            AddLump(&all, lump->name, lump->entry, lump->offset, lump->size);
+        }
+
+        AddLump(&all, "FF_END", -1, 0, 0);
+    }
+
+    if (lists[NS_SPRITES].numlumps > 0)
+    {
+        AddLump(&all, "SS_START", -1, 0, 0);
+
+        for (i = 0; i < lists[NS_SPRITES].numlumps; ++i)
+        {
+            zip_lump_t *lump = &lists[NS_SPRITES].lumps[i];
+            AddLump(&all, lump->name, lump->entry, lump->offset, lump->size);
+        }
+
+        AddLump(&all, "SS_END", -1, 0, 0);
+    }
+
+    // The contents of the entries follow the directory.
+
+    result->directory_len = sizeof(zip_wadinfo_t)
+                          + all.numlumps * sizeof(zip_filelump_t);
+
+    for (i = 0; i < result->numentries; ++i)
+    {
+        result->entries[i].base += result->directory_len;
+    }
+
+    BuildDirectory(result, &all);
+
+    result->wad.length = result->directory_len;
+
+    if (result->numentries > 0)
+    {
+        zip_entry_t *last = &result->entries[result->numentries - 1];
+        result->wad.length = last->base + last->size;
+    }
+
+    free(all.lumps);
+
+    for (i = NS_GLOBAL + 1; i < NUM_NAMESPACES; ++i)
+    {
+        free(lists[i].lumps);
+    }
+
+    return &result->wad;
+}
+
+static void W_Zip_CloseFile(wad_file_t *wad)
+{
+    FreeZipFile((zip_wad_file_t *) wad);
+}
+
+// Read data from the specified position in the virtual WAD into the
+// provided buffer.  Returns the number of bytes read.
+
+static size_t W_Zip_Read(wad_file_t *wad, unsigned int offset,
+                         void *buffer, size_t buffer_len)
+{
+    zip_wad_file_t *zip;
+    zip_entry_t *entry;
+    byte *byte_buffer;
+    size_t bytes_read;
+    size_t len, result;
+
+    zip = (zip_wad_file_t *) wad;
+    byte_buffer = buffer;
+    bytes_read = 0;
+
+    // Header and directory
+
+    if (offset < zip->directory_len)
+    {
+        len = zip->directory_len - offset;
+
+        if (len > buffer_len)
+        {
+            len = buffer_len;
+        }
+
+        memcpy(byte_buffer, zip->directory + offset, len);
+
+        byte_buffer += len;
+        buffer_len -= len;
+        bytes_read += len;
+        offset += len;
+    }
+
+    // Contents of the entries
+
+    while (buffer_len > 0)
+    {
+        entry = FindEntry(zip, offset);
+
+        if (entry == NULL)
+        {
+            break;
+        }
+
+        len = entry->base + entry->size - offset;
+
+        if (len > buffer_len)
+        {
+            len = buffer_len;
+        }
+
+        result = ReadEntry(zip, entry, offset - entry->base,
+                           byte_buffer, len);
+
+        bytes_read += result;
+
+        if (result < len)
+        {
+            break;
+        }
+
+        byte_buffer += len;
+        buffer_len -= len;
+        offset += len;
+    }
+
+    return bytes_read;
+}
+
+static void W_Zip_Advise(wad_file_t *wad, unsigned int offset,
+                         size_t len, wad_advice_t advice)
+{
+    zip_wad_file_t *zip;
+    zip_entry_t *entry;
+
+    zip = (zip_wad_file_t *) wad;
+    entry = FindEntry(zip, offset);
+
+    if (entry != NULL && FindEntryData(zip, entry))
+    {
+        if (entry->method == ZIP_METHOD_STORE)
+        {
+            W_Advise(zip->file, entry->data_offset + offset - entry->base,
+                     len, advice);
+        }
+        else
+        {
+            W_Advise(zip->file, entry->data_offset, entry->csize, advice);
+        }
+    }
+}
+
+// Stored entries of a mapped archive can be used in place.
+
+static byte *W_Zip_MapLump(wad_file_t *wad, unsigned int offset, size_t len)
+{
+    zip_wad_file_t *zip;
+    zip_entry_t *entry;
+
+    zip = (zip_wad_file_t *) wad;
+
+    if (zip->file->mapped == NULL)
+    {
+        return NULL;
+    }
+
+    entry = FindEntry(zip, offset);
+
+    if (entry == NULL || entry->method != ZIP_METHOD_STORE
+     || len > entry->base + entry->size - offset
+     || !FindEntryData(zip, entry))
+    {
+        return NULL;
+    }
+
+    return zip->file->mapped + entry->data_offset + offset - entry->base;
+}
+
+wad_file_class_t zip_wad_file =
+{
+    W_Zip_OpenFile,
+    W_Zip_CloseFile,
+    W_Zip_Read,
+    W_Zip_Advise,
+    W_Zip_MapLump,
+};
+
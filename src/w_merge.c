@@ -27,6 +27,7 @@
 #include "i_swap.h" // [crispy] LONG()
 #include "i_system.h"
 #include "m_misc.h"
+#include "m_trace.h"
 #include "w_merge.h"
 #include "w_wad.h"
 #include "z_zone.h"
@@ -579,6 +580,8 @@ void W_MergeFile(const char *filename)
     if (W_AddFile(filename) == NULL)
         return;
 
+    M_TraceBegin("W_MergeFile", filename);
+
     // IWAD is at the start, PWAD was appended to the end
 
     iwad.lumps = lumpinfo;
@@ -598,6 +601,8 @@ void W_MergeFile(const char *filename)
     // Perform the merge
 
     DoMerge();
+
+    M_TraceEnd();
 }
 
 // Replace lumps in the given list with lumps from the PWAD
@@ -30,6 +30,7 @@
 #include "i_system.h"
 #include "i_video.h"
 #include "m_misc.h"
+#include "m_trace.h"
 #include "v_diskicon.h"
 #include "z_zone.h"
 
@@ -60,7 +61,7 @@ lumpinfo_t **lumpinfo;
 unsigned int numlumps = 0;
 
 // Hash table for fast lookups
-static lumpindex_t *lumphash;
+static nameindex_t lumphash;
 
 // Variables for the reload hack: filename of the PWAD to reload, and the
 // lumps from WADs before the reload file, so we can resent numlumps and
@@ -87,6 +88,106 @@ unsigned int W_LumpNameHash(const char *s)
     return result;
 }
 
+// [crispy] Fold a lump name of up to 8 characters to upper case and pack
+// it into a 64-bit key, so that names can be compared in one go.
+uint64_t W_LumpNameKey(const char *name)
+{
+    uint64_t result = 0;
+    unsigned int i;
+
+    for (i = 0; i < 8 && name[i] != '\0'; ++i)
+    {
+        result |= (uint64_t) (byte) toupper((byte) name[i]) << (i * 8);
+    }
+
+    return result;
+}
+
+static unsigned int NameIndexSlot(const nameindex_t *index, uint64_t key)
+{
+    // Fibonacci hashing: the top bits of the product are well mixed.
+    return (unsigned int) ((key * 0x9e3779b97f4a7c15ull) >> 32) & index->mask;
+}
+
+// [crispy] Allocate an empty name index for up to count names.
+void W_InitNameIndex(nameindex_t *index, int count)
+{
+    unsigned int size, i;
+
+    // Keep the table at most half full.
+    for (size = 16; size < 2 * (unsigned int) count; size <<= 1);
+
+    index->entries = Z_Malloc(size * sizeof(*index->entries), PU_STATIC, NULL);
+    index->mask = size - 1;
+
+    for (i = 0; i < size; ++i)
+    {
+        index->entries[i].value = -1;
+    }
+}
+
+void W_FreeNameIndex(nameindex_t *index)
+{
+    if (index->entries != NULL)
+    {
+        Z_Free(index->entries);
+        index->entries = NULL;
+    }
+}
+
+// [crispy] Add a name to the index.  If the name is already there, the
+// new value replaces the old one only if replace is set.
+void W_AddToNameIndex(nameindex_t *index, const char *name, int value,
+                      boolean replace)
+{
+    nameindex_entry_t *entry;
+    uint64_t key;
+    unsigned int slot;
+
+    key = W_LumpNameKey(name);
+
+    for (slot = NameIndexSlot(index, key); ; slot = (slot + 1) & index->mask)
+    {
+        entry = &index->entries[slot];
+
+        if (entry->value == -1)
+        {
+            entry->key = key;
+            entry->value = value;
+            return;
+        }
+
+        if (entry->key == key)
+        {
+            if (replace)
+            {
+                entry->value = value;
+            }
+            return;
+        }
+    }
+}
+
+// [crispy] Returns -1 if the name is not in the index.
+int W_LookupNameIndex(const nameindex_t *index, const char *name)
+{
+    const nameindex_entry_t *entry;
+    uint64_t key;
+    unsigned int slot;
+
+    key = W_LumpNameKey(name);
+
+    for (slot = NameIndexSlot(index, key); ; slot = (slot + 1) & index->mask)
+    {
+        entry = &index->entries[slot];
+
+        if (entry->value == -1 || entry->key == key)
+        {
+            return entry->value;
+        }
+    }
+}
+
 //
 // LUMP BASED ROUTINES.
 //
@@ -133,12 +234,15 @@ wad_file_t *W_AddFile (const char *filename)
         ++filename;
     }
 
+    M_TraceBegin("W_AddFile", filename);
+
     // Open the file and add to directory
     wad_file = W_OpenFile(filename);
 
     if (wad_file == NULL)
     {
 	printf (" couldn't open %s\n", filename);
+	M_TraceEnd();
 	return NULL;
     }
 
@@ -147,7 +251,9 @@ wad_file_t *W_AddFile (const char *filename)
     // [crispy] indicate this is the IWAD
     wad_file->iwad = (filename == iwadfile);
 
-    if (strcasecmp(filename+strlen(filename)-3 , "wad" ) )
+    // [crispy] archives are read as a WAD file built from their contents
+    if (strcasecmp(filename+strlen(filename)-3 , "wad" ) &&
+        !W_IsArchive(filename))
     {
 	// single lump file
 
@@ -232,11 +338,7 @@ wad_file_t *W_AddFile (const char *filename)
 
     Z_Free(fileinfo);
 
-    if (lumphash != NULL)
-    {
-        Z_Free(lumphash);
-        lumphash = NULL;
-    }
+    W_FreeNameIndex(&lumphash);
 
     // If this is the reload file, we need to save some details about the
     // file so that we can close it later on when we do a reload.
@@ -246,6 +348,8 @@ wad_file_t *W_AddFile (const char *filename)
         reloadlumps = filelumps;
     }
 
+    M_TraceEnd();
+
     return wad_file;
 }
 
@@ -269,24 +373,15 @@ int W_NumLumps (void)
 lumpindex_t W_CheckNumForName(const char *name)
 {
     lumpindex_t i;
+    uint64_t key;
 
     // Do we have a hash table yet?
 
-    if (lumphash != NULL)
+    if (lumphash.entries != NULL)
     {
-        int hash;
-
         // We do! Excellent.
 
-        hash = W_LumpNameHash(name) % numlumps;
-
-        for (i = lumphash[hash]; i != -1; i = lumpinfo[i]->next)
-        {
-            if (!strncasecmp(lumpinfo[i]->name, name, 8))
-            {
-                return i;
-            }
-        }
+        return W_LookupNameIndex(&lumphash, name);
     }
     else
     {
@@ -294,9 +389,11 @@ lumpindex_t W_CheckNumForName(const char *name)
         //
         // scan backwards so patch lump files take precedence
 
+        key = W_LumpNameKey(name);
+
         for (i = numlumps - 1; i >= 0; --i)
         {
-            if (!strncasecmp(lumpinfo[i]->name, name, 8))
+            if (W_LumpNameKey(lumpinfo[i]->name) == key)
             {
                 return i;
             }
@@ -332,10 +429,13 @@ lumpindex_t W_GetNumForName(const char *name)
 lumpindex_t W_CheckNumForNameFromTo(const char *name, int from, int to)
 {
     lumpindex_t i;
+    uint64_t key;
+
+    key = W_LumpNameKey(name);
 
     for (i = from; i >= to; i--)
     {
-        if (!strncasecmp(lumpinfo[i]->name, name, 8))
+        if (W_LumpNameKey(lumpinfo[i]->name) == key)
         {
             return i;
         }
@@ -420,11 +520,11 @@ void *W_CacheLumpNum(lumpindex_t lumpnum, int tag)
     // region.  If the lump is in an ordinary file, we may already
     // have it cached; otherwise, load it into memory.
 
-    if (lump->wad_file->mapped != NULL)
+    result = W_MapLump(lump->wad_file, lump->position, lump->size);
+
+    if (result != NULL)
     {
         // Memory mapped file, return from the mmapped region.
-
-        result = lump->wad_file->mapped + lump->position;
     }
     else if (lump->cache != NULL)
     {
@@ -476,7 +576,7 @@ void W_ReleaseLumpNum(lumpindex_t lumpnum)
 
     lump = lumpinfo[lumpnum];
 
-    if (lump->wad_file->mapped != NULL)
+    if (lump->cache == NULL)
     {
         // Memory-mapped file, so nothing needs to be done here.
     }
@@ -491,6 +591,31 @@ void W_ReleaseLumpName(const char *name)
     W_ReleaseLumpNum(W_GetNumForName(name));
 }
 
+//
+// W_AdviseLumpNum
+//
+// [crispy] Give a hint about how a lump is going to be accessed. If the
+// lump is in a memory-mapped file, this lets the OS start reading it in
+// before it is touched.
+//
+
+void W_AdviseLumpNum(lumpindex_t lumpnum, wad_advice_t advice)
+{
+    lumpinfo_t *lump;
+
+    if ((unsigned)lumpnum >= numlumps)
+    {
+        return;
+    }
+
+    lump = lumpinfo[lumpnum];
+
+    if (lump->size > 0)
+    {
+        W_Advise(lump->wad_file, lump->position, lump->size, advice);
+    }
+}
+
 #if 0
 
 //
@@ -564,31 +689,18 @@ void W_GenerateHashTable(void)
     lumpindex_t i;
 
     // Free the old hash table, if there is one:
-    if (lumphash != NULL)
-    {
-        Z_Free(lumphash);
-    }
+    W_FreeNameIndex(&lumphash);
 
     // Generate hash table
     if (numlumps > 0)
     {
-        lumphash = Z_Malloc(sizeof(lumpindex_t) * numlumps, PU_STATIC, NULL);
+        W_InitNameIndex(&lumphash, numlumps);
 
-        for (i = 0; i < numlumps; ++i)
-        {
-            lumphash[i] = -1;
-        }
+        // Later lumps replace earlier ones of the same name.
 
         for (i = 0; i < numlumps; ++i)
         {
-            unsigned int hash;
-
-            hash = W_LumpNameHash(lumpinfo[i]->name) % numlumps;
-
-            // Hook into the hash table
-
-            lumpinfo[i]->next = lumphash[hash];
-            lumphash[hash] = i;
+            W_AddToNameIndex(&lumphash, lumpinfo[i]->name, i, true);
         }
     }
 
@@ -44,11 +44,23 @@ struct lumpinfo_s
     int		position;
     int		size;
     void       *cache;
-
-    // Used for hash table lookups
-    lumpindex_t next;
 };
 
+// [crispy] An open-addressing index from lump names, folded to upper
+// case and packed into 64-bit keys, to an index.
+
+typedef struct
+{
+    uint64_t	key;
+    int		value;
+} nameindex_entry_t;
+
+typedef struct
+{
+    nameindex_entry_t *entries;
+    unsigned int mask;
+} nameindex_t;
+
 
 extern lumpinfo_t **lumpinfo;
 extern unsigned int numlumps;
@@ -70,7 +82,17 @@ void W_GenerateHashTable(void);
 
 extern unsigned int W_LumpNameHash(const char *s);
 
+uint64_t W_LumpNameKey(const char *name);
+
+void W_InitNameIndex(nameindex_t *index, int count);
+void W_FreeNameIndex(nameindex_t *index);
+void W_AddToNameIndex(nameindex_t *index, const char *name, int value,
+                      boolean replace);
+int W_LookupNameIndex(const nameindex_t *index, const char *name);
+
 void W_ReleaseLumpNum(lumpindex_t lump);
 void W_ReleaseLumpName(const char *name);
 
+void W_AdviseLumpNum(lumpindex_t lump, wad_advice_t advice);
+
 #endif
@@ -45,6 +45,8 @@ struct memblock_s
  
 static memblock_t *allocated_blocks[PU_NUM_TAGS];
 
+static void (*purge_hook)(void);
+
 #ifdef TESTING
 
 static int test_malloced = 0;
@@ -255,6 +257,11 @@ void *Z_Malloc(int size, int tag, void *user)
 
         if (newblock == NULL)
         {
+            if (purge_hook != NULL)
+            {
+                purge_hook();
+            }
+
             if (!ClearCache(sizeof(memblock_t) + size))
             {
                 I_Error("Z_Malloc: failed on allocation of %i bytes", size);
@@ -496,3 +503,8 @@ unsigned int Z_ZoneSize(void)
     return 0;
 }
 
+void Z_SetPurgeHook(void (*hook)(void))
+{
+    purge_hook = hook;
+}
+
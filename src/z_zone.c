@@ -20,6 +20,7 @@
 
 #include "doomtype.h"
 #include "i_system.h"
+#include "i_timer.h"
 #include "m_argv.h"
 
 #include "z_zone.h"
@@ -34,6 +35,13 @@
 //
 // It is of no value to free a cachable block,
 //  because it will get overwritten automatically if needed.
+//
+// [crispy] Free blocks are also kept in segregated free lists, binned
+// by size, so that finding a block does not need to walk the whole
+// heap.  Only when no free block is big enough is the heap walked from
+// the rover, throwing out purgable blocks, as before.  Zones that are
+// added when the heap runs out are chained together rather than
+// abandoned.
 // 
  
 #define MEM_ALIGN sizeof(void *)
@@ -47,10 +55,14 @@ typedef struct memblock_s
     int			id;	// should be ZONEID
     struct memblock_s*	next;
     struct memblock_s*	prev;
+
+    // [crispy] free list links, only valid if tag is PU_FREE
+    struct memblock_s*	next_free;
+    struct memblock_s*	prev_free;
 } memblock_t;
 
 
-typedef struct
+typedef struct memzone_s
 {
     // total bytes malloced, including header
     int		size;
@@ -59,68 +71,197 @@ typedef struct
     memblock_t	blocklist;
     
     memblock_t*	rover;
+
+    // [crispy] next zone in the chain
+    struct memzone_s*	next;
     
 } memzone_t;
 
+// [crispy] Free list bins: each power of two is split into
+// 1 << BIN_SUBDIV_BITS bins, so that a block from the right bin is
+// never more than 25% too big.
 
+#define BIN_SUBDIV_BITS		2
+#define BIN_SUBDIVS		(1 << BIN_SUBDIV_BITS)
+#define NUM_BINS		(32 * BIN_SUBDIVS)
+
+static memblock_t *freebins[NUM_BINS];
+static unsigned int freebinmask[NUM_BINS / 32];
 
 static memzone_t *mainzone;
 static boolean zero_on_free;
 static boolean scan_on_free;
 
+// [crispy] allocation statistics for -zonestats
 
-//
-// Z_ClearZone
-//
-void Z_ClearZone (memzone_t* zone)
+static boolean zone_stats;
+
+static void (*purge_hook)(void);
+
+static struct
 {
-    memblock_t*		block;
-	
-    // set the entire zone to one free block
-    zone->blocklist.next =
-	zone->blocklist.prev =
-	block = (memblock_t *)( (byte *)zone + sizeof(memzone_t) );
-    
-    zone->blocklist.user = (void *)zone;
-    zone->blocklist.tag = PU_STATIC;
-    zone->rover = block;
-	
-    block->prev = block->next = &zone->blocklist;
-    
-    // a free block.
-    block->tag = PU_FREE;
+    unsigned int mallocs;
+    unsigned int frees;
+    unsigned int purges;
+    unsigned int slow_mallocs;
+    unsigned int zones;
+    uint64_t malloc_time;
+    uint64_t max_malloc_time;
+} stats;
 
-    block->size = zone->size - sizeof(memzone_t);
+
+static int SizeBin (int size)
+{
+    unsigned int s = size;
+    int log2 = 0;
+
+    while (s >> (log2 + 1))
+    {
+        log2++;
+    }
+
+    if (log2 < BIN_SUBDIV_BITS)
+    {
+        return log2 * BIN_SUBDIVS;
+    }
+
+    return log2 * BIN_SUBDIVS
+         + ((s >> (log2 - BIN_SUBDIV_BITS)) & (BIN_SUBDIVS - 1));
+}
+
+static void InsertFreeBlock (memblock_t *block)
+{
+    int bin = SizeBin(block->size);
+
+    block->prev_free = NULL;
+    block->next_free = freebins[bin];
+
+    if (block->next_free != NULL)
+    {
+        block->next_free->prev_free = block;
+    }
+
+    freebins[bin] = block;
+    freebinmask[bin / 32] |= 1U << (bin % 32);
+}
+
+static void RemoveFreeBlock (memblock_t *block)
+{
+    int bin;
+
+    if (block->prev_free != NULL)
+    {
+        block->prev_free->next_free = block->next_free;
+    }
+    else
+    {
+        bin = SizeBin(block->size);
+        freebins[bin] = block->next_free;
+
+        if (freebins[bin] == NULL)
+        {
+            freebinmask[bin / 32] &= ~(1U << (bin % 32));
+        }
+    }
+
+    if (block->next_free != NULL)
+    {
+        block->next_free->prev_free = block->prev_free;
+    }
 }
 
+// [crispy] Find a free block of at least size bytes: the first that
+// fits from the bin for its size, or else any block from a higher bin.
 
+static memblock_t *FindFreeBlock (int size)
+{
+    memblock_t *block;
+    unsigned int mask;
+    int bin, i;
+
+    bin = SizeBin(size);
+
+    for (block = freebins[bin]; block != NULL; block = block->next_free)
+    {
+        if (block->size >= size)
+        {
+            return block;
+        }
+    }
+
+    ++bin;
+
+    for (i = bin / 32; i < NUM_BINS / 32; ++i)
+    {
+        mask = freebinmask[i];
+
+        if (i == bin / 32)
+        {
+            mask &= ~0U << (bin % 32);
+        }
+
+        if (mask != 0)
+        {
+            bin = i * 32;
+
+            while (!(mask & 1))
+            {
+                mask >>= 1;
+                ++bin;
+            }
+
+            return freebins[bin];
+        }
+    }
+
+    return NULL;
+}
+
+static void Z_PrintStats (void);
 
 //
 // Z_Init
 //
 void Z_Init (void)
 {
+    memzone_t*	zone;
     memblock_t*	block;
     int		size;
 
-    mainzone = (memzone_t *)I_ZoneBase (&size);
-    mainzone->size = size;
+    zone = (memzone_t *)I_ZoneBase (&size);
+    zone->size = size;
 
     // set the entire zone to one free block
-    mainzone->blocklist.next =
-	mainzone->blocklist.prev =
-	block = (memblock_t *)( (byte *)mainzone + sizeof(memzone_t) );
+    zone->blocklist.next =
+	zone->blocklist.prev =
+	block = (memblock_t *)( (byte *)zone + sizeof(memzone_t) );
 
-    mainzone->blocklist.user = (void *)mainzone;
-    mainzone->blocklist.tag = PU_STATIC;
-    mainzone->rover = block;
+    zone->blocklist.user = (void *)zone;
+    zone->blocklist.tag = PU_STATIC;
+    zone->blocklist.size = 0;
+    zone->rover = block;
 
-    block->prev = block->next = &mainzone->blocklist;
+    block->prev = block->next = &zone->blocklist;
 
     // free block
     block->tag = PU_FREE;
+    block->user = NULL;
+    block->id = 0;
+
+    block->size = zone->size - sizeof(memzone_t);
 
-    block->size = mainzone->size - sizeof(memzone_t);
+    InsertFreeBlock(block);
+
+    // [crispy] chain the new zone in front of the old ones
+    zone->next = mainzone;
+    mainzone = zone;
+
+    ++stats.zones;
+
+    if (stats.zones > 1)
+    {
+        return;
+    }
 
     // [Deliberately undocumented]
     // Zone memory debugging flag. If set, memory is zeroed after it is freed
@@ -133,45 +274,95 @@ void Z_Init (void)
     // heap is scanned to look for remaining pointers to the freed block.
     //
     scan_on_free = M_ParmExists("-zonescan");
+
+    //!
+    // @category obscure
+    //
+    // [crispy] Print zone memory allocation statistics on exit.
+    //
+
+    zone_stats = M_ParmExists("-zonestats");
+
+    if (zone_stats)
+    {
+        I_AtExit(Z_PrintStats, true);
+    }
 }
 
 // Scan the zone heap for pointers within the specified range, and warn about
 // any remaining pointers.
 static void ScanForBlock(void *start, void *end)
 {
+    memzone_t *zone;
     memblock_t *block;
     void **mem;
     int i, len, tag;
 
-    block = mainzone->blocklist.next;
-
-    while (block->next != &mainzone->blocklist)
+    for (zone = mainzone; zone != NULL; zone = zone->next)
     {
-        tag = block->tag;
+        block = zone->blocklist.next;
 
-        if (tag == PU_STATIC || tag == PU_LEVEL || tag == PU_LEVSPEC)
+        while (block->next != &zone->blocklist)
         {
-            // Scan for pointers on the assumption that pointers are aligned
-            // on word boundaries (word size depending on pointer size):
-            mem = (void **) ((byte *) block + sizeof(memblock_t));
-            len = (block->size - sizeof(memblock_t)) / sizeof(void *);
+            tag = block->tag;
 
-            for (i = 0; i < len; ++i)
+            if (tag == PU_STATIC || tag == PU_LEVEL || tag == PU_LEVSPEC)
             {
-                if (start <= mem[i] && mem[i] <= end)
+                // Scan for pointers on the assumption that pointers are aligned
+                // on word boundaries (word size depending on pointer size):
+                mem = (void **) ((byte *) block + sizeof(memblock_t));
+                len = (block->size - sizeof(memblock_t)) / sizeof(void *);
+
+                for (i = 0; i < len; ++i)
                 {
-                    fprintf(stderr,
-                            "%p has dangling pointer into freed block "
-                            "%p (%p -> %p)\n",
-                            mem, start, &mem[i], mem[i]);
+                    if (start <= mem[i] && mem[i] <= end)
+                    {
+                        fprintf(stderr,
+                                "%p has dangling pointer into freed block "
+                                "%p (%p -> %p)\n",
+                                mem, start, &mem[i], mem[i]);
+                    }
                 }
             }
+
+            block = block->next;
         }
+    }
+}
 
-        block = block->next;
+// [crispy] keep the rovers valid when a block is merged into another
+static void MoveRover (memblock_t *from, memblock_t *to)
+{
+    memzone_t *zone;
+
+    for (zone = mainzone; zone != NULL; zone = zone->next)
+    {
+        if (zone->rover == from)
+        {
+            zone->rover = to;
+        }
     }
 }
 
+// [crispy] find the zone that a block is in
+static memzone_t *BlockZone (memblock_t *block)
+{
+    memzone_t *zone;
+
+    for (zone = mainzone; zone != NULL; zone = zone->next)
+    {
+        if ((byte *) block > (byte *) zone
+         && (byte *) block < (byte *) zone + zone->size)
+        {
+            return zone;
+        }
+    }
+
+    I_Error("BlockZone: block %p is not in any zone", (void *) block);
+
+    return NULL;
+}
+
 //
 // Z_Free
 //
@@ -196,6 +387,8 @@ void Z_Free (void* ptr)
     block->user = NULL;
     block->id = 0;
 
+    ++stats.frees;
+
     // If the -zonezero flag is provided, we zero out the block on free
     // to break code that depends on reading freed memory.
     if (zero_on_free)
@@ -213,12 +406,12 @@ void Z_Free (void* ptr)
     if (other->tag == PU_FREE)
     {
         // merge with previous free block
+        RemoveFreeBlock(other);
         other->size += block->size;
         other->next = block->next;
         other->next->prev = other;
 
-        if (block == mainzone->rover)
-            mainzone->rover = other;
+        MoveRover(block, other);
 
         block = other;
     }
@@ -227,13 +420,112 @@ void Z_Free (void* ptr)
     if (other->tag == PU_FREE)
     {
         // merge the next free block onto the end
+        RemoveFreeBlock(other);
         block->size += other->size;
         block->next = other->next;
         block->next->prev = block;
 
-        if (other == mainzone->rover)
-            mainzone->rover = block;
+        MoveRover(other, block);
+    }
+
+    InsertFreeBlock(block);
+}
+
+// [crispy] Throw out the purgable blocks from base to last, leaving a
+// single free block at base.
+
+static memblock_t *PurgeBlocks (memzone_t *zone, memblock_t *base,
+                                memblock_t *last)
+{
+    memblock_t *block;
+    boolean done;
+
+    // If base is purgable and follows a free block, freeing it would
+    // merge it into that block, so start from there instead.
+
+    if (base->prev->tag == PU_FREE)
+    {
+        base = base->prev;
+    }
+
+    // A free block at the end of the run is merged away when the block
+    // before it is thrown out, so stop at that block instead.
+
+    if (last != base && last->tag == PU_FREE)
+    {
+        last = last->prev;
     }
+
+    // Follow the block list rather than comparing addresses: once the
+    // run has been merged into the last block of the zone, its next
+    // block is the zone header.
+
+    block = base;
+
+    do
+    {
+        done = (block == last);
+
+        if (block->tag != PU_FREE)
+        {
+            Z_Free ((byte *) block + sizeof(memblock_t));
+            ++stats.purges;
+
+            // Everything from base up to here is now one free block.
+            block = base;
+        }
+
+        block = block->next;
+    } while (!done && block != &zone->blocklist);
+
+    return base;
+}
+
+// [crispy] Walk the zone from its rover looking for a run of free and
+// purgable blocks that adds up to at least size bytes, and purge it.
+
+static memblock_t *PurgeForBlock (memzone_t *zone, int size)
+{
+    memblock_t *start;
+    memblock_t *block;
+    memblock_t *base;
+    int run;
+
+    start = block = zone->rover;
+    base = NULL;
+    run = 0;
+
+    do
+    {
+        if (block == &zone->blocklist)
+        {
+            // a run can't wrap around from the end of the zone
+            base = NULL;
+        }
+        else if (block->tag == PU_FREE || block->tag >= PU_PURGELEVEL)
+        {
+            if (base == NULL)
+            {
+                base = block;
+                run = 0;
+            }
+
+            run += block->size;
+
+            if (run >= size)
+            {
+                return PurgeBlocks(zone, base, block);
+            }
+        }
+        else
+        {
+            base = NULL;
+        }
+
+        block = block->next;
+    } while (block != start);
+
+    return NULL;
 }
 
 
@@ -252,74 +544,56 @@ Z_Malloc
   void*		user )
 {
     int		extra;
-    memblock_t*	start;
-    memblock_t* rover;
+    memzone_t*	zone;
     memblock_t* newblock;
     memblock_t*	base;
     void *result;
+    uint64_t start_time = 0;
+
+    if (zone_stats)
+    {
+        start_time = I_GetTimeUS();
+    }
+
+    if (user == NULL && tag >= PU_PURGELEVEL)
+        I_Error ("Z_Malloc: an owner is required for purgable blocks");
 
     size = (size + MEM_ALIGN - 1) & ~(MEM_ALIGN - 1);
-    
-    // scan through the block list,
-    // looking for the first free block
-    // of sufficient size,
-    // throwing out any purgable blocks along the way.
 
     // account for size of block header
     size += sizeof(memblock_t);
     
-    // if there is a free block behind the rover,
-    //  back up over them
-    base = mainzone->rover;
-    
-    if (base->prev->tag == PU_FREE)
-        base = base->prev;
-	
-    rover = base;
-    start = base->prev;
-	
-    do
-    {
-        if (rover == start)
-        {
-            // scanned all the way around the list
-//          I_Error ("Z_Malloc: failed on allocation of %i bytes", size);
+    // [crispy] look for a free block of sufficient size, and only
+    // throw out purgable blocks if there is none
+    base = FindFreeBlock(size);
 
-            // [crispy] allocate another zone twice as big
-            Z_Init();
+    if (base == NULL)
+    {
+        ++stats.slow_mallocs;
 
-            base = mainzone->rover;
-            rover = base;
-            start = base->prev;
-        }
-	
-        if (rover->tag != PU_FREE)
+        if (purge_hook != NULL)
         {
-            if (rover->tag < PU_PURGELEVEL)
-            {
-                // hit a block that can't be purged,
-                // so move base past it
-                base = rover = rover->next;
-            }
-            else
-            {
-                // free the rover block (adding the size to base)
-
-                // the rover can be the base block
-                base = base->prev;
-                Z_Free ((byte *)rover+sizeof(memblock_t));
-                base = base->next;
-                rover = base->next;
-            }
+            purge_hook();
         }
-        else
+
+        for (zone = mainzone; zone != NULL && base == NULL; zone = zone->next)
         {
-            rover = rover->next;
+            base = PurgeForBlock(zone, size);
         }
+    }
 
-    } while (base->tag != PU_FREE || base->size < size);
+    while (base == NULL)
+    {
+//      I_Error ("Z_Malloc: failed on allocation of %i bytes", size);
+
+        // [crispy] allocate another zone twice as big
+        Z_Init();
+
+        base = FindFreeBlock(size);
+    }
+
+    RemoveFreeBlock(base);
 
-    
     // found a block big enough
     extra = base->size - size;
     
@@ -331,16 +605,16 @@ Z_Malloc
 	
         newblock->tag = PU_FREE;
         newblock->user = NULL;	
+        newblock->id = 0;
         newblock->prev = base;
         newblock->next = base->next;
         newblock->next->prev = newblock;
 
         base->next = newblock;
         base->size = size;
+
+        InsertFreeBlock(newblock);
     }
-	
-	if (user == NULL && tag >= PU_PURGELEVEL)
-	    I_Error ("Z_Malloc: an owner is required for purgable blocks");
 
     base->user = user;
     base->tag = tag;
@@ -352,10 +626,24 @@ Z_Malloc
         *base->user = result;
     }
 
-    // next allocation will start looking here
-    mainzone->rover = base->next;	
+    // next purge will start looking here
+    BlockZone(base)->rover = base->next;
 	
     base->id = ZONEID;
+
+    ++stats.mallocs;
+
+    if (zone_stats)
+    {
+        uint64_t t = I_GetTimeUS() - start_time;
+
+        stats.malloc_time += t;
+
+        if (t > stats.max_malloc_time)
+        {
+            stats.max_malloc_time = t;
+        }
+    }
    
     return result;
 }
@@ -370,22 +658,26 @@ Z_FreeTags
 ( int		lowtag,
   int		hightag )
 {
+    memzone_t*	zone;
     memblock_t*	block;
     memblock_t*	next;
-	
-    for (block = mainzone->blocklist.next ;
-	 block != &mainzone->blocklist ;
-	 block = next)
-    {
-	// get link before freeing
-	next = block->next;
 
-	// free block?
-	if (block->tag == PU_FREE)
-	    continue;
-	
-	if (block->tag >= lowtag && block->tag <= hightag)
-	    Z_Free ( (byte *)block+sizeof(memblock_t));
+    for (zone = mainzone ; zone != NULL ; zone = zone->next)
+    {
+	for (block = zone->blocklist.next ;
+	     block != &zone->blocklist ;
+	     block = next)
+	{
+	    // get link before freeing
+	    next = block->next;
+
+	    // free block?
+	    if (block->tag == PU_FREE)
+		continue;
+	    
+	    if (block->tag >= lowtag && block->tag <= hightag)
+		Z_Free ( (byte *)block+sizeof(memblock_t));
+	}
     }
 }
 
@@ -400,34 +692,38 @@ Z_DumpHeap
 ( int		lowtag,
   int		hightag )
 {
+    memzone_t*	zone;
     memblock_t*	block;
-	
-    printf ("zone size: %i  location: %p\n",
-	    mainzone->size,mainzone);
-    
-    printf ("tag range: %i to %i\n",
-	    lowtag, hightag);
-	
-    for (block = mainzone->blocklist.next ; ; block = block->next)
+
+    for (zone = mainzone ; zone != NULL ; zone = zone->next)
     {
-	if (block->tag >= lowtag && block->tag <= hightag)
-	    printf ("block:%p    size:%7i    user:%p    tag:%3i\n",
-		    block, block->size, block->user, block->tag);
-		
-	if (block->next == &mainzone->blocklist)
+	printf ("zone size: %i  location: %p\n",
+		zone->size,zone);
+	
+	printf ("tag range: %i to %i\n",
+		lowtag, hightag);
+	    
+	for (block = zone->blocklist.next ; ; block = block->next)
 	{
-	    // all blocks have been hit
-	    break;
+	    if (block->tag >= lowtag && block->tag <= hightag)
+		printf ("block:%p    size:%7i    user:%p    tag:%3i\n",
+			block, block->size, block->user, block->tag);
+		    
+	    if (block->next == &zone->blocklist)
+	    {
+		// all blocks have been hit
+		break;
+	    }
+	    
+	    if ( (byte *)block + block->size != (byte *)block->next)
+		printf ("ERROR: block size does not touch the next block\n");
+
+	    if ( block->next->prev != block)
+		printf ("ERROR: next block doesn't have proper back link\n");
+
+	    if (block->tag == PU_FREE && block->next->tag == PU_FREE)
+		printf ("ERROR: two consecutive free blocks\n");
 	}
-	
-	if ( (byte *)block + block->size != (byte *)block->next)
-	    printf ("ERROR: block size does not touch the next block\n");
-
-	if ( block->next->prev != block)
-	    printf ("ERROR: next block doesn't have proper back link\n");
-
-	if (block->tag == PU_FREE && block->next->tag == PU_FREE)
-	    printf ("ERROR: two consecutive free blocks\n");
     }
 }
 
@@ -437,29 +733,33 @@ Z_DumpHeap
 //
 void Z_FileDumpHeap (FILE* f)
 {
+    memzone_t*	zone;
     memblock_t*	block;
-	
-    fprintf (f,"zone size: %i  location: %p\n",mainzone->size,mainzone);
-	
-    for (block = mainzone->blocklist.next ; ; block = block->next)
+
+    for (zone = mainzone ; zone != NULL ; zone = zone->next)
     {
-	fprintf (f,"block:%p    size:%7i    user:%p    tag:%3i\n",
-		 block, block->size, block->user, block->tag);
-		
-	if (block->next == &mainzone->blocklist)
+	fprintf (f,"zone size: %i  location: %p\n",zone->size,zone);
+	    
+	for (block = zone->blocklist.next ; ; block = block->next)
 	{
-	    // all blocks have been hit
-	    break;
+	    fprintf (f,"block:%p    size:%7i    user:%p    tag:%3i\n",
+		     block, block->size, block->user, block->tag);
+		    
+	    if (block->next == &zone->blocklist)
+	    {
+		// all blocks have been hit
+		break;
+	    }
+	    
+	    if ( (byte *)block + block->size != (byte *)block->next)
+		fprintf (f,"ERROR: block size does not touch the next block\n");
+
+	    if ( block->next->prev != block)
+		fprintf (f,"ERROR: next block doesn't have proper back link\n");
+
+	    if (block->tag == PU_FREE && block->next->tag == PU_FREE)
+		fprintf (f,"ERROR: two consecutive free blocks\n");
 	}
-	
-	if ( (byte *)block + block->size != (byte *)block->next)
-	    fprintf (f,"ERROR: block size does not touch the next block\n");
-
-	if ( block->next->prev != block)
-	    fprintf (f,"ERROR: next block doesn't have proper back link\n");
-
-	if (block->tag == PU_FREE && block->next->tag == PU_FREE)
-	    fprintf (f,"ERROR: two consecutive free blocks\n");
     }
 }
 
@@ -470,24 +770,28 @@ void Z_FileDumpHeap (FILE* f)
 //
 void Z_CheckHeap (void)
 {
+    memzone_t*	zone;
     memblock_t*	block;
-	
-    for (block = mainzone->blocklist.next ; ; block = block->next)
+
+    for (zone = mainzone ; zone != NULL ; zone = zone->next)
     {
-	if (block->next == &mainzone->blocklist)
+	for (block = zone->blocklist.next ; ; block = block->next)
 	{
-	    // all blocks have been hit
-	    break;
+	    if (block->next == &zone->blocklist)
+	    {
+		// all blocks have been hit
+		break;
+	    }
+	    
+	    if ( (byte *)block + block->size != (byte *)block->next)
+		I_Error ("Z_CheckHeap: block size does not touch the next block\n");
+
+	    if ( block->next->prev != block)
+		I_Error ("Z_CheckHeap: next block doesn't have proper back link\n");
+
+	    if (block->tag == PU_FREE && block->next->tag == PU_FREE)
+		I_Error ("Z_CheckHeap: two consecutive free blocks\n");
 	}
-	
-	if ( (byte *)block + block->size != (byte *)block->next)
-	    I_Error ("Z_CheckHeap: block size does not touch the next block\n");
-
-	if ( block->next->prev != block)
-	    I_Error ("Z_CheckHeap: next block doesn't have proper back link\n");
-
-	if (block->tag == PU_FREE && block->next->tag == PU_FREE)
-	    I_Error ("Z_CheckHeap: two consecutive free blocks\n");
     }
 }
 
@@ -536,17 +840,21 @@ void Z_ChangeUser(void *ptr, void **user)
 //
 int Z_FreeMemory (void)
 {
+    memzone_t*		zone;
     memblock_t*		block;
     int			free;
 	
     free = 0;
-    
-    for (block = mainzone->blocklist.next ;
-         block != &mainzone->blocklist;
-         block = block->next)
+
+    for (zone = mainzone ; zone != NULL ; zone = zone->next)
     {
-        if (block->tag == PU_FREE || block->tag >= PU_PURGELEVEL)
-            free += block->size;
+	for (block = zone->blocklist.next ;
+	     block != &zone->blocklist;
+	     block = block->next)
+	{
+	    if (block->tag == PU_FREE || block->tag >= PU_PURGELEVEL)
+		free += block->size;
+	}
     }
 
     return free;
@@ -554,6 +862,56 @@ int Z_FreeMemory (void)
 
 unsigned int Z_ZoneSize(void)
 {
-    return mainzone->size;
+    memzone_t *zone;
+    unsigned int size = 0;
+
+    for (zone = mainzone; zone != NULL; zone = zone->next)
+    {
+        size += zone->size;
+    }
+
+    return size;
+}
+
+void Z_SetPurgeHook(void (*hook)(void))
+{
+    purge_hook = hook;
+}
+
+// [crispy] -zonestats report
+
+static void Z_PrintStats (void)
+{
+    memblock_t *block;
+    int free, freeblocks, largest;
+    int i;
+
+    free = freeblocks = largest = 0;
+
+    for (i = 0; i < NUM_BINS; ++i)
+    {
+        for (block = freebins[i]; block != NULL; block = block->next_free)
+        {
+            free += block->size;
+            ++freeblocks;
+
+            if (block->size > largest)
+            {
+                largest = block->size;
+            }
+        }
+    }
+
+    printf("Z_PrintStats: %u zones, %u bytes, %d free in %d blocks, "
+           "largest %d (%d%% fragmented)\n",
+           stats.zones, Z_ZoneSize(), free, freeblocks, largest,
+           free > 0 ? 100 - (int) ((100LL * largest) / free) : 0);
+    printf("Z_PrintStats: %u mallocs, %u frees, %u purged, "
+           "%u needed purging\n",
+           stats.mallocs, stats.frees, stats.purges, stats.slow_mallocs);
+    printf("Z_PrintStats: Z_Malloc average %.3f us, max %u us\n",
+           stats.mallocs > 0 ?
+               (double) stats.malloc_time / stats.mallocs : 0.0,
+           (unsigned int) stats.max_malloc_time);
 }
 
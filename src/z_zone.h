@@ -62,6 +62,9 @@ void    Z_ChangeUser(void *ptr, void **user);
 int     Z_FreeMemory (void);
 unsigned int Z_ZoneSize(void);
 
+// [crispy] Set a function to call before purgable blocks are thrown out.
+void    Z_SetPurgeHook(void (*hook)(void));
+
 //
 // This is used to get the local FILE:LINE info from CPP
 // prior to really call the function in question.